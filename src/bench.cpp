@@ -0,0 +1,505 @@
+#include "bench.hpp"
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object.
+	 *
+	 * @param[in]  options  The options
+	 */
+	Bench::Bench(const benchOptions &options) : _zmqContext(1) {
+		_options = options;
+		_measureFrom = 0;
+		_measureUntil = 0;
+		_runPublishers = false;
+		_runSubscribers = false;
+	}
+
+	/**
+	 * @brief      Static method returning the current monotonic time, which is
+	 * the same for all processes on the host.
+	 *
+	 * @return     The time (ns).
+	 */
+	uint64_t Bench::_now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	 * @brief      Returns the receiver endpoint of a hub.
+	 *
+	 * @param[in]  hub   The hub index
+	 *
+	 * @return     The endpoint.
+	 */
+	std::string Bench::_receiverEndpoint(int hub) const {
+		return "tcp://127.0.0.1:" + std::to_string(_options.basePort + 2 * hub);
+	}
+
+	/**
+	 * @brief      Returns the publisher endpoint of a hub.
+	 *
+	 * @param[in]  hub   The hub index
+	 *
+	 * @return     The endpoint.
+	 */
+	std::string Bench::_publisherEndpoint(int hub) const {
+		return "tcp://127.0.0.1:" + std::to_string(_options.basePort + 2 * hub + 1);
+	}
+
+	/**
+	 * @brief      Returns the shared-memory handshake endpoint of a hub.
+	 *
+	 * @param[in]  hub   The hub index
+	 *
+	 * @return     The endpoint.
+	 */
+	std::string Bench::_shmEndpoint(int hub) const {
+		return std::string("ipc://") + TDRS_BENCH_SHM_DIR + "/tdrs-bench-" + std::to_string(_options.basePort + 2 * hub) + ".hello";
+	}
+
+	/**
+	 * @brief      Spawns the hubs, linked according to the topology: 'line'
+	 * links every hub to its neighbours, 'ring' closes the line, 'mesh'
+	 * links every hub to all others.
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool Bench::_spawnHubs() {
+		for(int hub = 0; hub < _options.hubs; hub++) {
+			std::vector<std::string> arguments;
+			arguments.push_back(_options.hub);
+			arguments.push_back("--receiver-listen");
+			arguments.push_back(_receiverEndpoint(hub));
+			arguments.push_back("--publisher-listen");
+			arguments.push_back(_publisherEndpoint(hub));
+			arguments.push_back("--log-level");
+			arguments.push_back("error");
+			if(_options.transport == "shm") {
+				arguments.push_back("--shm-dir");
+				arguments.push_back(TDRS_BENCH_SHM_DIR);
+				arguments.push_back("--shm-listen");
+				arguments.push_back(_shmEndpoint(hub));
+			}
+
+			for(int link = 0; link < _options.hubs; link++) {
+				int distance = std::abs(link - hub);
+				bool linked = false;
+
+				if(_options.topology == "mesh") {
+					linked = (distance != 0);
+				} else if(_options.topology == "ring") {
+					linked = (distance == 1 || (distance == _options.hubs - 1 && _options.hubs > 2));
+				} else {
+					linked = (distance == 1);
+				}
+
+				if(linked) {
+					arguments.push_back("--chain-link");
+					arguments.push_back(_publisherEndpoint(link));
+				}
+			}
+
+			BOOST_FOREACH(const std::string &argument, _options.hubArguments) {
+				arguments.push_back(argument);
+			}
+
+			std::vector<char*> argv;
+			BOOST_FOREACH(std::string &argument, arguments) {
+				argv.push_back(const_cast<char*>(argument.c_str()));
+			}
+			argv.push_back(NULL);
+
+			pid_t pid = fork();
+			if(pid < 0) {
+				std::cerr << "tdrs-bench: Spawning hub failed!" << std::endl;
+				return false;
+			}
+
+			if(pid == 0) {
+				// The hubs' output would only get in the way of the results
+				int devNull = open("/dev/null", O_WRONLY);
+				dup2(devNull, STDOUT_FILENO);
+				dup2(devNull, STDERR_FILENO);
+				execv(argv[0], &argv[0]);
+				_exit(127);
+			}
+
+			_hubPids.push_back(pid);
+		}
+
+		usleep(TDRS_BENCH_SETTLE_TIME * 1000);
+
+		BOOST_FOREACH(pid_t pid, _hubPids) {
+			int status;
+			if(waitpid(pid, &status, WNOHANG) != 0) {
+				std::cerr << "tdrs-bench: Hub " << _options.hub << " exited prematurely, check its options and ports." << std::endl;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief      Stops the spawned hubs and waits for them to exit.
+	 */
+	void Bench::_stopHubs() {
+		BOOST_FOREACH(pid_t pid, _hubPids) {
+			kill(pid, SIGINT);
+		}
+
+		BOOST_FOREACH(pid_t pid, _hubPids) {
+			waitpid(pid, NULL, 0);
+		}
+		_hubPids.clear();
+	}
+
+	/**
+	 * @brief      The publisher; static method instantiated as an own thread.
+	 *
+	 * Sends events over a REQ socket at the configured rate, one at a time,
+	 * stamped with the time they were sent at.
+	 *
+	 * @param      benchClientParams  The client parameters (struct)
+	 *
+	 * @return     NULL
+	 */
+	void *Bench::_publisher(void *benchClientParams) {
+		_benchClientParams *params = static_cast<_benchClientParams*>(benchClientParams);
+		Bench *bench = params->bench;
+
+		zmq::socket_t socket(bench->_zmqContext, ZMQ_REQ);
+		int linger = 0;
+		int timeout = TDRS_BENCH_ACK_TIMEOUT;
+		socket.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+		socket.setsockopt(ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+		socket.connect(params->endpoint);
+
+		uint64_t interval = (bench->_options.rate > 0 ? 1000000000 / bench->_options.rate : 0);
+		uint64_t next = Bench::_now();
+		uint32_t id = params->id;
+
+		while(bench->_runPublishers == true) {
+			if(interval > 0) {
+				uint64_t now = Bench::_now();
+				if(now < next) {
+					usleep((next - now) / 1000);
+				}
+				next += interval;
+			}
+
+			uint64_t sentAt = Bench::_now();
+			zmq::message_t event(bench->_options.size);
+			unsigned char *data = static_cast<unsigned char*>(event.data());
+			memset(data, 'x', bench->_options.size);
+			memcpy(data, TDRS_BENCH_MAGIC, 4);
+			memcpy(data + 4, &id, sizeof(id));
+			memcpy(data + 8, &sentAt, sizeof(sentAt));
+
+			zmq::message_t ack;
+			try {
+				socket.send(event);
+				params->sent++;
+
+				if(!socket.recv(&ack)) {
+					// A REQ socket cannot send again before it got its response
+					params->failed++;
+					break;
+				}
+			} catch(...) {
+				params->failed++;
+				break;
+			}
+
+			if(ack.size() < 3 || memcmp(ack.data(), "OOK", 3) != 0) {
+				params->failed++;
+			} else if(sentAt >= bench->_measureFrom && sentAt < bench->_measureUntil) {
+				params->acked++;
+			}
+		}
+
+		socket.close();
+		return NULL;
+	}
+
+	/**
+	 * @brief      The shared-memory publisher; static method instantiated as
+	 * an own thread.
+	 *
+	 * Asks its hub for a shared-memory ring over a REQ socket connected to
+	 * the hub's handshake endpoint, then writes
+	 * events to the ring at the configured rate, stamped with the time they
+	 * were sent at. Events are counted as acked once written; a full ring is
+	 * retried until the hub drained it.
+	 *
+	 * @param      benchClientParams  The client parameters (struct)
+	 *
+	 * @return     NULL
+	 */
+	void *Bench::_publisherShm(void *benchClientParams) {
+		_benchClientParams *params = static_cast<_benchClientParams*>(benchClientParams);
+		Bench *bench = params->bench;
+
+		zmq::socket_t socket(bench->_zmqContext, ZMQ_REQ);
+		int linger = 0;
+		int timeout = TDRS_BENCH_ACK_TIMEOUT;
+		socket.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+		socket.setsockopt(ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+		socket.connect(params->endpoint);
+
+		zmq::message_t response;
+		try {
+			zmq::message_t hello(TDRS_SHM_HELLO, strlen(TDRS_SHM_HELLO));
+			socket.send(hello);
+			if(!socket.recv(&response)) {
+				response.rebuild();
+			}
+		} catch(...) {
+			response.rebuild();
+		}
+		socket.close();
+
+		// The response is `SHM <ring> <wakeup FIFO>`
+		std::istringstream responseStream(std::string(static_cast<const char*>(response.data()), response.size()));
+		std::string status, path, wake;
+		responseStream >> status >> path >> wake;
+
+		HubShmRing ring;
+		if(status != "SHM" || !ring.attach(path, wake)) {
+			std::cerr << "tdrs-bench: Publisher " << params->id << " got no shared-memory ring, check the hub's --shm-dir." << std::endl;
+			params->failed++;
+			return NULL;
+		}
+
+		uint64_t interval = (bench->_options.rate > 0 ? 1000000000 / bench->_options.rate : 0);
+		uint64_t next = Bench::_now();
+		uint32_t id = params->id;
+		std::vector<unsigned char> event(bench->_options.size, 'x');
+		memcpy(&event[0], TDRS_BENCH_MAGIC, 4);
+		memcpy(&event[4], &id, sizeof(id));
+
+		while(bench->_runPublishers == true) {
+			if(interval > 0) {
+				uint64_t now = Bench::_now();
+				if(now < next) {
+					usleep((next - now) / 1000);
+				}
+				next += interval;
+			}
+
+			uint64_t sentAt = Bench::_now();
+			memcpy(&event[8], &sentAt, sizeof(sentAt));
+
+			bool written = false;
+			while(!(written = ring.write(&event[0], event.size())) && bench->_runPublishers == true) {
+				sched_yield();
+			}
+
+			if(!written) {
+				break;
+			}
+			params->sent++;
+
+			if(sentAt >= bench->_measureFrom && sentAt < bench->_measureUntil) {
+				params->acked++;
+			}
+		}
+
+		ring.close();
+		return NULL;
+	}
+
+	/**
+	 * @brief      The subscriber; static method instantiated as an own thread.
+	 *
+	 * Receives all events and records the latency of the ones sent within
+	 * the measured time window.
+	 *
+	 * @param      benchClientParams  The client parameters (struct)
+	 *
+	 * @return     NULL
+	 */
+	void *Bench::_subscriber(void *benchClientParams) {
+		_benchClientParams *params = static_cast<_benchClientParams*>(benchClientParams);
+		Bench *bench = params->bench;
+
+		zmq::socket_t socket(bench->_zmqContext, ZMQ_SUB);
+		int linger = 0;
+		int hwm = 0;
+		socket.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+		socket.setsockopt(ZMQ_RCVHWM, &hwm, sizeof(hwm));
+		socket.setsockopt(ZMQ_SUBSCRIBE, TDRS_BENCH_MAGIC, 4);
+		socket.connect(params->endpoint);
+
+		zmq::pollitem_t pollItems[] = {
+			{ (void *)socket, 0, ZMQ_POLLIN, 0 }
+		};
+
+		while(bench->_runSubscribers == true) {
+			try {
+				if(zmq::poll(pollItems, 1, 100) == 0) {
+					continue;
+				}
+			} catch(...) {
+				continue;
+			}
+
+			while(true) {
+				zmq::message_t event;
+				if(!socket.recv(&event, ZMQ_DONTWAIT)) {
+					break;
+				}
+				uint64_t receivedAt = Bench::_now();
+
+				// Chain envelopes, if any, are of no interest
+				bool more = event.more();
+				while(more) {
+					zmq::message_t frame;
+					socket.recv(&frame);
+					more = frame.more();
+				}
+
+				if(event.size() < TDRS_BENCH_HEADER_SIZE) {
+					continue;
+				}
+
+				uint64_t sentAt;
+				memcpy(&sentAt, static_cast<unsigned char*>(event.data()) + 8, sizeof(sentAt));
+				if(sentAt >= bench->_measureFrom && sentAt < bench->_measureUntil) {
+					params->received++;
+					params->latency.record(receivedAt - sentAt);
+				}
+			}
+		}
+
+		socket.close();
+		return NULL;
+	}
+
+	/**
+	 * @brief      Method for running client threads, spreading them across
+	 * the hubs.
+	 *
+	 * @param[in]  count      The number of threads
+	 * @param[in]  client     The thread function
+	 * @param[in]  publisher  Whether to connect to receivers or to publishers
+	 * @param      threads    The threads
+	 */
+	void Bench::_runClientThreads(int count, void *(*client)(void *), bool publisher, std::vector<_benchClientThread> *threads) {
+		for(int id = 0; id < count; id++) {
+			_benchClientThread thread;
+			thread.params = new _benchClientParams;
+			thread.params->bench = this;
+			thread.params->id = id;
+			if(!publisher) {
+				thread.params->endpoint = _publisherEndpoint(id % _options.hubs);
+			} else if(_options.transport == "shm") {
+				thread.params->endpoint = _shmEndpoint(id % _options.hubs);
+			} else {
+				thread.params->endpoint = _receiverEndpoint(id % _options.hubs);
+			}
+			thread.params->sent = 0;
+			thread.params->acked = 0;
+			thread.params->failed = 0;
+			thread.params->received = 0;
+
+			pthread_attr_init(&thread.thattr);
+			pthread_attr_setdetachstate(&thread.thattr, PTHREAD_CREATE_JOINABLE);
+			pthread_create(&thread.thread, &thread.thattr, client, (void *)thread.params);
+
+			threads->push_back(thread);
+		}
+	}
+
+	/**
+	 * @brief      Method for joining client threads. Their parameters are
+	 * kept for the results.
+	 *
+	 * @param      threads  The threads
+	 */
+	void Bench::_joinClientThreads(std::vector<_benchClientThread> *threads) {
+		BOOST_FOREACH(_benchClientThread &thread, *threads) {
+			pthread_join(thread.thread, NULL);
+			pthread_attr_destroy(&thread.thattr);
+		}
+	}
+
+	/**
+	 * @brief      Runs the benchmark and prints its results.
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool Bench::run() {
+		std::cout << "tdrs-bench: " << _options.hubs << " hubs (" << _options.topology << "), "
+			<< _options.publishers << " publishers, " << _options.subscribers << " subscribers, "
+			<< (_options.rate > 0 ? std::to_string(_options.rate) : "unlimited") << " events/s per publisher, "
+			<< _options.size << " bytes per event over " << _options.transport << std::endl;
+
+		if(!_spawnHubs()) {
+			_stopHubs();
+			return false;
+		}
+
+		std::vector<_benchClientThread> subscribers;
+		std::vector<_benchClientThread> publishers;
+
+		_runSubscribers = true;
+		_runClientThreads(_options.subscribers, &Bench::_subscriber, false, &subscribers);
+		usleep(TDRS_BENCH_SETTLE_TIME * 1000);
+
+		_measureFrom = Bench::_now() + _options.warmup * 1000000;
+		_measureUntil = _measureFrom + _options.duration * 1000000;
+
+		_runPublishers = true;
+		_runClientThreads(_options.publishers, (_options.transport == "shm" ? &Bench::_publisherShm : &Bench::_publisher), true, &publishers);
+		usleep((_options.warmup + _options.duration) * 1000);
+		_runPublishers = false;
+		_joinClientThreads(&publishers);
+
+		usleep(TDRS_BENCH_DRAIN_TIME * 1000);
+		_runSubscribers = false;
+		_joinClientThreads(&subscribers);
+
+		_stopHubs();
+
+		uint64_t acked = 0;
+		uint64_t failed = 0;
+		BOOST_FOREACH(_benchClientThread &thread, publishers) {
+			acked += thread.params->acked;
+			failed += thread.params->failed;
+			delete thread.params;
+		}
+
+		uint64_t received = 0;
+		HubHistogram latency;
+		BOOST_FOREACH(_benchClientThread &thread, subscribers) {
+			received += thread.params->received;
+			latency.merge(thread.params->latency);
+			delete thread.params;
+		}
+
+		double seconds = _options.duration / 1000.0;
+		double publishedRate = acked / seconds;
+		double deliveredRate = received / seconds;
+		uint64_t expected = acked * _options.subscribers;
+
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << "published  " << publishedRate << " events/s (" << acked << " acked, " << failed << " failed)" << std::endl;
+		std::cout << "delivered  " << deliveredRate << " events/s (" << received << " of " << expected << " expected)" << std::endl;
+		std::cout << "latency    p50 " << latency.quantile(0.5) / 1000.0 << " us, p99 " << latency.quantile(0.99) / 1000.0
+			<< " us, p99.9 " << latency.quantile(0.999) / 1000.0 << " us, max " << latency.max() / 1000.0 << " us" << std::endl;
+
+		// One line per run, to be compared with other runs
+		std::cout << "result hubs=" << _options.hubs << " topology=" << _options.topology
+			<< " publishers=" << _options.publishers << " subscribers=" << _options.subscribers
+			<< " rate=" << _options.rate << " size=" << _options.size << " transport=" << _options.transport
+			<< " published_per_second=" << publishedRate << " delivered_per_second=" << deliveredRate
+			<< " p50_us=" << latency.quantile(0.5) / 1000.0 << " p99_us=" << latency.quantile(0.99) / 1000.0
+			<< " p999_us=" << latency.quantile(0.999) / 1000.0 << " max_us=" << latency.max() / 1000.0 << std::endl;
+
+		return true;
+	}
+}
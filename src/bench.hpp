@@ -0,0 +1,208 @@
+#include "tdrs.hpp"
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sched.h>
+
+/**
+ * Header the benchmark stamps every event with: a magic, the sending
+ * publisher and the time (ns) it was sent at.
+ */
+#define TDRS_BENCH_MAGIC "TDRB"
+#define TDRS_BENCH_HEADER_SIZE 16
+/**
+ * Time (ms) the hubs get to bind their sockets and link up, and the
+ * subscribers get to subscribe.
+ */
+#define TDRS_BENCH_SETTLE_TIME 1000
+/**
+ * Time (ms) publishers wait for an ack before giving up.
+ */
+#define TDRS_BENCH_ACK_TIMEOUT 2000
+/**
+ * Time (ms) subscribers keep receiving after the publishers finished.
+ */
+#define TDRS_BENCH_DRAIN_TIME 500
+/**
+ * Directory the hubs create their shared-memory rings in.
+ */
+#define TDRS_BENCH_SHM_DIR "/dev/shm"
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Benchmark options.
+	 */
+	struct benchOptions {
+		std::string hub;
+		std::vector<std::string> hubArguments;
+		int hubs;
+		std::string topology;
+		int basePort;
+		int publishers;
+		int subscribers;
+		uint64_t rate;
+		size_t size;
+		uint64_t warmup;
+		uint64_t duration;
+		std::string transport;
+	};
+
+	class Bench;
+
+	/**
+	 * @brief      Parameters struct for benchmark publisher and subscriber threads.
+	 */
+	struct _benchClientParams {
+		Bench *bench;
+		int id;
+		std::string endpoint;
+		uint64_t sent;
+		uint64_t acked;
+		uint64_t failed;
+		uint64_t received;
+		HubHistogram latency;
+	};
+
+	/**
+	 * @brief      Benchmark client thread struct, containing the thread itself and the parameters.
+	 */
+	struct _benchClientThread {
+		pthread_t thread;
+		pthread_attr_t thattr;
+		_benchClientParams *params;
+	};
+
+	/**
+	 * @brief      Class for Bench, spawning a topology of hubs and measuring
+	 * throughput and end-to-end latency of events published through it.
+	 */
+	class Bench {
+		private:
+			/**
+			 * ZMQ Context, shared by all publishers and subscribers.
+			 */
+			zmq::context_t _zmqContext;
+			/**
+			 * The options.
+			 */
+			benchOptions _options;
+			/**
+			 * Process identifiers of the spawned hubs.
+			 */
+			std::vector<pid_t> _hubPids;
+			/**
+			 * Time (ns) window in which sent events are measured.
+			 */
+			std::atomic<uint64_t> _measureFrom;
+			std::atomic<uint64_t> _measureUntil;
+			/**
+			 * The publishers' and the subscribers' run-loop variables.
+			 */
+			std::atomic<bool> _runPublishers;
+			std::atomic<bool> _runSubscribers;
+
+			/**
+			 * @brief      Static method returning the current monotonic time,
+			 * which is the same for all processes on the host.
+			 *
+			 * @return     The time (ns).
+			 */
+			static uint64_t _now();
+			/**
+			 * @brief      Returns the receiver endpoint of a hub.
+			 *
+			 * @param[in]  hub   The hub index
+			 *
+			 * @return     The endpoint.
+			 */
+			std::string _receiverEndpoint(int hub) const;
+			/**
+			 * @brief      Returns the publisher endpoint of a hub.
+			 *
+			 * @param[in]  hub   The hub index
+			 *
+			 * @return     The endpoint.
+			 */
+			std::string _publisherEndpoint(int hub) const;
+			/**
+			 * @brief      Returns the shared-memory handshake endpoint of a
+			 * hub.
+			 *
+			 * @param[in]  hub   The hub index
+			 *
+			 * @return     The endpoint.
+			 */
+			std::string _shmEndpoint(int hub) const;
+			/**
+			 * @brief      Spawns the hubs, linked according to the topology.
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			bool _spawnHubs();
+			/**
+			 * @brief      Stops the spawned hubs and waits for them to exit.
+			 */
+			void _stopHubs();
+
+			/**
+			 * @brief      The publisher; static method instantiated as an own thread.
+			 *
+			 * @param      benchClientParams  The client parameters (struct)
+			 *
+			 * @return     NULL
+			 */
+			static void *_publisher(void *benchClientParams);
+			/**
+			 * @brief      The shared-memory publisher; static method
+			 * instantiated as an own thread.
+			 *
+			 * @param      benchClientParams  The client parameters (struct)
+			 *
+			 * @return     NULL
+			 */
+			static void *_publisherShm(void *benchClientParams);
+			/**
+			 * @brief      The subscriber; static method instantiated as an own thread.
+			 *
+			 * @param      benchClientParams  The client parameters (struct)
+			 *
+			 * @return     NULL
+			 */
+			static void *_subscriber(void *benchClientParams);
+			/**
+			 * @brief      Method for running client threads.
+			 *
+			 * @param[in]  count      The number of threads
+			 * @param[in]  client     The thread function
+			 * @param[in]  publisher  Whether to connect to receivers or to publishers
+			 * @param      threads    The threads
+			 */
+			void _runClientThreads(int count, void *(*client)(void *), bool publisher, std::vector<_benchClientThread> *threads);
+			/**
+			 * @brief      Method for joining client threads, releasing their parameters.
+			 *
+			 * @param      threads  The threads
+			 */
+			void _joinClientThreads(std::vector<_benchClientThread> *threads);
+		public:
+			/**
+			 * @brief      Constructs the object.
+			 *
+			 * @param[in]  options  The options
+			 */
+			Bench(const benchOptions &options);
+
+			/**
+			 * @brief      Runs the benchmark and prints its results.
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			bool run();
+	};
+}
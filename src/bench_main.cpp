@@ -0,0 +1,111 @@
+#include "bench.hpp"
+
+/**
+ * @brief      Parses the benchmark options.
+ *
+ * @param[in]  argc     The main argc
+ * @param      argv     The main argv
+ * @param      options  The options
+ *
+ * @return     True on success, false on failure.
+ */
+bool parseOptions(int argc, char *argv[], tdrs::benchOptions *options) {
+	try {
+		bpo::options_description optionsDescription("Options:");
+		optionsDescription.add_options()
+			("help", "show this usage information")
+			("hub", bpo::value<std::string>(), "set the path of the hub binary, default './tdrs'")
+			("hub-argument", bpo::value<std::vector<std::string> >(&options->hubArguments)->multitoken(), "add an argument passed to every hub, e.g. --hub-argument=--chain-envelope, specify one per argument")
+			("hubs", bpo::value<int>(), "set the number of hubs, default 1")
+			("topology", bpo::value<std::string>(), "set how the hubs are chain-linked, one of 'line', 'ring', 'mesh', default 'mesh'")
+			("base-port", bpo::value<int>(), "set the first localhost port the hubs listen on, each hub uses two, default 29890")
+			("publishers", bpo::value<int>(), "set the number of REQ publishers, spread across the hubs, default 1")
+			("subscribers", bpo::value<int>(), "set the number of SUB subscribers, spread across the hubs, default 1")
+			("rate", bpo::value<uint64_t>(), "set the events per second sent by each publisher, 0 for as fast as acks come back, default 1000")
+			("size", bpo::value<size_t>(), "set the size (bytes) of each event, at least 16, default 128")
+			("warmup", bpo::value<uint64_t>(), "set the time (ms) events are sent before measuring, default 1000")
+			("duration", bpo::value<uint64_t>(), "set the time (ms) events are measured, default 10000")
+			("transport", bpo::value<std::string>(), "set how publishers send events to their hub, either 'tcp' (REQ, acked) or 'shm' (a shared-memory ring, counted once written), default 'tcp'")
+		;
+
+		bpo::variables_map variablesMap;
+		bpo::store(bpo::parse_command_line(argc, argv, optionsDescription), variablesMap);
+		bpo::notify(variablesMap);
+
+		if(variablesMap.count("help")) {
+			std::cout << optionsDescription << std::endl;
+			return false;
+		}
+
+		options->hub = (variablesMap.count("hub") ? variablesMap["hub"].as<std::string>() : "./tdrs");
+		options->hubs = (variablesMap.count("hubs") ? variablesMap["hubs"].as<int>() : 1);
+		options->topology = (variablesMap.count("topology") ? variablesMap["topology"].as<std::string>() : "mesh");
+		options->basePort = (variablesMap.count("base-port") ? variablesMap["base-port"].as<int>() : 29890);
+		options->publishers = (variablesMap.count("publishers") ? variablesMap["publishers"].as<int>() : 1);
+		options->subscribers = (variablesMap.count("subscribers") ? variablesMap["subscribers"].as<int>() : 1);
+		options->rate = (variablesMap.count("rate") ? variablesMap["rate"].as<uint64_t>() : 1000);
+		options->size = (variablesMap.count("size") ? variablesMap["size"].as<size_t>() : 128);
+		options->warmup = (variablesMap.count("warmup") ? variablesMap["warmup"].as<uint64_t>() : 1000);
+		options->duration = (variablesMap.count("duration") ? variablesMap["duration"].as<uint64_t>() : 10000);
+		options->transport = (variablesMap.count("transport") ? variablesMap["transport"].as<std::string>() : "tcp");
+
+		if(options->hubs < 1 || options->publishers < 1 || options->subscribers < 0) {
+			std::cerr << "tdrs-bench: Error, at least one hub and one publisher are required." << std::endl;
+			return false;
+		}
+
+		if(options->topology != "line" && options->topology != "ring" && options->topology != "mesh") {
+			std::cerr << "tdrs-bench: Error, unknown topology " << options->topology << ". Use one of line, ring, mesh." << std::endl;
+			return false;
+		}
+
+		if(options->transport != "tcp" && options->transport != "shm") {
+			std::cerr << "tdrs-bench: Error, unknown transport " << options->transport << ". Use one of tcp, shm." << std::endl;
+			return false;
+		}
+
+		if(options->size < TDRS_BENCH_HEADER_SIZE) {
+			std::cerr << "tdrs-bench: Error, events need to be at least " << TDRS_BENCH_HEADER_SIZE << " bytes." << std::endl;
+			return false;
+		}
+
+		if(options->duration == 0) {
+			std::cerr << "tdrs-bench: Error, the duration needs to be at least 1 ms." << std::endl;
+			return false;
+		}
+
+		if(options->basePort < 1 || options->basePort + 2 * options->hubs > 65536) {
+			std::cerr << "tdrs-bench: Error, the hubs' ports are out of range." << std::endl;
+			return false;
+		}
+	} catch(bpo::error &exception) {
+		std::cerr << "tdrs-bench: Error, " << exception.what() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief      Program entrypoint.
+ *
+ * @return     0 on success, -1 on failure
+ */
+int main(int argc, char* argv[])
+{
+	tdrs::benchOptions options;
+
+	if(parseOptions(argc, argv, &options) == false) {
+		return -1;
+	}
+
+	// Hubs exiting early must not take the benchmark down with them
+	signal(SIGPIPE, SIG_IGN);
+
+	tdrs::Bench bench(options);
+	if(bench.run() == false) {
+		return -1;
+	}
+
+	return 0;
+}
@@ -9,56 +9,341 @@ namespace tdrs {
 	 *
 	 * @param[in]  ctxn  The number of context IO threads
 	 */
-	Hub::Hub(int ctxn) : _zmqContext(ctxn), _zmqHubSocket(_zmqContext, ZMQ_PUB), _zmqReceiverSocket(_zmqContext, ZMQ_REP) {
+	Hub::Hub(int ctxn) : _zmqContext(ctxn), _zmqHubSocket(_zmqContext, ZMQ_XPUB), _zmqReceiverSocket(_zmqContext, ZMQ_REP), _zmqIngestSocket(_zmqContext, ZMQ_PULL), _zmqChainSocket(_zmqContext, ZMQ_PULL), _zmqChainReactorSocket(_zmqContext, ZMQ_PAIR), _zmqResultsSocket(_zmqContext, ZMQ_PULL), _zmqMetricsSocket(_zmqContext, ZMQ_REP), _zmqControlSocket(_zmqContext, ZMQ_PULL), _zmqChainBatchSocket(_zmqContext, ZMQ_XPUB), _zmqPartitionSocket(_zmqContext, ZMQ_REP), _zmqPartitionProxySocket(_zmqContext, ZMQ_PULL), _zmqShmSocket(_zmqContext, ZMQ_REP) {
 		_runLoop = true;
+		pthread_mutex_init(&_dedupIndexMutex, NULL);
+		pthread_mutex_init(&_subscriptionTableMutex, NULL);
+		_optionReceiverMode = "rep";
+		_optionWorkers = 1;
+		_optionDedupMaxEntries = TDRS_DEDUP_DEFAULT_MAX_ENTRIES;
+		_optionDedupMaxMemory = TDRS_DEDUP_DEFAULT_MAX_BYTES / (1024 * 1024);
+		_optionDedupTtl = TDRS_DEDUP_DEFAULT_TTL;
+		_optionFingerprint = TDRS_FINGERPRINT_SHA1;
+		_optionChainEnvelope = false;
+		_optionChainMaxHops = TDRS_CHAIN_DEFAULT_MAX_HOPS;
+		_optionChainSubscriptions = false;
+		_optionChainReactor = false;
+		_optionChainHeartbeatInterval = 0;
+		_optionChainHeartbeatTimeout = 0;
+		_optionChainReconnectMax = TDRS_CHAIN_DEFAULT_RECONNECT_MAX;
+		_optionPublisherHwm = TDRS_DEFAULT_HWM;
+		_optionReceiverHwm = TDRS_DEFAULT_HWM;
+		_optionChainHwm = TDRS_DEFAULT_HWM;
+		_optionOverflowPolicy = TDRS_OVERFLOW_LOSSY;
+		_optionPublisherBacklog = TDRS_PUBLISHER_DEFAULT_BACKLOG;
+		_optionCacheSize = 0;
+		_publisherStats.backlog = 0;
+		_publisherStats.backlogged = 0;
+		_publisherStats.droppedNewest = 0;
+		_publisherStats.droppedOldest = 0;
+		_metricEventsReceived = 0;
+		_metricEventsPublished = 0;
+		_metricAcksFailed = 0;
+		_metricChainBatches = 0;
+		_metricChainBatchBytesDecoded = 0;
+		_metricChainBatchBytesSent = 0;
+		_nextHeartbeatAt = 0;
+		_metricChainHeartbeatsFailed = 0;
+		_metricPartitionRedirected = 0;
+		_metricPartitionProxied = 0;
+		_metricPartitionDropped = 0;
+		_metricPartitionSettling = 0;
+		_partitionChangedAt = 0;
+		_metricShmEvents = 0;
+		_shmWakeFd = -1;
+		_shmRingSequence = 0;
+		_shmCheckedAt = 0;
+		_metricsRequestedAt = Hub::monotonicTime();
+		_metricsRequestedReceived = 0;
+		_metricsRequestedPublished = 0;
+		_originSequence = 0;
+
+		std::random_device random;
+		_hubId = ((uint64_t)random() << 32) | random();
+		_nextIngestWorker = 0;
+		_ingestSequence = 0;
+		_publishSequence = 0;
+		_receiverBusy = false;
 		_optionDiscovery = false;
 		_optionDiscoveryPort = 5670;
 		_optionDiscoveryInterval = 1000;
 		_optionDiscoveryGroup = "TDRS";
 		_optionDiscoveryKey = "TDRS";
+		_optionDiscoveryTopology = TDRS_OVERLAY_MESH;
+		_optionDiscoveryFanout = TDRS_OVERLAY_DEFAULT_FANOUT;
+		_optionDiscoverySuperPeers = TDRS_OVERLAY_DEFAULT_SUPER_PEERS;
+		_optionPartition = false;
+		_optionPartitionDelimiter = TDRS_PARTITION_DEFAULT_DELIMITER;
+		_optionShmRingSize = TDRS_SHM_DEFAULT_RING_SIZE;
 	}
 
 	/**
 	 * @brief      Binds the publisher.
 	 */
 	void Hub::_bindPublisher() {
-		std::cout << "Hub: Binding publisher ..." << std::endl;
+		TDRS_LOG_INFO("Hub: Binding publisher ...");
+		if(!_optionChainSubscriptions) {
+			// Subscriptions are only of interest to chain clients subscribing by them
+			_zmqHubSocket = zmq::socket_t(_zmqContext, ZMQ_PUB);
+		}
 		int _zmqHubSocketLinger = 0;
 		_zmqHubSocket.setsockopt(ZMQ_LINGER, &_zmqHubSocketLinger, sizeof(_zmqHubSocketLinger));
+		_zmqHubSocket.setsockopt(ZMQ_SNDHWM, &_optionPublisherHwm, sizeof(_optionPublisherHwm));
+		if(_optionOverflowPolicy != TDRS_OVERFLOW_LOSSY) {
+			// Refuse events a subscriber has no room for, instead of dropping them silently; one full subscriber refuses them for all
+			int _zmqHubSocketNodrop = 1;
+			_zmqHubSocket.setsockopt(ZMQ_XPUB_NODROP, &_zmqHubSocketNodrop, sizeof(_zmqHubSocketNodrop));
+		}
+		if(_optionChainSubscriptions) {
+			// Report every subscription and unsubscription, so they can be counted, and apply them by hand
+			int _zmqHubSocketVerboser = 1;
+			int _zmqHubSocketManual = 1;
+			_zmqHubSocket.setsockopt(ZMQ_XPUB_VERBOSER, &_zmqHubSocketVerboser, sizeof(_zmqHubSocketVerboser));
+			_zmqHubSocket.setsockopt(ZMQ_XPUB_MANUAL, &_zmqHubSocketManual, sizeof(_zmqHubSocketManual));
+		}
 		_zmqHubSocket.bind(_optionPublisherListen);
-		std::cout << "Hub: Bound publisher." << std::endl;
+		TDRS_LOG_INFO("Hub: Bound publisher.");
 	}
 
 	/**
 	 * @brief      Unbinds (closes) the publisher.
 	 */
 	void Hub::_unbindPublisher() {
-		std::cout << "Hub: Sending termination to subscribers ..." << std::endl;
-		_zmqHubSocket.send("TERMINATE", 9, 0);
-		std::cout << "Hub: Sent termination to subscribers." << std::endl;
-		std::cout << "Hub: Unbinding publisher ..." << std::endl;
+		TDRS_LOG_INFO("Hub: Sending termination to subscribers ...");
+		_zmqHubSocket.send("TERMINATE", 9, ZMQ_DONTWAIT);
+		TDRS_LOG_INFO("Hub: Sent termination to subscribers.");
+		TDRS_LOG_INFO("Hub: Unbinding publisher ...");
 		_zmqHubSocket.close();
-		std::cout << "Hub: Unbound publisher." << std::endl;
+		TDRS_LOG_INFO("Hub: Unbound publisher.");
 	}
 
 	/**
 	 * @brief      Binds the receiver.
 	 */
 	void Hub::_bindReceiver() {
-		std::cout << "Hub: Binding receiver ..." << std::endl;
+		TDRS_LOG_INFO("Hub: Binding receiver ...");
+		if(_optionReceiverMode == "router") {
+			_zmqReceiverSocket = zmq::socket_t(_zmqContext, ZMQ_ROUTER);
+		}
 		int _zmqReceiverSocketLinger = 0;
 		_zmqReceiverSocket.setsockopt(ZMQ_LINGER, &_zmqReceiverSocketLinger, sizeof(_zmqReceiverSocketLinger));
+		_zmqReceiverSocket.setsockopt(ZMQ_RCVHWM, &_optionReceiverHwm, sizeof(_optionReceiverHwm));
+		_zmqReceiverSocket.setsockopt(ZMQ_SNDHWM, &_optionReceiverHwm, sizeof(_optionReceiverHwm));
 		_zmqReceiverSocket.bind(_optionReceiverListen);
-		std::cout << "Hub: Bound receiver." << std::endl;
+		TDRS_LOG_INFO("Hub: Bound receiver.");
 	}
 
 	/**
 	 * @brief      Unbinds (closes) the receiver.
 	 */
 	void Hub::_unbindReceiver() {
-		std::cout << "Hub: Unbinding receiver ..." << std::endl;
+		TDRS_LOG_INFO("Hub: Unbinding receiver ...");
 		_zmqReceiverSocket.close();
-		std::cout << "Hub: Unbound receiver." << std::endl;
+		TDRS_LOG_INFO("Hub: Unbound receiver.");
+	}
+
+	/**
+	 * @brief      Binds the ingest.
+	 */
+	void Hub::_bindIngest() {
+		TDRS_LOG_INFO("Hub: Binding ingest ...");
+		int _zmqIngestSocketLinger = 0;
+		_zmqIngestSocket.setsockopt(ZMQ_LINGER, &_zmqIngestSocketLinger, sizeof(_zmqIngestSocketLinger));
+		_zmqIngestSocket.setsockopt(ZMQ_RCVHWM, &_optionReceiverHwm, sizeof(_optionReceiverHwm));
+		_zmqIngestSocket.bind(_optionIngestListen);
+		TDRS_LOG_INFO("Hub: Bound ingest.");
+	}
+
+	/**
+	 * @brief      Unbinds (closes) the ingest.
+	 */
+	void Hub::_unbindIngest() {
+		TDRS_LOG_INFO("Hub: Unbinding ingest ...");
+		_zmqIngestSocket.close();
+		TDRS_LOG_INFO("Hub: Unbound ingest.");
+	}
+
+	/**
+	 * @brief      Binds the chain endpoint.
+	 */
+	void Hub::_bindChain() {
+		TDRS_LOG_INFO("Hub: Binding chain endpoint ...");
+		int _zmqChainSocketLinger = 0;
+		_zmqChainSocket.setsockopt(ZMQ_LINGER, &_zmqChainSocketLinger, sizeof(_zmqChainSocketLinger));
+		_zmqChainSocket.setsockopt(ZMQ_RCVHWM, &_optionChainHwm, sizeof(_optionChainHwm));
+		_zmqChainSocket.bind(TDRS_CHAIN_ENDPOINT);
+		TDRS_LOG_INFO("Hub: Bound chain endpoint.");
+	}
+
+	/**
+	 * @brief      Unbinds (closes) the chain endpoint.
+	 */
+	void Hub::_unbindChain() {
+		TDRS_LOG_INFO("Hub: Unbinding chain endpoint ...");
+		_zmqChainSocket.close();
+		TDRS_LOG_INFO("Hub: Unbound chain endpoint.");
+	}
+
+	/**
+	 * @brief      Binds the control endpoint.
+	 */
+	void Hub::_bindControl() {
+		TDRS_LOG_INFO("Hub: Binding control endpoint ...");
+		int _zmqControlSocketLinger = 0;
+		_zmqControlSocket.setsockopt(ZMQ_LINGER, &_zmqControlSocketLinger, sizeof(_zmqControlSocketLinger));
+		_zmqControlSocket.bind(TDRS_CONTROL_ENDPOINT);
+		TDRS_LOG_INFO("Hub: Bound control endpoint.");
+	}
+
+	/**
+	 * @brief      Unbinds (closes) the control endpoint.
+	 */
+	void Hub::_unbindControl() {
+		TDRS_LOG_INFO("Hub: Unbinding control endpoint ...");
+		_zmqControlSocket.close();
+		TDRS_LOG_INFO("Hub: Unbound control endpoint.");
+	}
+
+	/**
+	 * @brief      Binds the chain batch listener.
+	 */
+	void Hub::_bindChainBatch() {
+		TDRS_LOG_INFO("Hub: Binding chain batch listener ...");
+		int _zmqChainBatchSocketLinger = 0;
+		_zmqChainBatchSocket.setsockopt(ZMQ_LINGER, &_zmqChainBatchSocketLinger, sizeof(_zmqChainBatchSocketLinger));
+		_zmqChainBatchSocket.setsockopt(ZMQ_SNDHWM, &_optionChainHwm, sizeof(_optionChainHwm));
+		// Every link's (un)subscription counts, as links asking for the same spec share its batches
+		int _zmqChainBatchSocketVerboser = 1;
+		_zmqChainBatchSocket.setsockopt(ZMQ_XPUB_VERBOSER, &_zmqChainBatchSocketVerboser, sizeof(_zmqChainBatchSocketVerboser));
+		_zmqChainBatchSocket.bind(_optionChainBatchListen);
+		TDRS_LOG_INFO("Hub: Bound chain batch listener.");
+	}
+
+	/**
+	 * @brief      Unbinds (closes) the chain batch listener, sending the open
+	 * batches first.
+	 */
+	void Hub::_unbindChainBatch() {
+		TDRS_LOG_INFO("Hub: Unbinding chain batch listener ...");
+		_flushChainBatches(true);
+
+		std::map<std::string, HubChainBatcher*>::iterator batcher;
+		for(batcher = _chainBatchers.begin(); batcher != _chainBatchers.end(); batcher++) {
+			delete batcher->second;
+		}
+		_chainBatchers.clear();
+
+		_zmqChainBatchSocket.close();
+		TDRS_LOG_INFO("Hub: Unbound chain batch listener.");
+	}
+
+	/**
+	 * @brief      Binds the partition listener and the partition proxy
+	 * listener, if requested.
+	 */
+	void Hub::_bindPartition() {
+		if(!_optionPartitionListen.empty()) {
+			TDRS_LOG_INFO("Hub: Binding partition listener ...");
+			int _zmqPartitionSocketLinger = 0;
+			_zmqPartitionSocket.setsockopt(ZMQ_LINGER, &_zmqPartitionSocketLinger, sizeof(_zmqPartitionSocketLinger));
+			_zmqPartitionSocket.bind(_optionPartitionListen);
+			TDRS_LOG_INFO("Hub: Bound partition listener.");
+		}
+
+		if(!_optionPartitionProxyListen.empty()) {
+			TDRS_LOG_INFO("Hub: Binding partition proxy listener ...");
+			int _zmqPartitionProxySocketLinger = 0;
+			_zmqPartitionProxySocket.setsockopt(ZMQ_LINGER, &_zmqPartitionProxySocketLinger, sizeof(_zmqPartitionProxySocketLinger));
+			_zmqPartitionProxySocket.setsockopt(ZMQ_RCVHWM, &_optionReceiverHwm, sizeof(_optionReceiverHwm));
+			_zmqPartitionProxySocket.bind(_optionPartitionProxyListen);
+			TDRS_LOG_INFO("Hub: Bound partition proxy listener.");
+		}
+	}
+
+	/**
+	 * @brief      Unbinds (closes) the partition listener and the partition
+	 * proxy listener, along with the sockets proxying events to other hubs.
+	 */
+	void Hub::_unbindPartition() {
+		TDRS_LOG_INFO("Hub: Unbinding partition listener ...");
+		std::map<std::string, zmq::socket_t*>::iterator proxy;
+		for(proxy = _partitionProxySockets.begin(); proxy != _partitionProxySockets.end(); proxy++) {
+			proxy->second->close();
+			delete proxy->second;
+		}
+		_partitionProxySockets.clear();
+
+		_zmqPartitionSocket.close();
+		_zmqPartitionProxySocket.close();
+		TDRS_LOG_INFO("Hub: Unbound partition listener.");
+	}
+
+	/**
+	 * @brief      Creates the wakeup FIFO the co-located publishers wake up
+	 * the run-loop with, once it sleeps, and binds the local endpoint they
+	 * ask for their rings at.
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool Hub::_bindShm() {
+		TDRS_LOG_INFO("Hub: Binding shared-memory transport ...");
+		_shmWakePath = _optionShmDir + "/tdrs-" + HubOverlay::memberKey(_hubId) + ".wake";
+		_shmWakeFd = HubShmRing::openWake(_shmWakePath);
+		if(_shmWakeFd < 0) {
+			return false;
+		}
+
+		int _zmqShmSocketLinger = 0;
+		_zmqShmSocket.setsockopt(ZMQ_LINGER, &_zmqShmSocketLinger, sizeof(_zmqShmSocketLinger));
+		try {
+			_zmqShmSocket.bind(_optionShmListen);
+		} catch(...) {
+			TDRS_LOG_ERROR("Hub: Binding shared-memory endpoint " << _optionShmListen << " failed.");
+			close(_shmWakeFd);
+			_shmWakeFd = -1;
+			unlink(_shmWakePath.c_str());
+			return false;
+		}
+		TDRS_LOG_INFO("Hub: Bound shared-memory transport.");
+		return true;
+	}
+
+	/**
+	 * @brief      Removes all shared-memory rings, whether or not their
+	 * publishers closed them, and the wakeup FIFO.
+	 */
+	void Hub::_unbindShm() {
+		TDRS_LOG_INFO("Hub: Unbinding shared-memory transport ...");
+		BOOST_FOREACH(HubShmRing *ring, _shmRings) {
+			delete ring;
+		}
+		_shmRings.clear();
+
+		_zmqShmSocket.close();
+		close(_shmWakeFd);
+		_shmWakeFd = -1;
+		unlink(_shmWakePath.c_str());
+		TDRS_LOG_INFO("Hub: Unbound shared-memory transport.");
+	}
+
+	/**
+	 * @brief      Binds the metrics endpoint.
+	 */
+	void Hub::_bindMetrics() {
+		TDRS_LOG_INFO("Hub: Binding metrics endpoint ...");
+		int _zmqMetricsSocketLinger = 0;
+		_zmqMetricsSocket.setsockopt(ZMQ_LINGER, &_zmqMetricsSocketLinger, sizeof(_zmqMetricsSocketLinger));
+		_zmqMetricsSocket.bind(_optionMetricsListen);
+		TDRS_LOG_INFO("Hub: Bound metrics endpoint.");
+	}
+
+	/**
+	 * @brief      Unbinds (closes) the metrics endpoint.
+	 */
+	void Hub::_unbindMetrics() {
+		TDRS_LOG_INFO("Hub: Unbinding metrics endpoint ...");
+		_zmqMetricsSocket.close();
+		TDRS_LOG_INFO("Hub: Unbound metrics endpoint.");
 	}
 
 	/**
@@ -80,12 +365,15 @@ namespace tdrs {
 	 * @brief      Method for running discovery service threads.
 	 */
 	void Hub::_runDisoveryServiceThreads() {
-		std::cout << "Hub: Launching discovery service threads ..." << std::endl;
+		TDRS_LOG_INFO("Hub: Launching discovery service threads ...");
 
-		std::cout << "Hub: Launching discovery listener thread ..." << std::endl;
+		TDRS_LOG_INFO("Hub: Launching discovery listener thread ...");
 		_discoveryServiceListenerThreadInstance.params = new _discoveryServiceListenerParams;
+		_discoveryServiceListenerThreadInstance.params->context = &_zmqContext;
+		_discoveryServiceListenerThreadInstance.params->hubId = _hubId;
 		_discoveryServiceListenerThreadInstance.params->receiver = _rewriteReceiver(&_optionReceiverListen);
 		_discoveryServiceListenerThreadInstance.params->publisher = _optionPublisherListen;
+		_discoveryServiceListenerThreadInstance.params->proxy = _optionPartitionProxyListen;
 		_discoveryServiceListenerThreadInstance.params->interface = _optionDiscoveryInterface;
 		_discoveryServiceListenerThreadInstance.params->port = _optionDiscoveryPort;
 		_discoveryServiceListenerThreadInstance.params->interval = _optionDiscoveryInterval;
@@ -97,18 +385,140 @@ namespace tdrs {
 		pthread_attr_setdetachstate(&_discoveryServiceListenerThreadInstance.thattr, PTHREAD_CREATE_DETACHED);
 		pthread_create(&_discoveryServiceListenerThreadInstance.thread, &_discoveryServiceListenerThreadInstance.thattr, &Hub::_discoveryServiceListener, (void *)_discoveryServiceListenerThreadInstance.params);
 
-		std::cout << "Hub: Discovery service threads launched." << std::endl;
+		TDRS_LOG_INFO("Hub: Discovery service threads launched.");
 	}
 
 	/**
 	 * @brief      Method for shutting down all running discovery service threads.
 	 */
 	void Hub::_shutdownDisoveryServiceThreads() {
-		std::cout << "Hub: Shutting down discovery listener thread ..." << std::endl;
+		TDRS_LOG_INFO("Hub: Shutting down discovery listener thread ...");
 		_discoveryServiceListenerThreadInstance.params->run = false;
 		pthread_kill(_discoveryServiceListenerThreadInstance.thread, SIGINT);
 	}
 
+	/**
+	 * @brief      The ingest worker; static method instantiated as an own thread.
+	 *
+	 * Hashes the events of the jobs it is handed and registers them in the
+	 * shared message vector, then hands the jobs back for publishing.
+	 *
+	 * @param      ingestWorkerParams  The ingest worker parameters (struct)
+	 *
+	 * @return     NULL
+	 */
+	void *Hub::_ingestWorker(void *ingestWorkerParams) {
+		_ingestWorkerParams *params = static_cast<_ingestWorkerParams*>(ingestWorkerParams);
+		Hub *hub = params->hub;
+
+		zmq::socket_t jobsSocket(hub->_zmqContext, ZMQ_PULL);
+		jobsSocket.connect("inproc://tdrs-worker-" + std::to_string(params->id));
+		zmq::socket_t resultsSocket(hub->_zmqContext, ZMQ_PUSH);
+		resultsSocket.connect("inproc://tdrs-results");
+
+		while(true) {
+			_ingestJob *job = NULL;
+
+			try {
+				jobsSocket.recv(&job, sizeof(job));
+			} catch(...) {
+				continue;
+			}
+
+			// A NULL job requests the worker to exit
+			if(job == NULL) {
+				break;
+			}
+
+			hub->_hashMessages(job);
+			hub->_registerMessages(job);
+			job->hashedAt = Hub::monotonicTime();
+
+			resultsSocket.send(&job, sizeof(job));
+		}
+
+		jobsSocket.close();
+		resultsSocket.close();
+		return NULL;
+	}
+
+	/**
+	 * @brief      Method for running all ingest worker threads.
+	 */
+	void Hub::_runIngestWorkerThreads() {
+		TDRS_LOG_INFO("Hub: Launching " << _optionWorkers << " ingest worker threads ...");
+
+		int _zmqResultsSocketLinger = 0;
+		_zmqResultsSocket.setsockopt(ZMQ_LINGER, &_zmqResultsSocketLinger, sizeof(_zmqResultsSocketLinger));
+		_zmqResultsSocket.bind("inproc://tdrs-results");
+
+		// Signals are handled by the run-loop thread only
+		sigset_t signalSet, previousSignalSet;
+		sigemptyset(&signalSet);
+		sigaddset(&signalSet, SIGINT);
+		pthread_sigmask(SIG_BLOCK, &signalSet, &previousSignalSet);
+
+		for(int id = 0; id < _optionWorkers; id++) {
+			_zmqWorkerSockets.push_back(zmq::socket_t(_zmqContext, ZMQ_PUSH));
+			_zmqWorkerSockets.back().bind("inproc://tdrs-worker-" + std::to_string(id));
+
+			_ingestWorkerThread worker;
+			worker.params = new _ingestWorkerParams;
+			worker.params->id = id;
+			worker.params->hub = this;
+
+			pthread_attr_init(&worker.thattr);
+			pthread_attr_setdetachstate(&worker.thattr, PTHREAD_CREATE_JOINABLE);
+			pthread_create(&worker.thread, &worker.thattr, &Hub::_ingestWorker, (void *)worker.params);
+
+			_ingestWorkerThreads.push_back(worker);
+		}
+
+		pthread_sigmask(SIG_SETMASK, &previousSignalSet, NULL);
+
+		TDRS_LOG_INFO("Hub: Ingest worker threads launched.");
+	}
+
+	/**
+	 * @brief      Method for shutting down all running ingest worker threads.
+	 */
+	void Hub::_shutdownIngestWorkerThreads() {
+		TDRS_LOG_INFO("Hub: Shutting down ingest worker threads ...");
+
+		for(size_t id = 0; id < _ingestWorkerThreads.size(); id++) {
+			_ingestJob *job = NULL;
+			_zmqWorkerSockets[id].send(&job, sizeof(job));
+		}
+
+		BOOST_FOREACH(_ingestWorkerThread worker, _ingestWorkerThreads) {
+			pthread_join(worker.thread, NULL);
+			pthread_attr_destroy(&worker.thattr);
+			delete worker.params;
+		}
+		_ingestWorkerThreads.clear();
+
+		BOOST_FOREACH(zmq::socket_t &workerSocket, _zmqWorkerSockets) {
+			workerSocket.close();
+		}
+		_zmqWorkerSockets.clear();
+
+		// Jobs the workers finished after the last results were served, or
+		// still waiting for their predecessors, will not be published anymore
+		_ingestJob *finished = NULL;
+		while(_zmqResultsSocket.recv(&finished, sizeof(finished), ZMQ_DONTWAIT) == sizeof(finished)) {
+			delete finished;
+		}
+
+		std::map<uint64_t, _ingestJob*>::iterator backlogged;
+		for(backlogged = _ingestBacklog.begin(); backlogged != _ingestBacklog.end(); backlogged++) {
+			delete backlogged->second;
+		}
+		_ingestBacklog.clear();
+		_zmqResultsSocket.close();
+
+		TDRS_LOG_INFO("Hub: Ingest worker threads shut down.");
+	}
+
 	/**
 	 * @brief      The chain client; static method instantiated as an own thread.
 	 *
@@ -118,31 +528,251 @@ namespace tdrs {
 	 */
 	void *Hub::_chainClient(void *chainClientParams) {
 		_chainClientParams *params = static_cast<_chainClientParams*>(chainClientParams);
-		tdrs::HubChainClient hubChainClient(1, params);
 
-		pthread_cleanup_push(&Hub::_chainClientCleanup, chainClientParams);
+		{
+			tdrs::HubChainClient hubChainClient(params->context, params);
+			hubChainClient.run();
+		}
+
+		// Its sockets are closed, the thread can be joined right away
+		params->stopped = true;
+		return NULL;
+	}
+
+	/**
+	 * @brief      Method for joining one chain client thread that was
+	 * requested to stop, releasing its parameters.
+	 *
+	 * The chain client notices the request within TDRS_CHAIN_POLL_INTERVAL
+	 * and closes its sockets itself, before the hub's context goes away.
+	 *
+	 * @param      client  The chain client thread struct
+	 */
+	void Hub::_joinChainClientThread(_chainClientThread &client) {
+		pthread_join(client.thread, NULL);
+		pthread_attr_destroy(&client.thattr);
+		TDRS_LOG_INFO("Hub: Shut down chain client thread for link " << client.params->link << ".");
+		delete client.params;
+	}
+
+	/**
+	 * @brief      Method for joining the chain client threads that were
+	 * requested to stop. The run-loop only joins the ones that stopped
+	 * already, so a link going away never stalls it.
+	 *
+	 * @param[in]  wait  Whether to wait for all of them, or only join the
+	 * ones that stopped already
+	 */
+	void Hub::_reapChainClientThreads(bool wait) {
+		std::vector<_chainClientThread>::iterator client = _stoppingChainClientThreads.begin();
+		while(client != _stoppingChainClientThreads.end()) {
+			if(wait || client->params->stopped) {
+				_joinChainClientThread(*client);
+				client = _stoppingChainClientThreads.erase(client);
+			} else {
+				client++;
+			}
+		}
+	}
+
+	/**
+	 * @brief      Method for stopping one chain client, handing its thread
+	 * over to be joined once it stopped or unregistering it from the chain
+	 * reactor. Either way, its parameters must not be used afterwards.
+	 *
+	 * @param      client  The chain client thread struct
+	 */
+	void Hub::_stopChainClient(_chainClientThread &client) {
+		client.params->run = false;
+
+		if(_optionChainReactor) {
+			_chainReactorCommand command;
+			command.add = false;
+			command.params = client.params;
+			_zmqChainReactorSocket.send(&command, sizeof(command));
+		} else {
+			_stoppingChainClientThreads.push_back(client);
+		}
+	}
+
+	/**
+	 * @brief      The chain reactor; static method instantiated as an own thread.
+	 *
+	 * @param      chainReactorParams  The chain reactor parameters (struct)
+	 *
+	 * @return     NULL
+	 */
+	void *Hub::_chainReactor(void *chainReactorParams) {
+		_chainReactorParams *params = static_cast<_chainReactorParams*>(chainReactorParams);
+		tdrs::HubChainReactor hubChainReactor(params->context);
 
-		hubChainClient.run();
+		hubChainReactor.run();
 
-		pthread_cleanup_pop(0);
 		return NULL;
 	}
 
 	/**
-	 * @brief      The chain client cleanup; static method for cleaning up the thread.
+	 * @brief      Method for running the chain reactor thread, which serves
+	 * all chain links instead of one thread per link.
+	 */
+	void Hub::_runChainReactorThread() {
+		TDRS_LOG_INFO("Hub: Launching chain reactor thread ...");
+
+		int _zmqChainReactorSocketLinger = 0;
+		_zmqChainReactorSocket.setsockopt(ZMQ_LINGER, &_zmqChainReactorSocketLinger, sizeof(_zmqChainReactorSocketLinger));
+		_zmqChainReactorSocket.bind(TDRS_CHAIN_REACTOR_ENDPOINT);
+
+		_chainReactorThreadInstance.params = new _chainReactorParams;
+		_chainReactorThreadInstance.params->context = &_zmqContext;
+
+		// Signals are handled by the run-loop thread only
+		sigset_t signalSet, previousSignalSet;
+		sigemptyset(&signalSet);
+		sigaddset(&signalSet, SIGINT);
+		pthread_sigmask(SIG_BLOCK, &signalSet, &previousSignalSet);
+
+		pthread_attr_init(&_chainReactorThreadInstance.thattr);
+		pthread_attr_setdetachstate(&_chainReactorThreadInstance.thattr, PTHREAD_CREATE_JOINABLE);
+		pthread_create(&_chainReactorThreadInstance.thread, &_chainReactorThreadInstance.thattr, &Hub::_chainReactor, (void *)_chainReactorThreadInstance.params);
+
+		pthread_sigmask(SIG_SETMASK, &previousSignalSet, NULL);
+
+		TDRS_LOG_INFO("Hub: Launched chain reactor thread.");
+	}
+
+	/**
+	 * @brief      Method for shutting down the chain reactor thread.
+	 */
+	void Hub::_shutdownChainReactorThread() {
+		TDRS_LOG_INFO("Hub: Shutting down chain reactor thread ...");
+
+		_chainReactorCommand command;
+		command.add = false;
+		command.params = NULL;
+		_zmqChainReactorSocket.send(&command, sizeof(command));
+
+		pthread_join(_chainReactorThreadInstance.thread, NULL);
+		pthread_attr_destroy(&_chainReactorThreadInstance.thattr);
+		delete _chainReactorThreadInstance.params;
+		_zmqChainReactorSocket.close();
+
+		TDRS_LOG_INFO("Hub: Shut down chain reactor thread.");
+	}
+
+	/**
+	 * @brief      The replay server; static method instantiated as an own thread.
 	 *
-	 * @param      chainClientParams  The chain client parameters (struct)
+	 * @param      replayServerParams  The replay server parameters (struct)
 	 *
 	 * @return     NULL
 	 */
-	void Hub::_chainClientCleanup(void *chainClientParams) {
-		_chainClientParams *params = static_cast<_chainClientParams*>(chainClientParams);
+	void *Hub::_replayServer(void *replayServerParams) {
+		_replayServerParams *params = static_cast<_replayServerParams*>(replayServerParams);
+		tdrs::HubReplayServer hubReplayServer(params);
+
+		hubReplayServer.run();
+
+		return NULL;
+	}
+
+	/**
+	 * @brief      Method for running the replay server thread, streaming the
+	 * journal to clients apart from the run-loop.
+	 */
+	void Hub::_runReplayServerThread() {
+		TDRS_LOG_INFO("Hub: Launching replay server thread ...");
+
+		_replayServerThreadInstance.params = new _replayServerParams;
+		_replayServerThreadInstance.params->context = &_zmqContext;
+		_replayServerThreadInstance.params->journal = &_journal;
+		_replayServerThreadInstance.params->listen = _optionReplayListen;
+		_replayServerThreadInstance.params->run = true;
+
+		// Signals are handled by the run-loop thread only
+		sigset_t signalSet, previousSignalSet;
+		sigemptyset(&signalSet);
+		sigaddset(&signalSet, SIGINT);
+		pthread_sigmask(SIG_BLOCK, &signalSet, &previousSignalSet);
+
+		pthread_attr_init(&_replayServerThreadInstance.thattr);
+		pthread_attr_setdetachstate(&_replayServerThreadInstance.thattr, PTHREAD_CREATE_JOINABLE);
+		pthread_create(&_replayServerThreadInstance.thread, &_replayServerThreadInstance.thattr, &Hub::_replayServer, (void *)_replayServerThreadInstance.params);
+
+		pthread_sigmask(SIG_SETMASK, &previousSignalSet, NULL);
 
-		std::cout << "Chain[" << params->link << "]: Thread cancelled! Cleaning up ..." << std::endl;
-		params->subscriberSocket->close();
-		params->senderSocket->close();
-		delete params;
-		std::cout << "Chain[cleaned]: Thread cleaned up." << std::endl;
+		TDRS_LOG_INFO("Hub: Launched replay server thread.");
+	}
+
+	/**
+	 * @brief      Method for shutting down the replay server thread.
+	 */
+	void Hub::_shutdownReplayServerThread() {
+		TDRS_LOG_INFO("Hub: Shutting down replay server thread ...");
+
+		_replayServerThreadInstance.params->run = false;
+		pthread_join(_replayServerThreadInstance.thread, NULL);
+		pthread_attr_destroy(&_replayServerThreadInstance.thattr);
+		delete _replayServerThreadInstance.params;
+
+		TDRS_LOG_INFO("Hub: Shut down replay server thread.");
+	}
+
+	/**
+	 * @brief      The snapshot server; static method instantiated as an own thread.
+	 *
+	 * @param      snapshotServerParams  The snapshot server parameters (struct)
+	 *
+	 * @return     NULL
+	 */
+	void *Hub::_snapshotServer(void *snapshotServerParams) {
+		_snapshotServerParams *params = static_cast<_snapshotServerParams*>(snapshotServerParams);
+		tdrs::HubSnapshotServer hubSnapshotServer(params);
+
+		hubSnapshotServer.run();
+
+		return NULL;
+	}
+
+	/**
+	 * @brief      Method for running the snapshot server thread, sending the
+	 * last-value cache to clients apart from the run-loop.
+	 */
+	void Hub::_runSnapshotServerThread() {
+		TDRS_LOG_INFO("Hub: Launching snapshot server thread ...");
+
+		_snapshotServerThreadInstance.params = new _snapshotServerParams;
+		_snapshotServerThreadInstance.params->context = &_zmqContext;
+		_snapshotServerThreadInstance.params->cache = &_lastValueCache;
+		_snapshotServerThreadInstance.params->listen = _optionSnapshotListen;
+		_snapshotServerThreadInstance.params->run = true;
+
+		// Signals are handled by the run-loop thread only
+		sigset_t signalSet, previousSignalSet;
+		sigemptyset(&signalSet);
+		sigaddset(&signalSet, SIGINT);
+		pthread_sigmask(SIG_BLOCK, &signalSet, &previousSignalSet);
+
+		pthread_attr_init(&_snapshotServerThreadInstance.thattr);
+		pthread_attr_setdetachstate(&_snapshotServerThreadInstance.thattr, PTHREAD_CREATE_JOINABLE);
+		pthread_create(&_snapshotServerThreadInstance.thread, &_snapshotServerThreadInstance.thattr, &Hub::_snapshotServer, (void *)_snapshotServerThreadInstance.params);
+
+		pthread_sigmask(SIG_SETMASK, &previousSignalSet, NULL);
+
+		TDRS_LOG_INFO("Hub: Launched snapshot server thread.");
+	}
+
+	/**
+	 * @brief      Method for shutting down the snapshot server thread.
+	 */
+	void Hub::_shutdownSnapshotServerThread() {
+		TDRS_LOG_INFO("Hub: Shutting down snapshot server thread ...");
+
+		_snapshotServerThreadInstance.params->run = false;
+		pthread_join(_snapshotServerThreadInstance.thread, NULL);
+		pthread_attr_destroy(&_snapshotServerThreadInstance.thattr);
+		delete _snapshotServerThreadInstance.params;
+
+		TDRS_LOG_INFO("Hub: Shut down snapshot server thread.");
 	}
 
 	/**
@@ -161,31 +791,66 @@ namespace tdrs {
 		}
 
 		if(foundId) {
-			std::cout << "Hub: Not launching chain client thread for link " << link << " as was launched already." << std::endl;
+			TDRS_LOG_INFO("Hub: Not launching chain client thread for link " << link << " as was launched already.");
 			return;
 		}
 
-		std::cout << "Hub: Launching chain client thread for link " << link << " ..." << std::endl;
+		TDRS_LOG_INFO("Hub: Launching chain client thread for link " << link << " ...");
 
 		_chainClientThread client;
 		client.params = new _chainClientParams;
 
-		client.params->shmsgvecmtx = &_sharedMessageVectorMutex;
-		client.params->shmsgvec = &_sharedMessageVector;
+		client.params->context = &_zmqContext;
+		client.params->dedupIndexMutex = &_dedupIndexMutex;
+		client.params->dedupIndex = &_dedupIndex;
 		client.params->id = id;
 		client.params->link = link;
+		if(!Hub::parseChainLink(link, &client.params->endpoint, &client.params->batched, &client.params->batch)) {
+			TDRS_LOG_ERROR("Hub: Not launching chain client thread for invalid link " << link << ".");
+			delete client.params;
+			return;
+		}
 
-		client.params->receiver = _rewriteReceiver(&_optionReceiverListen);
+		pthread_mutex_lock(&_dedupIndexMutex);
+		client.params->linkId = _dedupIndex.linkId(link);
+		pthread_mutex_unlock(&_dedupIndexMutex);
+		client.params->fingerprint = _optionFingerprint;
+		client.params->hubId = _hubId;
+		client.params->maxHops = _optionChainMaxHops;
+		client.params->hwm = _optionChainHwm;
+		client.params->heartbeatInterval = _optionChainHeartbeatInterval;
+		client.params->heartbeatTimeout = _optionChainHeartbeatTimeout;
+		client.params->reconnectMax = _optionChainReconnectMax;
+		client.params->forwarded = 0;
+		client.params->discarded = 0;
+		client.params->state = TDRS_CHAIN_LINK_UP;
+		client.params->reconnects = 0;
+		client.params->chainLinkIds = &_chainLinkIds;
+		client.params->sequenceWindow = &_sequenceWindow;
+		client.params->subscriptionTableMutex = &_subscriptionTableMutex;
+		client.params->subscriptionTable = (_optionChainSubscriptions ? &_subscriptionTable : NULL);
 
 		client.params->run = true;
+		client.params->stopped = false;
 
-		pthread_attr_init(&client.thattr);
-		pthread_attr_setdetachstate(&client.thattr, PTHREAD_CREATE_DETACHED);
-		pthread_create(&client.thread, &client.thattr, &Hub::_chainClient, (void *)client.params);
+		if(_optionChainReactor) {
+			_chainReactorCommand command;
+			command.add = true;
+			command.params = client.params;
+			_zmqChainReactorSocket.send(&command, sizeof(command));
+		} else {
+			pthread_attr_init(&client.thattr);
+			pthread_attr_setdetachstate(&client.thattr, PTHREAD_CREATE_JOINABLE);
+			pthread_create(&client.thread, &client.thattr, &Hub::_chainClient, (void *)client.params);
+		}
 
 		_chainClientThreads.push_back(client);
 
-		std::cout << "Hub: Launched chain client thread for link " << link << "." << std::endl;
+		pthread_mutex_lock(&_dedupIndexMutex);
+		_chainLinkIds.push_back(client.params->linkId);
+		pthread_mutex_unlock(&_dedupIndexMutex);
+
+		TDRS_LOG_INFO("Hub: Launched chain client thread for link " << link << ".");
 		return;
 	}
 
@@ -209,34 +874,54 @@ namespace tdrs {
 	 * @brief      Method for shutting down one running chain client thread.
 	 */
 	bool Hub::_shutdownChainClientThread(std::string id) {
-		bool wasShutDown = false;
-
-		BOOST_FOREACH(_chainClientThread client, _chainClientThreads) {
-			if(client.params->id == id) {
-				std::cout << "Hub: Shutting down chain client thread for link " << client.params->link << " ..." << std::endl;
-
-				client.params->run = false;
+		std::vector<_chainClientThread>::iterator client;
 
-				pthread_cancel(client.thread);
-				wasShutDown = true;
+		for(client = _chainClientThreads.begin(); client != _chainClientThreads.end(); client++) {
+			if(client->params->id == id) {
 				break;
 			}
 		}
 
-		return wasShutDown;
+		if(client == _chainClientThreads.end()) {
+			return false;
+		}
+
+		TDRS_LOG_INFO("Hub: Shutting down chain client thread for link " << client->params->link << " ...");
+
+		// Stopped first, so a link coming back up does not add itself again
+		client->params->run = false;
+
+		pthread_mutex_lock(&_dedupIndexMutex);
+		std::vector<uint32_t>::iterator chainLinkId = std::find(_chainLinkIds.begin(), _chainLinkIds.end(), client->params->linkId);
+		if(chainLinkId != _chainLinkIds.end()) {
+			_chainLinkIds.erase(chainLinkId);
+		}
+		_dedupIndex.removeLink(client->params->linkId);
+		pthread_mutex_unlock(&_dedupIndexMutex);
+
+		_stopChainClient(*client);
+		_chainClientThreads.erase(client);
+
+		return true;
 	}
 
 	/**
 	 * @brief      Method for shutting down all running chain client threads.
 	 */
 	void Hub::_shutdownChainClientThreads() {
-		BOOST_FOREACH(_chainClientThread client, _chainClientThreads) {
-			std::cout << "Hub: Shutting down chain client thread for link " << client.params->link << " ..." << std::endl;
-
+		// Request all of them to stop first, so they wind down in parallel
+		BOOST_FOREACH(_chainClientThread &client, _chainClientThreads) {
+			TDRS_LOG_INFO("Hub: Shutting down chain client thread for link " << client.params->link << " ...");
 			client.params->run = false;
+		}
 
-			pthread_cancel(client.thread);
+		BOOST_FOREACH(_chainClientThread &client, _chainClientThreads) {
+			_stopChainClient(client);
 		}
+		_chainClientThreads.clear();
+
+		// Including the ones stopped earlier, before the context goes away
+		_reapChainClientThreads(true);
 	}
 
 	/**
@@ -247,51 +932,287 @@ namespace tdrs {
 	 * @return     The hash.
 	 */
 	std::string Hub::hashString(std::string *source) {
+		return Hub::hashData(source->data(), source->size());
+	}
+
+	/**
+	 * @brief      Static method for hashing a buffer in place using SHA1.
+	 *
+	 * @param[in]  data  The data
+	 * @param[in]  size  The size of the data
+	 *
+	 * @return     The hash.
+	 */
+	std::string Hub::hashData(const void *data, size_t size) {
+		static const char hexDigits[] = "0123456789ABCDEF";
+		unsigned char digest[CryptoPP::SHA1::DIGESTSIZE];
 		CryptoPP::SHA1 sha1;
-		std::string hashed = "";
 
-		CryptoPP::StringSource(*source, true, new CryptoPP::HashFilter(sha1, new CryptoPP::HexEncoder(new CryptoPP::StringSink(hashed))));
+		sha1.CalculateDigest(digest, static_cast<const unsigned char*>(data), size);
+
+		std::string hashed(2 * sizeof(digest), '0');
+		for(size_t index = 0; index < sizeof(digest); index++) {
+			hashed[2 * index] = hexDigits[digest[index] >> 4];
+			hashed[2 * index + 1] = hexDigits[digest[index] & 0x0f];
+		}
 
 		return hashed;
 	}
 
 	/**
-	 * @brief      Method for rewriting a receiver address if necessarry.
+	 * @brief      Static method for fingerprinting a buffer in place, for the
+	 * dedup index.
 	 *
-	 * @param      receiver  The receiver address
+	 * @param[in]  data         The data
+	 * @param[in]  size         The size of the data
+	 * @param[in]  fingerprint  The fingerprint, one of TDRS_FINGERPRINT_*
 	 *
-	 * @return     The rewritten address
+	 * @return     The fingerprint; the SHA1 hex hash or the binary XXH3 128 bit digest.
 	 */
-	std::string Hub::_rewriteReceiver(std::string *receiver) {
-		std::regex receiverReplaceRegex("(\\*|0\\.0\\.0\\.0)");
-		return std::regex_replace(_optionReceiverListen, receiverReplaceRegex, "127.0.0.1");
+	std::string Hub::fingerprintData(const void *data, size_t size, int fingerprint) {
+		if(fingerprint == TDRS_FINGERPRINT_SHA1) {
+			return Hub::hashData(data, size);
+		}
+
+		XXH128_canonical_t digest;
+		XXH128_canonicalFromHash(&digest, XXH3_128bits(data, size));
+
+		return std::string(reinterpret_cast<const char*>(digest.digest), sizeof(digest.digest));
 	}
 
 	/**
-	 * @brief      Static method for parsing a peer message into
-	 * peerMessage type.
+	 * @brief      Static method for parsing a chain envelope frame.
 	 *
-	 * @param[in]  message  The message
+	 * @param[in]  message   The frame
+	 * @param      envelope  The parsed envelope
 	 *
-	 * @return     The peerMessage
+	 * @return     True if the frame is a chain envelope, false otherwise.
 	 */
-	peerMessage *Hub::_parsePeerMessage(const std::string &message) {
-		// PEER:<event>:<id>:<pub proto>:<pub addr>:<pub port>:<sub proto>:<sub addr>:<sub port>
-		std::regex messageSearchRegex("PEER:([a-zA-Z]+):([a-zA-Z0-9]+):([a-zA-Z\\*]+):([0-9\\.\\*]+):([0-9\\*]+):([a-zA-Z\\*]+):([0-9\\.\\*]+):([0-9\\*]+)");
-		std::smatch match;
+	bool Hub::parseEnvelope(const zmq::message_t &message, chainEnvelope *envelope) {
+		const unsigned char *data = static_cast<const unsigned char*>(const_cast<zmq::message_t&>(message).data());
+
+		if(message.size() != TDRS_ENVELOPE_SIZE
+			|| memcmp(data, TDRS_ENVELOPE_MAGIC, 4) != 0
+			|| data[4] != TDRS_ENVELOPE_VERSION) {
+			return false;
+		}
+
+		envelope->hops = data[5];
+		envelope->origin = 0;
+		envelope->sequence = 0;
+		envelope->relay = 0;
+		envelope->previousRelay = 0;
+		for(size_t index = 0; index < 8; index++) {
+			envelope->origin = (envelope->origin << 8) | data[8 + index];
+			envelope->sequence = (envelope->sequence << 8) | data[16 + index];
+			envelope->relay = (envelope->relay << 8) | data[24 + index];
+			envelope->previousRelay = (envelope->previousRelay << 8) | data[32 + index];
+		}
+
+		return true;
+	}
 
-		if(std::regex_search(message.begin(), message.end(), match, messageSearchRegex)) {
-			peerMessage *pm = new peerMessage;
+	/**
+	 * @brief      Static method for building a chain envelope frame.
+	 *
+	 * @param[in]  envelope  The envelope
+	 * @param      message   The frame
+	 */
+	void Hub::buildEnvelope(const chainEnvelope &envelope, zmq::message_t *message) {
+		message->rebuild(TDRS_ENVELOPE_SIZE);
+		unsigned char *data = static_cast<unsigned char*>(message->data());
+
+		memcpy(data, TDRS_ENVELOPE_MAGIC, 4);
+		data[4] = TDRS_ENVELOPE_VERSION;
+		data[5] = envelope.hops;
+		data[6] = 0;
+		data[7] = 0;
+		for(size_t index = 0; index < 8; index++) {
+			data[15 - index] = (unsigned char)(envelope.origin >> (8 * index));
+			data[23 - index] = (unsigned char)(envelope.sequence >> (8 * index));
+			data[31 - index] = (unsigned char)(envelope.relay >> (8 * index));
+			data[39 - index] = (unsigned char)(envelope.previousRelay >> (8 * index));
+		}
+	}
+
+	/**
+	 * @brief      Static method for parsing an offset frame.
+	 *
+	 * @param[in]  message  The frame
+	 * @param      offset   The parsed journal offset
+	 *
+	 * @return     True if the frame is an offset frame, false otherwise.
+	 */
+	bool Hub::parseOffset(const zmq::message_t &message, uint64_t *offset) {
+		const unsigned char *data = static_cast<const unsigned char*>(const_cast<zmq::message_t&>(message).data());
 
-			pm->event = match[1];
-			pm->id = match[2];
-			pm->publisher = match[3].str() + "://" + match[4].str() + (match[5].str() != "" ? (":" + match[5].str()) : "");
-			pm->receiver = match[6].str() + "://" + match[7].str() + (match[8].str() != "" ? (":" + match[8].str()) : "");
+		if(message.size() != TDRS_OFFSET_SIZE || memcmp(data, TDRS_OFFSET_MAGIC, 4) != 0) {
+			return false;
+		}
 
-			return pm;
+		*offset = 0;
+		for(size_t index = 4; index < TDRS_OFFSET_SIZE; index++) {
+			*offset = (*offset << 8) | data[index];
 		}
 
-		return NULL;
+		return true;
+	}
+
+	/**
+	 * @brief      Static method for building an offset frame.
+	 *
+	 * @param[in]  offset   The journal offset
+	 * @param      message  The frame
+	 */
+	void Hub::buildOffset(uint64_t offset, zmq::message_t *message) {
+		message->rebuild(TDRS_OFFSET_SIZE);
+		unsigned char *data = static_cast<unsigned char*>(message->data());
+
+		memcpy(data, TDRS_OFFSET_MAGIC, 4);
+		for(size_t index = 0; index < 8; index++) {
+			data[11 - index] = (unsigned char)(offset >> (8 * index));
+		}
+	}
+
+	/**
+	 * @brief      Static method for sending one message to a client of a
+	 * ROUTER socket, prefixed by its routing frames. The socket has
+	 * ZMQ_ROUTER_MANDATORY set, so a client that cannot keep up is waited
+	 * for, one send timeout at a time, instead of losing frames; after
+	 * TDRS_ROUTER_SEND_RETRIES timeouts, or once shutting down, it is given
+	 * up on.
+	 *
+	 * @param      socket   The socket
+	 * @param      routing  The routing frames
+	 * @param      frames   The frames
+	 * @param[in]  run      The server's run-loop variable
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool Hub::sendRouted(zmq::socket_t &socket, std::vector<zmq::message_t> &routing, std::vector<zmq::message_t> &frames, const std::atomic<bool> &run) {
+		size_t count = routing.size() + frames.size();
+
+		try {
+			for(size_t frame = 0; frame < count; frame++) {
+				zmq::message_t copy;
+				zmq::message_t *message = &copy;
+				if(frame < routing.size()) {
+					copy.copy(&routing[frame]);
+				} else {
+					message = &frames[frame - routing.size()];
+				}
+
+				int retries = 0;
+				while(!socket.send(*message, (frame + 1 < count ? ZMQ_SNDMORE : 0))) {
+					if(run == false || ++retries >= TDRS_ROUTER_SEND_RETRIES) {
+						return false;
+					}
+				}
+			}
+		} catch(...) {
+			// The client is gone
+			return false;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief      Static method for parsing a control message frame.
+	 *
+	 * @param[in]  message  The frame
+	 * @param      peer     The parsed peer announcement
+	 *
+	 * @return     True if the frame is a valid control message, false otherwise.
+	 */
+	bool Hub::parseControl(const zmq::message_t &message, peerMessage *peer) {
+		const unsigned char *data = static_cast<const unsigned char*>(const_cast<zmq::message_t&>(message).data());
+		size_t size = message.size();
+
+		if(size < TDRS_CONTROL_HEADER_SIZE
+			|| memcmp(data, TDRS_CONTROL_MAGIC, 4) != 0
+			|| data[4] != TDRS_CONTROL_VERSION
+			|| (data[5] != TDRS_CONTROL_PEER_ENTER && data[5] != TDRS_CONTROL_PEER_EXIT)) {
+			return false;
+		}
+
+		peer->event = data[5];
+
+		std::string *fields[] = { &peer->id, &peer->publisher, &peer->receiver, &peer->key, &peer->proxy };
+		size_t offset = TDRS_CONTROL_HEADER_SIZE;
+		BOOST_FOREACH(std::string *field, fields) {
+			if(offset + 2 > size) {
+				return false;
+			}
+
+			size_t length = ((size_t)data[offset] << 8) | data[offset + 1];
+			offset += 2;
+			if(offset + length > size) {
+				return false;
+			}
+
+			field->assign(reinterpret_cast<const char*>(data + offset), length);
+			offset += length;
+		}
+
+		return offset == size;
+	}
+
+	/**
+	 * @brief      Static method for building a control message frame. Fields
+	 * longer than 65535 bytes are cut off.
+	 *
+	 * @param[in]  peer     The peer announcement
+	 * @param      message  The frame
+	 */
+	void Hub::buildControl(const peerMessage &peer, zmq::message_t *message) {
+		const std::string *fields[] = { &peer.id, &peer.publisher, &peer.receiver, &peer.key, &peer.proxy };
+		size_t lengths[5];
+		size_t size = TDRS_CONTROL_HEADER_SIZE;
+
+		for(size_t field = 0; field < 5; field++) {
+			lengths[field] = std::min(fields[field]->size(), (size_t)0xffff);
+			size += 2 + lengths[field];
+		}
+
+		message->rebuild(size);
+		unsigned char *data = static_cast<unsigned char*>(message->data());
+
+		memcpy(data, TDRS_CONTROL_MAGIC, 4);
+		data[4] = TDRS_CONTROL_VERSION;
+		data[5] = peer.event;
+		data[6] = 0;
+		data[7] = 0;
+
+		size_t offset = TDRS_CONTROL_HEADER_SIZE;
+		for(size_t field = 0; field < 5; field++) {
+			data[offset] = (unsigned char)(lengths[field] >> 8);
+			data[offset + 1] = (unsigned char)lengths[field];
+			memcpy(data + offset + 2, fields[field]->data(), lengths[field]);
+			offset += 2 + lengths[field];
+		}
+	}
+
+	/**
+	 * @brief      Static method returning the current monotonic time, for
+	 * latency metrics.
+	 *
+	 * @return     The time (ns).
+	 */
+	uint64_t Hub::monotonicTime() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	 * @brief      Method for rewriting a receiver address if necessarry.
+	 *
+	 * @param      receiver  The receiver address
+	 *
+	 * @return     The rewritten address
+	 */
+	std::string Hub::_rewriteReceiver(std::string *receiver) {
+		std::regex receiverReplaceRegex("(\\*|0\\.0\\.0\\.0)");
+		return std::regex_replace(_optionReceiverListen, receiverReplaceRegex, "127.0.0.1");
 	}
 
 	/**
@@ -319,6 +1240,74 @@ namespace tdrs {
 		return NULL;
 	}
 
+	/**
+	 * @brief      Static method for parsing a chain link, an address optionally
+	 * followed by the batch spec of a batched link, e.g.
+	 * `tcp://10.0.0.2:19892?codec=zstd&batch-size=65536&batch-window=500`.
+	 * Parameters left out take their defaults.
+	 *
+	 * @param[in]  link      The link
+	 * @param      endpoint  The address
+	 * @param      batched   Whether the link is batched
+	 * @param      spec      The batch spec
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool Hub::parseChainLink(const std::string &link, std::string *endpoint, bool *batched, chainBatchSpec *spec) {
+		size_t query = link.find('?');
+
+		*endpoint = link.substr(0, query);
+		*batched = (query != std::string::npos);
+		spec->codec = TDRS_CHAIN_BATCH_DEFAULT_CODEC;
+		spec->size = TDRS_CHAIN_BATCH_DEFAULT_SIZE;
+		spec->window = TDRS_CHAIN_BATCH_DEFAULT_WINDOW;
+
+		if(endpoint->empty()) {
+			return false;
+		}
+
+		if(!*batched) {
+			return true;
+		}
+
+		std::istringstream parameters(link.substr(query + 1));
+		std::string parameter;
+		while(std::getline(parameters, parameter, '&')) {
+			size_t equals = parameter.find('=');
+			if(parameter.empty()) {
+				continue;
+			} else if(equals == std::string::npos) {
+				return false;
+			}
+
+			std::string name = parameter.substr(0, equals);
+			std::string value = parameter.substr(equals + 1);
+			char *end = NULL;
+			unsigned long number = strtoul(value.c_str(), &end, 10);
+			bool numeric = (!value.empty() && end != NULL && *end == '\0' && value[0] != '-');
+
+			if(name == "codec") {
+				if(!HubChainBatcher::parseCodec(value, &spec->codec)) {
+					return false;
+				}
+			} else if(name == "batch-size") {
+				if(!numeric || number == 0 || number > TDRS_CHAIN_BATCH_MAX_SIZE) {
+					return false;
+				}
+				spec->size = (uint32_t)number;
+			} else if(name == "batch-window") {
+				if(!numeric || number > UINT32_MAX) {
+					return false;
+				}
+				spec->window = (uint32_t)number;
+			} else {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
 	/**
 	 * @brief      Sets the Hub options.
 	 *
@@ -333,14 +1322,55 @@ namespace tdrs {
 			optionsDescription.add_options()
 				("help", "show this usage information")
 				("receiver-listen", bpo::value<std::string>(), "set listener for receiver")
+				("receiver-mode", bpo::value<std::string>(), "set the receiver mode, either 'rep' or 'router' (pipelined, acks carry a correlation id), default 'rep', or 'router' with --workers above 1")
+				("ingest-listen", bpo::value<std::string>(), "set listener for fire-and-forget (PUSH/PULL) ingest, optional")
+				("workers", bpo::value<int>(), "set the number of ingest worker threads hashing and registering events, default 1; more than 1 require --receiver-mode router, which they default to")
+				("dedup-max-entries", bpo::value<size_t>(), "set the maximum number of entries of the chain dedup index, default 1000000")
+				("dedup-max-memory", bpo::value<size_t>(), "set the maximum memory (MB) used by the chain dedup index, default 256")
+				("dedup-ttl", bpo::value<uint64_t>(), "set the time (ms) after which unmatched chain dedup index entries expire, default 60000")
+				("fingerprint", bpo::value<std::string>(), "set the fingerprint identifying events in the chain dedup index, either 'sha1' or 'xxh3', default 'sha1'")
+				("chain-envelope", "stamp published events with a chain envelope (origin hub and sequence number), deduplicating chained events by origin instead of by fingerprint")
+				("chain-max-hops", bpo::value<int>(), "set the maximum number of times an enveloped event is relayed between hubs, default 16")
+				("chain-subscriptions", "let chain links only pull the topics subscribers of this hub are interested in")
+				("chain-reactor", "serve all chain links on a single reactor thread, instead of one thread per link")
 				("publisher-listen", bpo::value<std::string>(), "set listener for publisher")
-				("chain-link", bpo::value<std::vector<std::string> >(&_optionChainLinks)->multitoken(), "add a chain link, specify one per link")
+				("metrics-listen", bpo::value<std::string>(), "set listener for metrics (REP, responds to any request with the metrics in the Prometheus text format), optional")
+				("journal-dir", bpo::value<std::string>(), "journal every published event to segment files in this directory, publishing it with its journal offset, optional")
+				("journal-segment-size", bpo::value<size_t>(), "set the size (MB) of a journal segment, default 64")
+				("journal-fsync-interval", bpo::value<uint64_t>(), "set the interval (ms) in which the journal is synced to disk, 0 for after every published batch, default 1000; syncing runs in the background")
+				("journal-retention-size", bpo::value<uint64_t>(), "set the maximum size (MB) of the journal, 0 for unlimited, default 1024")
+				("journal-retention-age", bpo::value<uint64_t>(), "set the maximum age (s) of journal segments, 0 for unlimited, default 0")
+				("replay-listen", bpo::value<std::string>(), "set listener for journal replays (ROUTER, streams the journal from the offset requested), requires --journal-dir, optional")
+				("cache-size", bpo::value<size_t>(), "keep the most recent event of every key in a last-value cache of this size (MB), an event's key being its leading bytes up to --cache-delimiter, optional")
+				("cache-delimiter", bpo::value<std::string>(), "set the character ending the key of an event, default ' '")
+				("snapshot-listen", bpo::value<std::string>(), "set listener for snapshots (ROUTER, sends the cached events of the keys starting with the prefix requested), requires --cache-size, optional")
+				("publisher-hwm", bpo::value<int>(), "set the high-water mark (events) of the publisher, per subscriber, default 1000")
+				("receiver-hwm", bpo::value<int>(), "set the high-water mark (messages) of the receiver and the ingest, default 1000")
+				("chain-hwm", bpo::value<int>(), "set the high-water mark (events) of the chain links, default 1000")
+				("overflow-policy", bpo::value<std::string>(), "set what happens once a subscriber reaches the publisher high-water mark, either 'lossy' (the subscriber misses events, uncounted), 'drop-newest' or 'drop-oldest' (the publisher waits for the slowest subscriber, backlogging and dropping events for all subscribers and chain links alike, acking backlogged events once published), default 'lossy'")
+				("publisher-backlog", bpo::value<size_t>(), "set the maximum number of events backlogged by the 'drop-newest' and 'drop-oldest' overflow policies, default 10000")
+				("chain-link", bpo::value<std::vector<std::string> >(&_optionChainLinks)->multitoken(), "add a chain link, specify one per link; a link to a --chain-batch-listen address takes the batch spec, e.g. 'tcp://10.0.0.2:19892?codec=zstd&batch-size=65536&batch-window=500', codec one of 'none', 'lz4', 'zstd', default 'lz4', batch size (bytes) default 65536, batch window (us) default 1000")
+				("chain-batch-listen", bpo::value<std::string>(), "set listener for batched chain links (XPUB, publishes the events in compressed batches of the spec each link asks for), optional")
+				("chain-heartbeat-interval", bpo::value<int>(), "publish a heartbeat to chain links in this interval (ms), and expect one from every linked hub, 0 for none, default 0")
+				("chain-heartbeat-timeout", bpo::value<int>(), "set the time (ms) after which a chain link without heartbeat is taken down and reconnected, default 3 heartbeat intervals")
+				("chain-reconnect-max", bpo::value<int>(), "set the maximum delay (ms) between the reconnects of a chain link that is down, default 5000")
+				("log-level", bpo::value<std::string>(), "set the log level, one of error, warning, info, debug, default info")
 				("discovery", "enable auto discovery of chain links")
 				("discovery-interval", bpo::value<size_t>(), "set the auto discovery interval (ms), default 1000")
 				("discovery-interface", bpo::value<std::string>(), "set the network interface to be used for auto discovery, e.g. eth0")
 				("discovery-port", bpo::value<int>(), "set the UDP port to be used for auto discovery, default 5670")
 				// ("discovery-group", bpo::value<std::string>(), "set the auto discovery group name, default 'TDRS'")
 				("discovery-key", bpo::value<std::string>(), "set the auto discovery key, default 'TDRS'")
+				("discovery-topology", bpo::value<std::string>(), "set the overlay the discovered hubs are linked in, either 'mesh' (every hub links to every other), 'tree' (every hub links to its parent and children) or 'super-peer' (every hub links to one super-peer, super-peers link to each other), default 'mesh'")
+				("discovery-fanout", bpo::value<size_t>(), "set the average number of children per hub and level with the 'tree' topology, default 4")
+				("discovery-super-peers", bpo::value<size_t>(), "set the number of super-peers with the 'super-peer' topology, default 3")
+				("partition", "partition the topics among the discovered hubs by consistent hashing, instead of linking them; a hub only publishes the topics it owns, redirecting or proxying the events of others, requires --discovery")
+				("partition-delimiter", bpo::value<std::string>(), "set the character ending the topic of an event, default ' '")
+				("partition-listen", bpo::value<std::string>(), "set listener for partition lookups (REP, responds to a topic with the receiver and publisher of the hub owning it), requires --partition, optional")
+				("partition-proxy-listen", bpo::value<std::string>(), "set listener for the fire-and-forget events other hubs proxy to this one (PUSH/PULL), requires --partition; other hubs drop the events of topics this hub owns without it, optional")
+				("shm-dir", bpo::value<std::string>(), "create shared-memory rings in this directory (e.g. /dev/shm) for co-located publishers, handing one to every publisher sending the handshake to the shared-memory endpoint, optional")
+				("shm-listen", bpo::value<std::string>(), "set the local shared-memory endpoint (ipc) co-located publishers ask for their rings at, default 'ipc://<shm-dir>/tdrs.hello'")
+				("shm-ring-size", bpo::value<size_t>(), "set the size (MB) of a shared-memory ring, default 4")
 			;
 
 			bpo::variables_map variablesMap;
@@ -348,191 +1378,2131 @@ namespace tdrs {
 			bpo::notify(variablesMap);
 
 			if(variablesMap.count("help")) {
+				Logger::flush();
 				std::cout << optionsDescription << std::endl;
 				return false;
 			}
 
+			if(variablesMap.count("log-level")) {
+				int level;
+				if(!Logger::parseLevel(variablesMap["log-level"].as<std::string>(), &level)) {
+					TDRS_LOG_ERROR("Hub: Error, unknown log level " << variablesMap["log-level"].as<std::string>() << ". Use one of error, warning, info, debug.");
+					return false;
+				}
+				Logger::level.store(level);
+			}
+
 			if(variablesMap.count("receiver-listen")) {
 				_optionReceiverListen = variablesMap["receiver-listen"].as<std::string>();
-				std::cout << "Hub: Listener for receiver was set to " << _optionReceiverListen << std::endl;
+				TDRS_LOG_INFO("Hub: Listener for receiver was set to " << _optionReceiverListen);
 			} else {
-				std::cout << "Hub: Listener for receiver (--receiver-listen) was not set!" << std::endl << std::endl;
+				TDRS_LOG_ERROR("Hub: Listener for receiver (--receiver-listen) was not set!");
+				Logger::flush();
 				std::cout << optionsDescription << std::endl;
 				return false;
 			}
 
-			if(variablesMap.count("publisher-listen")) {
-				_optionPublisherListen = variablesMap["publisher-listen"].as<std::string>();
-				std::cout << "Hub: Listener for publisher was set to " << _optionPublisherListen << std::endl;
-			} else {
-				std::cout << "Hub: Listener for publisher (--publisher-listen) was not set!" << std::endl << std::endl;
-				std::cout << optionsDescription << std::endl;
-				return false;
+			if(variablesMap.count("receiver-mode")) {
+				_optionReceiverMode = variablesMap["receiver-mode"].as<std::string>();
+				if(_optionReceiverMode != "rep" && _optionReceiverMode != "router") {
+					TDRS_LOG_ERROR("Hub: Error, unknown receiver mode " << _optionReceiverMode << ". Use either 'rep' or 'router'.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Receiver mode was set to " << _optionReceiverMode);
 			}
 
-			if(variablesMap.count("discovery")) {
-				if(variablesMap.count("chain-link")) {
-					std::cout << "Hub: Error, cannot manually add chain links while --discovery is enabled. Use either --discovery or --chain-link." << std::endl;
+			if(variablesMap.count("ingest-listen")) {
+				_optionIngestListen = variablesMap["ingest-listen"].as<std::string>();
+				TDRS_LOG_INFO("Hub: Listener for ingest was set to " << _optionIngestListen);
+			}
+
+			if(variablesMap.count("workers")) {
+				_optionWorkers = variablesMap["workers"].as<int>();
+				if(_optionWorkers < 1) {
+					TDRS_LOG_ERROR("Hub: Error, the number of workers must be at least 1.");
 					return false;
 				}
-
-				_optionDiscovery = true;
-				std::cout << "Hub: Auto discovery was enabled." << std::endl;
+				TDRS_LOG_INFO("Hub: Number of ingest workers was set to " << _optionWorkers);
 			}
 
-			if(variablesMap.count("discovery-interval")) {
-				_optionDiscoveryInterval = variablesMap["discovery-interval"].as<size_t>();
-				std::cout << "Hub: Auto discovery interval was set to " << _optionDiscoveryInterval << std::endl;
+			if(_optionWorkers > 1) {
+				// A REP receiver takes one request at a time, leaving all but one worker idle
+				if(!variablesMap.count("receiver-mode")) {
+					_optionReceiverMode = "router";
+					TDRS_LOG_INFO("Hub: Receiver mode was set to router, for the ingest workers");
+				} else if(_optionReceiverMode == "rep") {
+					TDRS_LOG_ERROR("Hub: Error, ingest workers require --receiver-mode router.");
+					return false;
+				}
 			}
 
-			if(variablesMap.count("discovery-interface")) {
-				_optionDiscoveryInterface = variablesMap["discovery-interface"].as<std::string>();
-				std::cout << "Hub: Auto discovery interface was set to " << _optionDiscoveryInterface << std::endl;
+			if(variablesMap.count("dedup-max-entries")) {
+				_optionDedupMaxEntries = variablesMap["dedup-max-entries"].as<size_t>();
+				if(_optionDedupMaxEntries < 1) {
+					TDRS_LOG_ERROR("Hub: Error, the dedup index must hold at least 1 entry.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Maximum dedup index entries was set to " << _optionDedupMaxEntries);
 			}
 
-			if(variablesMap.count("discovery-port")) {
-				_optionDiscoveryPort = variablesMap["discovery-port"].as<int>();
-				std::cout << "Hub: Auto discovery port was set to " << _optionDiscoveryPort << std::endl;
+			if(variablesMap.count("dedup-max-memory")) {
+				_optionDedupMaxMemory = variablesMap["dedup-max-memory"].as<size_t>();
+				if(_optionDedupMaxMemory < 1) {
+					TDRS_LOG_ERROR("Hub: Error, the dedup index memory must be at least 1 MB.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Maximum dedup index memory was set to " << _optionDedupMaxMemory << " MB");
 			}
 
-			// if(variablesMap.count("discovery-group")) {
-			// 	_optionDiscoveryGroup = variablesMap["discovery-group"].as<std::string>();
-			// 	std::cout << "Hub: Auto discovery group was set to " << _optionDiscoveryGroup << std::endl;
-			// }
+			if(variablesMap.count("dedup-ttl")) {
+				_optionDedupTtl = variablesMap["dedup-ttl"].as<uint64_t>();
+				if(_optionDedupTtl < 1) {
+					TDRS_LOG_ERROR("Hub: Error, the dedup index TTL must be at least 1 ms.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Dedup index TTL was set to " << _optionDedupTtl << " ms");
+			}
 
-			if(variablesMap.count("discovery-key")) {
-				_optionDiscoveryKey = variablesMap["discovery-key"].as<std::string>();
-				std::cout << "Hub: Auto discovery key was set to " << _optionDiscoveryKey << std::endl;
+			if(variablesMap.count("fingerprint")) {
+				std::string fingerprint = variablesMap["fingerprint"].as<std::string>();
+				if(fingerprint == "sha1") {
+					_optionFingerprint = TDRS_FINGERPRINT_SHA1;
+				} else if(fingerprint == "xxh3") {
+					_optionFingerprint = TDRS_FINGERPRINT_XXH3;
+				} else {
+					TDRS_LOG_ERROR("Hub: Error, unknown fingerprint " << fingerprint << ". Use either 'sha1' or 'xxh3'.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Fingerprint was set to " << fingerprint);
 			}
-		} catch(...) {
-			return false;
-		}
 
-		return true;
-	}
+			if(variablesMap.count("chain-envelope")) {
+				_optionChainEnvelope = true;
+				TDRS_LOG_INFO("Hub: Chain envelope was enabled, hub id is " << _hubId);
+			}
 
-	/**
-	 * @brief      Requests an exit of the run-loop on its next iteration.
-	 */
-	void Hub::shutdown() {
-		_runLoop = false;
-	}
+			if(variablesMap.count("chain-subscriptions")) {
+				_optionChainSubscriptions = true;
+				TDRS_LOG_INFO("Hub: Subscription-aware chain links were enabled, hub id is " << _hubId);
+			}
 
-	/**
-	 * @brief      Runs the Hub.
-	 */
-	void Hub::run() {
-		// Bind the publisher
-		_bindPublisher();
-		// Bind the receiver
-		_bindReceiver();
+			if(variablesMap.count("chain-reactor")) {
+				_optionChainReactor = true;
+				TDRS_LOG_INFO("Hub: Chain reactor was enabled");
+			}
 
-		if(_optionDiscovery == true) {
-			// Run the discovery service threads
-			_runDisoveryServiceThreads();
-		} else {
-			// Run chain client threads
-			_runChainClientThreads();
-		}
+			if(variablesMap.count("chain-max-hops")) {
+				_optionChainMaxHops = variablesMap["chain-max-hops"].as<int>();
+				if(_optionChainMaxHops < 1 || _optionChainMaxHops > 255) {
+					TDRS_LOG_ERROR("Hub: Error, the maximum number of hops must be between 1 and 255.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Maximum chain hops was set to " << _optionChainMaxHops);
+			}
 
-		std::cout << "Hub: Launching run-loop ..." << std::endl;
+			_dedupIndex.configure(_optionDedupMaxEntries, _optionDedupMaxMemory * 1024 * 1024, _optionDedupTtl);
 
-		// Run loop
-		bool propagateMessage = true;
-		while(_runLoop == true) {
-			propagateMessage = true;
-			zmq::message_t zmqReceiverMessageIncoming;
-			std::string zmqReceiverMessageOutgoingString;
+			if(variablesMap.count("publisher-listen")) {
+				_optionPublisherListen = variablesMap["publisher-listen"].as<std::string>();
+				TDRS_LOG_INFO("Hub: Listener for publisher was set to " << _optionPublisherListen);
+			} else {
+				TDRS_LOG_ERROR("Hub: Listener for publisher (--publisher-listen) was not set!");
+				Logger::flush();
+				std::cout << optionsDescription << std::endl;
+				return false;
+			}
 
-			try {
-				_zmqReceiverSocket.recv(&zmqReceiverMessageIncoming);
-			} catch(...) {
-				continue;
+			if(variablesMap.count("metrics-listen")) {
+				_optionMetricsListen = variablesMap["metrics-listen"].as<std::string>();
+				TDRS_LOG_INFO("Hub: Listener for metrics was set to " << _optionMetricsListen);
 			}
 
-			std::string zmqReceiverMessageIncomingString(
-				static_cast<const char*>(zmqReceiverMessageIncoming.data()),
-				zmqReceiverMessageIncoming.size()
-			);
+			if(variablesMap.count("journal-dir")) {
+				_optionJournalDir = variablesMap["journal-dir"].as<std::string>();
+				TDRS_LOG_INFO("Hub: Journal directory was set to " << _optionJournalDir);
 
-			std::cout << "Hub: Received message: " << zmqReceiverMessageIncomingString << std::endl;
+				size_t segmentSize = (variablesMap.count("journal-segment-size") ? variablesMap["journal-segment-size"].as<size_t>() * 1024 * 1024 : TDRS_JOURNAL_DEFAULT_SEGMENT_SIZE);
+				uint64_t fsyncInterval = (variablesMap.count("journal-fsync-interval") ? variablesMap["journal-fsync-interval"].as<uint64_t>() : TDRS_JOURNAL_DEFAULT_FSYNC_INTERVAL);
+				uint64_t retentionSize = (variablesMap.count("journal-retention-size") ? variablesMap["journal-retention-size"].as<uint64_t>() * 1024 * 1024 : TDRS_JOURNAL_DEFAULT_RETENTION_SIZE);
+				uint64_t retentionAge = (variablesMap.count("journal-retention-age") ? variablesMap["journal-retention-age"].as<uint64_t>() : TDRS_JOURNAL_DEFAULT_RETENTION_AGE);
 
-			if(zmqReceiverMessageIncomingString.substr(0, 5) == "PEER:") {
-				std::cout << "Hub: Message is peer announcement. Processing ..." << std::endl;
+				if(segmentSize == 0) {
+					TDRS_LOG_ERROR("Hub: Error, the journal segment size must be at least 1 MB.");
+					return false;
+				}
 
-				peerMessage *discoveredPeer = Hub::_parsePeerMessage(zmqReceiverMessageIncomingString);
+				_journal.configure(_optionJournalDir, segmentSize, retentionSize, retentionAge, fsyncInterval);
+				TDRS_LOG_INFO("Hub: Journal segments of " << segmentSize << " bytes, synced every " << fsyncInterval << " ms, retaining " << retentionSize << " bytes and " << retentionAge << " s.");
+			}
 
-				if(discoveredPeer != NULL) {
-					if(discoveredPeer->event == "ENTER") {
-						std::cout << "Hub: Running new chain client thread for announced peer ..." << std::endl;
-						_runChainClientThread(discoveredPeer->id, discoveredPeer->publisher);
-					} else if(discoveredPeer->event == "EXIT") {
-						std::cout << "Hub: Exiting chain client thread for peer ..." << std::endl;
-						if(!_shutdownChainClientThread(discoveredPeer->id)) {
-							std::cout << "Hub: Chain client thread was not available. Not propagating peer announcement!" << std::endl;
-							propagateMessage = false;
-							zmqReceiverMessageOutgoingString = "NOK NOT AVAILABLE";
-						}
-					}
-					delete discoveredPeer;
+			if(variablesMap.count("replay-listen")) {
+				if(_optionJournalDir.empty()) {
+					TDRS_LOG_ERROR("Hub: Error, --replay-listen requires --journal-dir.");
+					return false;
 				}
+
+				_optionReplayListen = variablesMap["replay-listen"].as<std::string>();
+				TDRS_LOG_INFO("Hub: Listener for replays was set to " << _optionReplayListen);
 			}
 
-			if(propagateMessage) {
-				std::string hashedMessage = Hub::hashString(&zmqReceiverMessageIncomingString);
-				std::cout << "Hub: Hashed message: " << hashedMessage << std::endl;
+			if(variablesMap.count("cache-size")) {
+				_optionCacheSize = variablesMap["cache-size"].as<size_t>();
+				if(_optionCacheSize == 0) {
+					TDRS_LOG_ERROR("Hub: Error, the last-value cache size must be at least 1 MB.");
+					return false;
+				}
+
+				char delimiter = TDRS_CACHE_DEFAULT_DELIMITER;
+				if(variablesMap.count("cache-delimiter")) {
+					std::string cacheDelimiter = variablesMap["cache-delimiter"].as<std::string>();
+					if(cacheDelimiter.size() != 1) {
+						TDRS_LOG_ERROR("Hub: Error, the last-value cache delimiter must be a single character.");
+						return false;
+					}
+					delimiter = cacheDelimiter[0];
+				}
 
-				std::cout << "Hub: Adding hashed message to shared message vector ..." << std::endl;
-				pthread_mutex_lock(&_sharedMessageVectorMutex);
-				BOOST_FOREACH(_chainClientThread client, _chainClientThreads) {
-					_sharedMessageEntry entry;
-					entry.hash = hashedMessage;
-					entry.link = client.params->link;
+				_lastValueCache.configure(_optionCacheSize * 1024 * 1024, delimiter);
+				TDRS_LOG_INFO("Hub: Last-value cache of " << _optionCacheSize << " MB was enabled.");
+			}
 
-					_sharedMessageVector.push_back(entry);
-					std::cout << "Hub: Hash for " << client.params->link << " added to shared message vector." << std::endl;
+			if(variablesMap.count("snapshot-listen")) {
+				if(_optionCacheSize == 0) {
+					TDRS_LOG_ERROR("Hub: Error, --snapshot-listen requires --cache-size.");
+					return false;
 				}
-				pthread_mutex_unlock(&_sharedMessageVectorMutex);
-				std::cout << "Hub: Added hashed message to shared message vector." << std::endl;
 
-				std::cout << "Hub: Forwarding message to Hub subscribers ..." << std::endl;
-				zmq::message_t zmqIpcMessageOutgoing(zmqReceiverMessageIncoming.size());
-				memcpy(zmqIpcMessageOutgoing.data(), zmqReceiverMessageIncoming.data(), zmqReceiverMessageIncoming.size());
+				_optionSnapshotListen = variablesMap["snapshot-listen"].as<std::string>();
+				TDRS_LOG_INFO("Hub: Listener for snapshots was set to " << _optionSnapshotListen);
+			}
 
-				try {
-					_zmqHubSocket.send(zmqIpcMessageOutgoing);
-					zmqReceiverMessageOutgoingString = "OOK " + hashedMessage;
-					std::cout << "Hub: Forwarding successful." << std::endl;
-				} catch(...) {
-					zmqReceiverMessageOutgoingString = "NOK " + hashedMessage;
-					std::cout << "Hub: Forwarding failed!" << std::endl;
+			if(variablesMap.count("publisher-hwm")) {
+				_optionPublisherHwm = variablesMap["publisher-hwm"].as<int>();
+				if(_optionPublisherHwm < 0) {
+					TDRS_LOG_ERROR("Hub: Error, the publisher high-water mark must not be negative.");
+					return false;
 				}
+				TDRS_LOG_INFO("Hub: Publisher high-water mark was set to " << _optionPublisherHwm);
 			}
 
-			std::cout << "Hub: Preparing response to initiator ..." << std::endl;
-			zmq::message_t zmqReceiverMessageOutgoing(zmqReceiverMessageOutgoingString.size());
-			memcpy(zmqReceiverMessageOutgoing.data(), zmqReceiverMessageOutgoingString.c_str(), zmqReceiverMessageOutgoingString.size());
+			if(variablesMap.count("receiver-hwm")) {
+				_optionReceiverHwm = variablesMap["receiver-hwm"].as<int>();
+				if(_optionReceiverHwm < 0) {
+					TDRS_LOG_ERROR("Hub: Error, the receiver high-water mark must not be negative.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Receiver high-water mark was set to " << _optionReceiverHwm);
+			}
 
-			std::cout << "Hub: Sending response to initiator ..." << std::endl;
-			_zmqReceiverSocket.send(zmqReceiverMessageOutgoing);
-			std::cout << "Hub: Response sent to initiator." << std::endl;
-		}
+			if(variablesMap.count("chain-hwm")) {
+				_optionChainHwm = variablesMap["chain-hwm"].as<int>();
+				if(_optionChainHwm < 0) {
+					TDRS_LOG_ERROR("Hub: Error, the chain high-water mark must not be negative.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Chain high-water mark was set to " << _optionChainHwm);
+			}
 
-		std::cout << std::endl;
+			if(variablesMap.count("overflow-policy")) {
+				std::string overflowPolicy = variablesMap["overflow-policy"].as<std::string>();
+				if(overflowPolicy == "lossy") {
+					_optionOverflowPolicy = TDRS_OVERFLOW_LOSSY;
+				} else if(overflowPolicy == "drop-newest") {
+					_optionOverflowPolicy = TDRS_OVERFLOW_DROP_NEWEST;
+				} else if(overflowPolicy == "drop-oldest") {
+					_optionOverflowPolicy = TDRS_OVERFLOW_DROP_OLDEST;
+				} else {
+					TDRS_LOG_ERROR("Hub: Error, unknown overflow policy " << overflowPolicy << ". Use one of lossy, drop-newest, drop-oldest.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Overflow policy was set to " << overflowPolicy);
+			}
 
-		if(_optionDiscovery == true) {
-			// Shutdown the discovery service threads
-			_shutdownDisoveryServiceThreads();
-		}
+			if(variablesMap.count("publisher-backlog")) {
+				_optionPublisherBacklog = variablesMap["publisher-backlog"].as<size_t>();
+				if(_optionPublisherBacklog < 1) {
+					TDRS_LOG_ERROR("Hub: Error, the publisher backlog must hold at least 1 event.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Publisher backlog was set to " << _optionPublisherBacklog);
+			}
 
-		// Shutdown chain client threads, from auto discovery or manual setup
-		_shutdownChainClientThreads();
+			if(variablesMap.count("chain-batch-listen")) {
+				_optionChainBatchListen = variablesMap["chain-batch-listen"].as<std::string>();
+				TDRS_LOG_INFO("Hub: Listener for batched chain links was set to " << _optionChainBatchListen);
+			}
+
+			if(variablesMap.count("chain-heartbeat-interval")) {
+				_optionChainHeartbeatInterval = variablesMap["chain-heartbeat-interval"].as<int>();
+				if(_optionChainHeartbeatInterval < 0) {
+					TDRS_LOG_ERROR("Hub: Error, the chain heartbeat interval must not be negative.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Chain heartbeat interval was set to " << _optionChainHeartbeatInterval);
+			}
+
+			_optionChainHeartbeatTimeout = _optionChainHeartbeatInterval * TDRS_CHAIN_HEARTBEAT_DEFAULT_INTERVALS;
+			if(variablesMap.count("chain-heartbeat-timeout")) {
+				if(_optionChainHeartbeatInterval == 0) {
+					TDRS_LOG_ERROR("Hub: Error, the chain heartbeat timeout requires --chain-heartbeat-interval.");
+					return false;
+				}
+				_optionChainHeartbeatTimeout = variablesMap["chain-heartbeat-timeout"].as<int>();
+				if(_optionChainHeartbeatTimeout <= _optionChainHeartbeatInterval) {
+					TDRS_LOG_ERROR("Hub: Error, the chain heartbeat timeout must be longer than the chain heartbeat interval.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Chain heartbeat timeout was set to " << _optionChainHeartbeatTimeout);
+			}
+
+			if(variablesMap.count("chain-reconnect-max")) {
+				_optionChainReconnectMax = variablesMap["chain-reconnect-max"].as<int>();
+				if(_optionChainReconnectMax < _optionChainHeartbeatInterval) {
+					TDRS_LOG_ERROR("Hub: Error, the maximum chain reconnect delay must not be shorter than the chain heartbeat interval.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Maximum chain reconnect delay was set to " << _optionChainReconnectMax);
+			}
+			_optionChainReconnectMax = std::max(_optionChainReconnectMax, _optionChainHeartbeatInterval);
+
+			BOOST_FOREACH(const std::string &link, _optionChainLinks) {
+				std::string endpoint;
+				bool batched;
+				chainBatchSpec spec;
+				if(!Hub::parseChainLink(link, &endpoint, &batched, &spec)) {
+					TDRS_LOG_ERROR("Hub: Error, invalid chain link " << link << ".");
+					return false;
+				}
+			}
+
+			if(variablesMap.count("discovery")) {
+				if(variablesMap.count("chain-link")) {
+					TDRS_LOG_ERROR("Hub: Error, cannot manually add chain links while --discovery is enabled. Use either --discovery or --chain-link.");
+					return false;
+				}
+
+				_optionDiscovery = true;
+				TDRS_LOG_INFO("Hub: Auto discovery was enabled.");
+			}
+
+			if(variablesMap.count("discovery-interval")) {
+				_optionDiscoveryInterval = variablesMap["discovery-interval"].as<size_t>();
+				TDRS_LOG_INFO("Hub: Auto discovery interval was set to " << _optionDiscoveryInterval);
+			}
+
+			if(variablesMap.count("discovery-interface")) {
+				_optionDiscoveryInterface = variablesMap["discovery-interface"].as<std::string>();
+				TDRS_LOG_INFO("Hub: Auto discovery interface was set to " << _optionDiscoveryInterface);
+			}
+
+			if(variablesMap.count("discovery-port")) {
+				_optionDiscoveryPort = variablesMap["discovery-port"].as<int>();
+				TDRS_LOG_INFO("Hub: Auto discovery port was set to " << _optionDiscoveryPort);
+			}
+
+			// if(variablesMap.count("discovery-group")) {
+			// 	_optionDiscoveryGroup = variablesMap["discovery-group"].as<std::string>();
+			// 	std::cout << "Hub: Auto discovery group was set to " << _optionDiscoveryGroup << std::endl;
+			// }
+
+			if(variablesMap.count("discovery-key")) {
+				_optionDiscoveryKey = variablesMap["discovery-key"].as<std::string>();
+				TDRS_LOG_INFO("Hub: Auto discovery key was set to " << _optionDiscoveryKey);
+			}
+
+			if(variablesMap.count("discovery-topology")) {
+				std::string topology = variablesMap["discovery-topology"].as<std::string>();
+				if(!HubOverlay::parseTopology(topology, &_optionDiscoveryTopology)) {
+					TDRS_LOG_ERROR("Hub: Error, unknown discovery topology " << topology << ". Use one of mesh, tree, super-peer.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Auto discovery topology was set to " << topology);
+			}
+
+			if(variablesMap.count("discovery-fanout")) {
+				_optionDiscoveryFanout = variablesMap["discovery-fanout"].as<size_t>();
+				if(_optionDiscoveryFanout < 1) {
+					TDRS_LOG_ERROR("Hub: Error, the discovery fanout must be at least 1.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Auto discovery fanout was set to " << _optionDiscoveryFanout);
+			}
+
+			if(variablesMap.count("discovery-super-peers")) {
+				_optionDiscoverySuperPeers = variablesMap["discovery-super-peers"].as<size_t>();
+				if(_optionDiscoverySuperPeers < 1) {
+					TDRS_LOG_ERROR("Hub: Error, the number of discovery super-peers must be at least 1.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Auto discovery super-peers were set to " << _optionDiscoverySuperPeers);
+			}
+
+			_overlay.configure(_optionDiscoveryTopology, _optionDiscoveryFanout, _optionDiscoverySuperPeers, HubOverlay::memberKey(_hubId));
+
+			if(variablesMap.count("partition")) {
+				if(!_optionDiscovery) {
+					TDRS_LOG_ERROR("Hub: Error, partitioning requires --discovery.");
+					return false;
+				}
+
+				_optionPartition = true;
+				TDRS_LOG_INFO("Hub: Partitioning was enabled.");
+			}
+
+			if(variablesMap.count("partition-delimiter")) {
+				std::string partitionDelimiter = variablesMap["partition-delimiter"].as<std::string>();
+				if(partitionDelimiter.size() != 1) {
+					TDRS_LOG_ERROR("Hub: Error, the partition delimiter must be a single character.");
+					return false;
+				}
+				_optionPartitionDelimiter = partitionDelimiter[0];
+				TDRS_LOG_INFO("Hub: Partition delimiter was set to '" << _optionPartitionDelimiter << "'");
+			}
+
+			if(variablesMap.count("partition-listen")) {
+				if(!_optionPartition) {
+					TDRS_LOG_ERROR("Hub: Error, the partition listener requires --partition.");
+					return false;
+				}
+
+				_optionPartitionListen = variablesMap["partition-listen"].as<std::string>();
+				TDRS_LOG_INFO("Hub: Listener for partition lookups was set to " << _optionPartitionListen);
+			}
+
+			if(variablesMap.count("partition-proxy-listen")) {
+				if(!_optionPartition) {
+					TDRS_LOG_ERROR("Hub: Error, the partition proxy listener requires --partition.");
+					return false;
+				}
+
+				_optionPartitionProxyListen = variablesMap["partition-proxy-listen"].as<std::string>();
+				TDRS_LOG_INFO("Hub: Listener for proxied events was set to " << _optionPartitionProxyListen);
+			}
+
+			_partitionRing.configure(_optionPartitionDelimiter);
+
+			if(variablesMap.count("shm-dir")) {
+				_optionShmDir = variablesMap["shm-dir"].as<std::string>();
+				TDRS_LOG_INFO("Hub: Shared-memory directory was set to " << _optionShmDir);
+			}
+
+			if(variablesMap.count("shm-listen")) {
+				if(_optionShmDir.empty()) {
+					TDRS_LOG_ERROR("Hub: Error, the shared-memory endpoint requires --shm-dir.");
+					return false;
+				}
+				_optionShmListen = variablesMap["shm-listen"].as<std::string>();
+			} else if(!_optionShmDir.empty()) {
+				_optionShmListen = "ipc://" + _optionShmDir + "/" + TDRS_SHM_DEFAULT_LISTEN_NAME;
+			}
+			if(!_optionShmListen.empty()) {
+				// Rings are files on this host, so the endpoint handing them out must not be reachable from others
+				if(_optionShmListen.compare(0, 6, "ipc://") != 0) {
+					TDRS_LOG_ERROR("Hub: Error, the shared-memory endpoint must be an ipc:// endpoint.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Shared-memory endpoint was set to " << _optionShmListen);
+			}
+
+			if(variablesMap.count("shm-ring-size")) {
+				if(_optionShmDir.empty()) {
+					TDRS_LOG_ERROR("Hub: Error, the shared-memory ring size requires --shm-dir.");
+					return false;
+				}
+
+				_optionShmRingSize = variablesMap["shm-ring-size"].as<size_t>() * 1024 * 1024;
+				if(_optionShmRingSize == 0) {
+					TDRS_LOG_ERROR("Hub: Error, the shared-memory ring size must be at least 1 MB.");
+					return false;
+				}
+				TDRS_LOG_INFO("Hub: Shared-memory ring size was set to " << _optionShmRingSize << " bytes");
+			}
+		} catch(...) {
+			return false;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief      Receives all frames of a multipart message.
+	 *
+	 * @param      socket  The socket to receive from
+	 * @param      frames  The frames vector to append to
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool Hub::_receiveFrames(zmq::socket_t &socket, std::vector<zmq::message_t> &frames) {
+		do {
+			frames.push_back(zmq::message_t());
+
+			try {
+				socket.recv(&frames.back());
+			} catch(...) {
+				return false;
+			}
+		} while(frames.back().more());
+
+		return true;
+	}
+
+	/**
+	 * @brief      Inspects the frames of an ingest job, telling events and
+	 * their chain envelopes apart. Only relayed jobs, handed over by chain
+	 * clients or proxied by partitioned hubs, carry envelopes; on all other
+	 * endpoints every frame is an opaque event, so producers can neither
+	 * forge an envelope nor have an event taken for one. Event payloads are
+	 * never looked into; peer announcements arrive on the control endpoint
+	 * instead.
+	 *
+	 * @param      job   The ingest job
+	 */
+	void Hub::_inspectMessages(_ingestJob *job) {
+		// Every frame is an event, unless it is the chain envelope of the preceding one
+		for(size_t frame = job->first; frame < job->frames.size(); frame++) {
+			chainEnvelope envelope;
+
+			if(job->relayed && !job->events.empty() && !job->enveloped.back() && Hub::parseEnvelope(job->frames[frame], &envelope)) {
+				job->enveloped.back() = true;
+				job->envelopes.back() = envelope;
+				continue;
+			}
+
+			job->events.push_back(frame);
+			job->enveloped.push_back(false);
+			job->envelopes.push_back(chainEnvelope());
+		}
+
+		size_t eventCount = job->events.size();
+		job->propagate.assign(eventCount, true);
+		job->hashes.assign(eventCount, "");
+		job->fingerprints.assign(eventCount, "");
+		job->responses.assign(eventCount, "");
+	}
+
+	/**
+	 * @brief      Fingerprints the events of an ingest job for the dedup index
+	 * and hashes them for the ack, if required. With SHA1 fingerprints the
+	 * hash doubles as fingerprint. Chain envelopes make both unnecessary:
+	 * enveloped events are acked with their origin and sequence number.
+	 *
+	 * @param      job   The ingest job
+	 */
+	void Hub::_hashMessages(_ingestJob *job) const {
+		for(size_t event = 0; event < job->propagate.size(); event++) {
+			if(!job->propagate[event]) {
+				continue;
+			}
+
+			if(job->enveloped[event]) {
+				job->hashes[event] = std::to_string(job->envelopes[event].origin) + ":" + std::to_string(job->envelopes[event].sequence);
+				continue;
+			}
+
+			zmq::message_t &message = job->frames[job->events[event]];
+
+			if(_optionChainEnvelope) {
+				if(job->respond) {
+					job->hashes[event] = Hub::hashData(message.data(), message.size());
+					TDRS_LOG_DEBUG("Hub: Hashed message: " << job->hashes[event]);
+				}
+				continue;
+			}
+
+			if(_optionFingerprint == TDRS_FINGERPRINT_SHA1) {
+				job->hashes[event] = Hub::hashData(message.data(), message.size());
+				job->fingerprints[event] = job->hashes[event];
+				TDRS_LOG_DEBUG("Hub: Hashed message: " << job->hashes[event]);
+				continue;
+			}
+
+			job->fingerprints[event] = Hub::fingerprintData(message.data(), message.size(), _optionFingerprint);
+			TDRS_LOG_DEBUG("Hub: Fingerprinted message: " << logHex(job->fingerprints[event]));
+
+			if(job->respond) {
+				job->hashes[event] = Hub::hashData(message.data(), message.size());
+				TDRS_LOG_DEBUG("Hub: Hashed message: " << job->hashes[event]);
+			}
+		}
+	}
+
+	/**
+	 * @brief      Registers the hashed events of an ingest job in the dedup
+	 * index, once per chain link, under a single lock.
+	 *
+	 * @param      job   The ingest job
+	 */
+	void Hub::_registerMessages(_ingestJob *job) {
+		// Enveloped events are recognized by their origin when they come back
+		if(_optionChainEnvelope) {
+			return;
+		}
+
+		TDRS_LOG_DEBUG("Hub: Adding hashed messages to dedup index ...");
+		pthread_mutex_lock(&_dedupIndexMutex);
+		for(size_t event = 0; event < job->propagate.size(); event++) {
+			if(!job->propagate[event] || job->enveloped[event]) {
+				continue;
+			}
+
+			BOOST_FOREACH(uint32_t linkId, _chainLinkIds) {
+				_dedupIndex.insert(job->fingerprints[event], linkId);
+				TDRS_LOG_DEBUG("Hub: Hash for link #" << linkId << " added to dedup index.");
+			}
+		}
+		pthread_mutex_unlock(&_dedupIndexMutex);
+		TDRS_LOG_DEBUG("Hub: Added hashed messages to dedup index.");
+	}
+
+	/**
+	 * @brief      Publishes the events of an ingest job to the Hub
+	 * subscribers and responds to the initiator, if required. Relayed events
+	 * keep their chain envelope, with one more hop and this hub as relay;
+	 * with --chain-envelope, events originating here get a new one. With
+	 * --journal-dir, events are journaled before they are published and
+	 * carry their journal offset. Events the drop-newest overflow policy
+	 * rejects are neither journaled, cached nor batched.
+	 *
+	 * An event is only acked `OOK` once the publisher took it. Events the
+	 * publisher holds back in its backlog are acked when they are sent, or
+	 * `NOK` when they are dropped, so the job waits for them; a REP
+	 * receiver takes no other request meanwhile.
+	 *
+	 * @param      job   The ingest job
+	 *
+	 * @return     True if the job is done, false if it waits for backlogged
+	 * events and is released once they are settled.
+	 */
+	bool Hub::_publishMessages(_ingestJob *job) {
+		// Held while publishing, so dropping one of its own backlogged events does not complete the job
+		job->unsettled = 1;
+
+		for(size_t event = 0; event < job->propagate.size(); event++) {
+			if(job->propagate[event]) {
+				TDRS_LOG_DEBUG("Hub: Forwarding message to Hub subscribers ...");
+
+				// Decided up front, as the publisher takes or backlogs every other event
+				if(_optionOverflowPolicy == TDRS_OVERFLOW_DROP_NEWEST && _publisherBacklog.size() >= _optionPublisherBacklog) {
+					_publisherStats.droppedNewest++;
+					TDRS_LOG_DEBUG("Hub: Publisher backlog is full, dropping newest event.");
+					job->responses[event] = "NOK " + job->hashes[event];
+					_metricAcksFailed++;
+					continue;
+				}
+
+				try {
+					// Forwards the received message itself; its content moves to the socket
+					_publisherEvent published;
+					published.payload.move(&job->frames[job->events[event]]);
+					// Partitioned hubs are not linked, the envelope of proxied events only marked them
+					published.enveloped = ((job->enveloped[event] && !_optionPartition) || _optionChainEnvelope);
+					published.journaled = false;
+					if(published.enveloped) {
+						chainEnvelope &envelope = job->envelopes[event];
+						if(job->enveloped[event]) {
+							envelope.hops++;
+							envelope.previousRelay = envelope.relay;
+						} else {
+							envelope.hops = 0;
+							envelope.origin = _hubId;
+							envelope.sequence = ++_originSequence;
+							envelope.previousRelay = 0;
+						}
+						envelope.relay = _hubId;
+
+						Hub::buildEnvelope(envelope, &published.envelope);
+					}
+
+					if(!_optionJournalDir.empty()) {
+						uint64_t offset;
+						published.journaled = _journal.append(published.payload.data(), published.payload.size(),
+							published.envelope.data(), (published.enveloped ? published.envelope.size() : 0), &offset);
+						if(published.journaled) {
+							Hub::buildOffset(offset, &published.offset);
+						}
+					}
+
+					if(_optionCacheSize > 0) {
+						_lastValueCache.update(published.payload.data(), published.payload.size());
+					}
+
+					_batchEvent(published);
+
+					// Events queue up behind backlogged ones, to keep their order
+					if(_publisherBacklog.empty() && _sendEvent(published)) {
+						job->responses[event] = "OOK " + job->hashes[event];
+						_metricEventsPublished++;
+						TDRS_LOG_DEBUG("Hub: Forwarding successful.");
+					} else {
+						_backlogEvent(published, (job->respond ? job : NULL), event);
+					}
+				} catch(...) {
+					job->responses[event] = "NOK " + job->hashes[event];
+					_metricAcksFailed++;
+					TDRS_LOG_WARNING("Hub: Forwarding failed!");
+				}
+			}
+		}
+
+		if(!_optionJournalDir.empty()) {
+			_journal.maintain();
+		}
+
+		if(--job->unsettled > 0) {
+			if(_optionReceiverMode == "rep") {
+				// REP requires the response before the next request can be received
+				_receiverBusy = true;
+			}
+			return false;
+		}
+
+		_completeJob(job);
+		return true;
+	}
+
+	/**
+	 * @brief      Responds to the initiator of an ingest job whose events are
+	 * all settled, if required, with one ack line per event, and records the
+	 * job's latencies.
+	 *
+	 * @param      job   The ingest job
+	 */
+	void Hub::_completeJob(_ingestJob *job) {
+		std::string responseString;
+		for(size_t event = 0; event < job->responses.size(); event++) {
+			if(event > 0) {
+				responseString += "\n";
+			}
+			responseString += job->responses[event];
+		}
+
+		uint64_t publishedAt = Hub::monotonicTime();
+		_metricHashLatency.record(job->hashedAt - job->receivedAt);
+		_metricPublishLatency.record(publishedAt - job->hashedAt);
+
+		if(job->respond) {
+			_respond(job, responseString);
+
+			uint64_t ackedAt = Hub::monotonicTime();
+			_metricAckLatency.record(ackedAt - publishedAt);
+			_metricTotalLatency.record(ackedAt - job->receivedAt);
+		} else {
+			_metricTotalLatency.record(publishedAt - job->receivedAt);
+		}
+	}
+
+	/**
+	 * @brief      Sends one event on the publisher, as `[event]`, followed by
+	 * its envelope and offset frames, if any, without blocking. With the
+	 * lossy overflow policy the publisher accepts every event.
+	 *
+	 * @param      event  The event, with its envelope and offset frames
+	 *
+	 * @return     True if the publisher accepted the event, false if a
+	 * subscriber's high-water mark was reached. The event is then not sent
+	 * to any subscriber, as the publisher has no per-subscriber queues.
+	 */
+	bool Hub::_sendEvent(_publisherEvent &event) {
+		if(!event.enveloped && !event.journaled) {
+			return _zmqHubSocket.send(event.payload, ZMQ_DONTWAIT);
+		}
+
+		if(!_zmqHubSocket.send(event.payload, ZMQ_SNDMORE | ZMQ_DONTWAIT)) {
+			return false;
+		}
+
+		// The high-water mark only applies to the first frame of a message
+		if(event.enveloped) {
+			_zmqHubSocket.send(event.envelope, (event.journaled ? ZMQ_SNDMORE : 0));
+		}
+		if(event.journaled) {
+			_zmqHubSocket.send(event.offset);
+		}
+		return true;
+	}
+
+	/**
+	 * @brief      Queues one event the publisher did not accept, to be acked
+	 * once it is settled. Once the backlog is full, the oldest backlogged
+	 * event is dropped and acked `NOK`; it stays journaled. The drop-newest
+	 * overflow policy rejects events before they get here.
+	 *
+	 * @param      event  The event, with its envelope and offset frames
+	 * @param      job    The job waiting for the event's ack, or NULL
+	 * @param[in]  index  The index of the event in the job
+	 */
+	void Hub::_backlogEvent(_publisherEvent &event, _ingestJob *job, size_t index) {
+		if(_publisherBacklog.size() >= _optionPublisherBacklog) {
+			_publisherEvent *dropped = _publisherBacklog.front();
+			_publisherBacklog.pop_front();
+			_publisherStats.droppedOldest++;
+			TDRS_LOG_DEBUG("Hub: Publisher backlog is full, dropping oldest event.");
+			_settleEvent(dropped, false);
+			delete dropped;
+		}
+
+		_publisherEvent *backlogged = new _publisherEvent;
+		backlogged->payload.move(&event.payload);
+		backlogged->envelope.move(&event.envelope);
+		backlogged->enveloped = event.enveloped;
+		backlogged->offset.move(&event.offset);
+		backlogged->journaled = event.journaled;
+		backlogged->job = job;
+		backlogged->event = index;
+		if(job != NULL) {
+			job->unsettled++;
+		}
+		_publisherBacklog.push_back(backlogged);
+		_publisherStats.backlogged++;
+	}
+
+	/**
+	 * @brief      Settles one backlogged event, acking it to the job waiting
+	 * for it, if any: `OOK` if the publisher took it, `NOK` if it was
+	 * dropped. The job is completed and released once all of its events are
+	 * settled.
+	 *
+	 * @param      event      The backlogged event
+	 * @param[in]  published  Whether the publisher took the event
+	 */
+	void Hub::_settleEvent(_publisherEvent *event, bool published) {
+		if(published) {
+			_metricEventsPublished++;
+		}
+
+		_ingestJob *job = event->job;
+		if(job == NULL) {
+			return;
+		}
+
+		job->responses[event->event] = (published ? "OOK " : "NOK ") + job->hashes[event->event];
+		if(!published) {
+			_metricAcksFailed++;
+		}
+
+		if(--job->unsettled == 0) {
+			_completeJob(job);
+			delete job;
+		}
+	}
+
+	/**
+	 * @brief      Sends as many backlogged events as the publisher accepts,
+	 * oldest first.
+	 */
+	void Hub::_flushPublisher() {
+		while(!_publisherBacklog.empty()) {
+			_publisherEvent *backlogged = _publisherBacklog.front();
+
+			bool published = false;
+			try {
+				if(!_sendEvent(*backlogged)) {
+					break;
+				}
+				published = true;
+			} catch(...) {
+				TDRS_LOG_WARNING("Hub: Forwarding failed!");
+			}
+
+			_publisherBacklog.pop_front();
+			_settleEvent(backlogged, published);
+			delete backlogged;
+		}
+	}
+
+	/**
+	 * @brief      Sends a response for an ingest job to its initiator on the
+	 * receiver, mirroring the job's envelope frames.
+	 *
+	 * @param      job       The ingest job
+	 * @param[in]  response  The response
+	 */
+	void Hub::_respond(_ingestJob *job, const std::string &response) {
+		TDRS_LOG_DEBUG("Hub: Sending response to initiator ...");
+		zmq::message_t zmqReceiverMessageOutgoing(response.size());
+		memcpy(zmqReceiverMessageOutgoing.data(), response.c_str(), response.size());
+
+		try {
+			for(size_t frame = 0; frame < job->responseFrames; frame++) {
+				_zmqReceiverSocket.send(job->frames[frame], ZMQ_SNDMORE);
+			}
+			_zmqReceiverSocket.send(zmqReceiverMessageOutgoing);
+			TDRS_LOG_DEBUG("Hub: Response sent to initiator.");
+		} catch(...) {
+			TDRS_LOG_WARNING("Hub: Sending response to initiator failed!");
+		}
+
+		_receiverBusy = false;
+	}
+
+	/**
+	 * @brief      Dispatches an ingest job: either processes it right away or,
+	 * with ingest workers, hands it to the next worker. Takes ownership of
+	 * the job.
+	 *
+	 * @param      job   The ingest job
+	 */
+	void Hub::_dispatchJob(_ingestJob *job) {
+		job->receivedAt = Hub::monotonicTime();
+		_inspectMessages(job);
+		_metricEventsReceived += job->events.size();
+
+		// Relayed and proxied events were partitioned by the hub they came from
+		if(_optionPartition && !job->relayed) {
+			_partitionMessages(job);
+		}
+
+		if(_ingestWorkerThreads.empty()) {
+			Hub::_hashMessages(job);
+			_registerMessages(job);
+			job->hashedAt = Hub::monotonicTime();
+			if(_publishMessages(job)) {
+				delete job;
+			}
+			return;
+		}
+
+		job->sequence = _ingestSequence++;
+		if(job->respond && _optionReceiverMode == "rep") {
+			// REP requires the response before the next request can be received
+			_receiverBusy = true;
+		}
+
+		_zmqWorkerSockets[_nextIngestWorker].send(&job, sizeof(job));
+		_nextIngestWorker = (_nextIngestWorker + 1) % _zmqWorkerSockets.size();
+	}
+
+	/**
+	 * @brief      Collects one processed job from the ingest workers and
+	 * publishes all jobs that are due, in the order they were received.
+	 */
+	void Hub::_serveResults() {
+		_ingestJob *job = NULL;
+
+		try {
+			_zmqResultsSocket.recv(&job, sizeof(job));
+		} catch(...) {
+			return;
+		}
+
+		_ingestBacklog[job->sequence] = job;
+
+		std::map<uint64_t, _ingestJob*>::iterator due;
+		while((due = _ingestBacklog.find(_publishSequence)) != _ingestBacklog.end()) {
+			if(_publishMessages(due->second)) {
+				delete due->second;
+			}
+			_ingestBacklog.erase(due);
+			_publishSequence++;
+		}
+	}
+
+	/**
+	 * @brief      Serves one request on the receiver in REP mode.
+	 *
+	 * Every frame of a multipart request is an event of its own; the
+	 * response carries one ack line per event.
+	 */
+	void Hub::_serveReceiverRep() {
+		_ingestJob *job = new _ingestJob;
+
+		if(!Hub::_receiveFrames(_zmqReceiverSocket, job->frames)) {
+			delete job;
+			return;
+		}
+
+		job->first = 0;
+		job->responseFrames = 0;
+		job->respond = true;
+		job->relayed = false;
+		_dispatchJob(job);
+	}
+
+	/**
+	 * @brief      Serves one request on the receiver in ROUTER mode.
+	 *
+	 * Incoming frames are [identity][empty delimiter][event]... from REQ
+	 * clients and [identity][(correlation id)][event]... from pipelining
+	 * DEALER clients. Both are mirrored in the response, so a client may
+	 * keep any number of events or batches in flight and match each ack to
+	 * its request by correlation id. Requests with a delimiter never carry a
+	 * correlation id, so every frame after it is an event; a DEALER request
+	 * without correlation id carries exactly one event. An empty correlation
+	 * id is taken for the delimiter, which is mirrored all the same.
+	 */
+	void Hub::_serveReceiverRouter() {
+		_ingestJob *job = new _ingestJob;
+
+		if(!Hub::_receiveFrames(_zmqReceiverSocket, job->frames)) {
+			delete job;
+			return;
+		}
+
+		// Envelope: identity and, for REQ clients, the empty delimiter
+		bool delimited = (job->frames.size() > 1 && job->frames[1].size() == 0);
+		size_t envelopeSize = (delimited ? 2 : 1);
+
+		// Envelope and correlation id, if any, are sent back as they came in
+		size_t payloadFrames = job->frames.size() - std::min(envelopeSize, job->frames.size());
+		job->first = (!delimited && payloadFrames > 1 ? envelopeSize + 1 : envelopeSize);
+		job->responseFrames = job->first;
+		job->respond = true;
+		job->relayed = false;
+
+		if(payloadFrames == 0) {
+			TDRS_LOG_WARNING("Hub: Received malformed message, not processing.");
+			_respond(job, "NOK MALFORMED");
+			_metricAcksFailed++;
+			delete job;
+			return;
+		}
+
+		_dispatchJob(job);
+	}
+
+	/**
+	 * @brief      Serves one message on the ingest, without responding.
+	 *
+	 * Events are processed exactly like the ones on the receiver, every
+	 * frame of a multipart message being an event of its own.
+	 */
+	void Hub::_serveIngest() {
+		_ingestJob *job = new _ingestJob;
+
+		if(!Hub::_receiveFrames(_zmqIngestSocket, job->frames)) {
+			delete job;
+			return;
+		}
+
+		job->first = 0;
+		job->responseFrames = 0;
+		job->respond = false;
+		job->relayed = false;
+		_dispatchJob(job);
+	}
+
+	/**
+	 * @brief      Serves one event received by a chain client.
+	 *
+	 * Chain clients hand the events they did not see before to the hub
+	 * in-process, as `[event]` or `[event][envelope]`, and are never
+	 * responded to.
+	 */
+	void Hub::_serveChain() {
+		_ingestJob *job = new _ingestJob;
+
+		if(!Hub::_receiveFrames(_zmqChainSocket, job->frames)) {
+			delete job;
+			return;
+		}
+
+		job->first = 0;
+		job->responseFrames = 0;
+		job->respond = false;
+		job->relayed = true;
+		_dispatchJob(job);
+	}
+
+	/**
+	 * @brief      Serves one peer announcement on the control endpoint,
+	 * launching or shutting down the peer's chain client thread. Announcements
+	 * are neither acked nor published.
+	 */
+	void Hub::_serveControl() {
+		std::vector<zmq::message_t> frames;
+
+		if(!Hub::_receiveFrames(_zmqControlSocket, frames)) {
+			return;
+		}
+
+		peerMessage peer;
+		if(!Hub::parseControl(frames.front(), &peer)) {
+			TDRS_LOG_WARNING("Hub: Ignoring invalid control message.");
+			return;
+		}
+
+		// Partitioned hubs own their topics alone, they are not linked
+		if(_optionPartition) {
+			_updatePartitionRing(peer);
+			return;
+		}
+
+		if(peer.event == TDRS_CONTROL_PEER_ENTER) {
+			TDRS_LOG_INFO("Hub: Peer " << peer.id << " entered the overlay.");
+			_discoveredPeers[peer.id] = peer.publisher;
+			// Peers that do not announce a key are ordered by their identifier
+			_overlay.enter((peer.key.empty() ? peer.id : peer.key), peer.id);
+		} else {
+			TDRS_LOG_INFO("Hub: Peer " << peer.id << " exited the overlay.");
+			if(_discoveredPeers.erase(peer.id) == 0) {
+				TDRS_LOG_WARNING("Hub: Peer was not available.");
+			}
+			_overlay.exit(peer.id);
+		}
+
+		_updateOverlayLinks();
+	}
+
+	/**
+	 * @brief      Links to the discovered peers the overlay asks for, and
+	 * unlinks from the others. Hubs joining or leaving may move links
+	 * elsewhere, repairing the overlay.
+	 */
+	void Hub::_updateOverlayLinks() {
+		std::set<std::string> neighbors;
+		_overlay.neighbors(&neighbors);
+
+		std::set<std::string> linked;
+		std::vector<std::string> unlinked;
+		BOOST_FOREACH(_chainClientThread &client, _chainClientThreads) {
+			if(neighbors.count(client.params->id) == 0) {
+				unlinked.push_back(client.params->id);
+			} else {
+				linked.insert(client.params->id);
+			}
+		}
+
+		BOOST_FOREACH(const std::string &id, unlinked) {
+			TDRS_LOG_INFO("Hub: Exiting chain client thread for peer " << id << " ...");
+			_shutdownChainClientThread(id);
+		}
+
+		BOOST_FOREACH(const std::string &id, neighbors) {
+			std::map<std::string, std::string>::iterator peer = _discoveredPeers.find(id);
+			if(peer != _discoveredPeers.end() && linked.count(id) == 0) {
+				_runChainClientThread(peer->first, peer->second);
+			}
+		}
+
+		TDRS_LOG_INFO("Hub: Overlay of " << _overlay.size() << " hubs, linked to " << _chainClientThreads.size() << " of them.");
+	}
+
+	/**
+	 * @brief      Adds a discovered hub to the partition ring, or removes it,
+	 * closing the socket proxying events to it. The topics of a hub that
+	 * exits move to the hubs following it on the ring, all others stay.
+	 *
+	 * @param[in]  peer  The peer announcement
+	 */
+	void Hub::_updatePartitionRing(const peerMessage &peer) {
+		if(peer.event == TDRS_CONTROL_PEER_ENTER) {
+			partitionMember member;
+			member.receiver = peer.receiver;
+			member.publisher = peer.publisher;
+			member.proxy = peer.proxy;
+			// Peers that do not announce a key are ordered by their identifier
+			_partitionRing.add(peer.id, (peer.key.empty() ? peer.id : peer.key), member);
+			TDRS_LOG_INFO("Hub: Peer " << peer.id << " entered the partition ring.");
+		} else {
+			_partitionRing.remove(peer.id);
+			TDRS_LOG_INFO("Hub: Peer " << peer.id << " exited the partition ring.");
+		}
+
+		std::map<std::string, zmq::socket_t*>::iterator proxy = _partitionProxySockets.begin();
+		while(proxy != _partitionProxySockets.end()) {
+			if(_partitionRing.member(proxy->first) == NULL) {
+				proxy->second->close();
+				delete proxy->second;
+				_partitionProxySockets.erase(proxy++);
+			} else {
+				proxy++;
+			}
+		}
+
+		// Other hubs may not have seen the change yet
+		_partitionChangedAt = Hub::monotonicTime();
+		TDRS_LOG_INFO("Hub: Partition ring of " << _partitionRing.members().size() << " hubs.");
+	}
+
+	/**
+	 * @brief      Takes the events of an ingest job whose topic another hub
+	 * owns out of it. Events on the receiver are acked with `MOV <receiver>`,
+	 * naming the receiver of their owner, so the component can resend them
+	 * there; fire-and-forget events are proxied to the partition proxy
+	 * listener of their owner, or dropped if it has none or cannot keep up.
+	 *
+	 * Events arriving on the partition proxy listener or from chain clients
+	 * were partitioned by the hub they came from, so they are published as
+	 * they are, even if this hub's view of the ring differs. While the ring
+	 * settles after a change, hubs may disagree on owners and would redirect
+	 * components back and forth; events on the receiver are published right
+	 * away instead.
+	 *
+	 * @param      job   The ingest job
+	 */
+	void Hub::_partitionMessages(_ingestJob *job) {
+		std::string self = HubOverlay::memberKey(_hubId);
+		bool settling = (_partitionChangedAt > 0 && Hub::monotonicTime() < _partitionChangedAt + (uint64_t)TDRS_PARTITION_SETTLE_INTERVALS * _optionDiscoveryInterval * 1000000);
+
+		for(size_t event = 0; event < job->propagate.size(); event++) {
+			if(!job->propagate[event]) {
+				continue;
+			}
+
+			zmq::message_t &message = job->frames[job->events[event]];
+			const std::string &owner = _partitionRing.ownerOf(message.data(), message.size());
+			const partitionMember *member = _partitionRing.member(owner);
+			if(owner == self || member == NULL) {
+				continue;
+			}
+
+			if(job->respond && settling) {
+				_metricPartitionSettling++;
+				continue;
+			}
+
+			job->propagate[event] = false;
+
+			if(job->respond) {
+				job->responses[event] = "MOV " + member->receiver;
+				_metricPartitionRedirected++;
+				continue;
+			}
+
+			bool proxied = false;
+			if(!member->proxy.empty()) {
+				try {
+					std::map<std::string, zmq::socket_t*>::iterator proxy = _partitionProxySockets.find(owner);
+					if(proxy == _partitionProxySockets.end()) {
+						zmq::socket_t *socket = new zmq::socket_t(_zmqContext, ZMQ_PUSH);
+						int _zmqProxySocketLinger = 0;
+						socket->setsockopt(ZMQ_LINGER, &_zmqProxySocketLinger, sizeof(_zmqProxySocketLinger));
+						socket->setsockopt(ZMQ_SNDHWM, &_optionReceiverHwm, sizeof(_optionReceiverHwm));
+						socket->connect(member->proxy);
+						proxy = _partitionProxySockets.insert(std::make_pair(owner, socket)).first;
+						TDRS_LOG_INFO("Hub: Proxying events to hub " << owner << " at " << member->proxy << ".");
+					}
+
+					chainEnvelope envelope;
+					envelope.hops = 0;
+					envelope.origin = _hubId;
+					envelope.sequence = ++_originSequence;
+					envelope.relay = _hubId;
+					envelope.previousRelay = 0;
+					zmq::message_t envelopeFrame;
+					Hub::buildEnvelope(envelope, &envelopeFrame);
+
+					// Multipart messages are queued atomically, the envelope never fails once the event was taken
+					proxied = proxy->second->send(message, ZMQ_SNDMORE | ZMQ_DONTWAIT) && proxy->second->send(envelopeFrame, ZMQ_DONTWAIT);
+				} catch(...) {
+					TDRS_LOG_WARNING("Hub: Proxying event to hub " << owner << " failed!");
+				}
+			}
+
+			if(proxied) {
+				_metricPartitionProxied++;
+			} else {
+				_metricPartitionDropped++;
+			}
+		}
+	}
+
+	/**
+	 * @brief      Serves the handshake of a co-located publisher on the
+	 * shared-memory endpoint, creating a shared-memory ring for it. The
+	 * response is `SHM <ring> <wakeup FIFO>`, or `NOK SHM` for anything but
+	 * the handshake or once all rings are taken.
+	 */
+	void Hub::_serveShmHello() {
+		std::vector<zmq::message_t> request;
+
+		if(!Hub::_receiveFrames(_zmqShmSocket, request)) {
+			return;
+		}
+
+		if(_shmRings.size() >= TDRS_SHM_MAX_RINGS) {
+			// Rings of publishers that are gone make room once drained
+			_checkShmRings();
+			_drainShmRings();
+		}
+
+		std::string response = "NOK SHM";
+		if(request.size() != 1 || !HubShmRing::isHello(request[0])) {
+			TDRS_LOG_WARNING("Hub: Received malformed shared-memory handshake.");
+		} else if(_shmRings.size() >= TDRS_SHM_MAX_RINGS) {
+			TDRS_LOG_WARNING("Hub: Refusing shared-memory ring.");
+		} else {
+			std::ostringstream path;
+			path << _optionShmDir << "/tdrs-" << HubOverlay::memberKey(_hubId) << "-" << _shmRingSequence++;
+			HubShmRing *ring = new HubShmRing;
+			if(ring->create(path.str(), _optionShmRingSize)) {
+				_shmRings.push_back(ring);
+				TDRS_LOG_INFO("Hub: Created shared-memory ring " << ring->path() << ", " << _shmRings.size() << " rings.");
+				response = "SHM " + ring->path() + " " + _shmWakePath;
+			} else {
+				delete ring;
+			}
+		}
+
+		zmq::message_t message(response.size());
+		memcpy(message.data(), response.data(), response.size());
+
+		try {
+			_zmqShmSocket.send(message);
+		} catch(...) {
+			TDRS_LOG_WARNING("Hub: Sending shared-memory response failed!");
+		}
+	}
+
+	/**
+	 * @brief      Dispatches the events waiting in the shared-memory rings,
+	 * up to a batch per ring so no ring starves the others or the sockets,
+	 * and removes the rings closed and drained. Rings left empty are armed
+	 * for their publisher to wake up the run-loop.
+	 *
+	 * @return     True if events are left waiting, false otherwise.
+	 */
+	bool Hub::_drainShmRings() {
+		bool waiting = false;
+
+		if(Hub::monotonicTime() >= _shmCheckedAt + (uint64_t)TDRS_SHM_LIVENESS_INTERVAL * 1000000) {
+			_checkShmRings();
+		}
+
+		std::vector<HubShmRing*>::iterator ring = _shmRings.begin();
+		while(ring != _shmRings.end()) {
+			_ingestJob *job = new _ingestJob;
+			size_t count = (*ring)->read(job->frames, TDRS_SHM_DRAIN_BATCH);
+			if(count > 0) {
+				job->first = 0;
+				job->responseFrames = 0;
+				job->respond = false;
+				job->relayed = false;
+				_metricShmEvents += count;
+				_dispatchJob(job);
+			} else {
+				delete job;
+			}
+
+			// Publishers close their ring after their last event, so a ring found closed first and empty then is drained
+			if((*ring)->closed() && (*ring)->empty()) {
+				TDRS_LOG_INFO("Hub: Removing closed shared-memory ring " << (*ring)->path() << ".");
+				delete *ring;
+				ring = _shmRings.erase(ring);
+				continue;
+			}
+
+			if(!(*ring)->empty()) {
+				waiting = true;
+			}
+
+			ring++;
+		}
+
+		if(waiting) {
+			return true;
+		}
+
+		BOOST_FOREACH(HubShmRing *armed, _shmRings) {
+			if(!armed->sleep()) {
+				waiting = true;
+			}
+		}
+
+		return waiting;
+	}
+
+	/**
+	 * @brief      Abandons the shared-memory rings whose publishers crashed or
+	 * were killed without closing them, or never attached, for them to be
+	 * drained and removed like closed ones.
+	 */
+	void Hub::_checkShmRings() {
+		_shmCheckedAt = Hub::monotonicTime();
+
+		BOOST_FOREACH(HubShmRing *ring, _shmRings) {
+			if(!ring->closed() && !ring->alive(_shmCheckedAt)) {
+				TDRS_LOG_WARNING("Hub: Publisher of shared-memory ring " << ring->path() << " is gone, reclaiming it.");
+				ring->abandon();
+			}
+		}
+	}
+
+	/**
+	 * @brief      Serves one request on the partition listener. The request
+	 * is a topic, the response names the receiver and publisher of the hub
+	 * owning it, as `<receiver> <publisher>`; an empty request is responded
+	 * to with one such line per hub of the ring.
+	 */
+	void Hub::_servePartition() {
+		std::vector<zmq::message_t> request;
+
+		if(!Hub::_receiveFrames(_zmqPartitionSocket, request)) {
+			return;
+		}
+
+		std::string response;
+		if(request.back().size() > 0) {
+			const partitionMember *member = _partitionRing.member(_partitionRing.owner(static_cast<const char*>(request.back().data()), request.back().size()));
+			if(member != NULL) {
+				response = member->receiver + " " + member->publisher;
+			}
+		} else {
+			std::map<std::string, partitionMember>::const_iterator member;
+			for(member = _partitionRing.members().begin(); member != _partitionRing.members().end(); member++) {
+				if(!response.empty()) {
+					response += "\n";
+				}
+				response += member->second.receiver + " " + member->second.publisher;
+			}
+		}
+
+		zmq::message_t message(response.size());
+		memcpy(message.data(), response.data(), response.size());
+
+		try {
+			_zmqPartitionSocket.send(message);
+		} catch(...) {
+			TDRS_LOG_WARNING("Hub: Sending partition response failed!");
+		}
+	}
+
+	/**
+	 * @brief      Serves one event proxied by another hub, as
+	 * `[event][envelope]`, without responding. The proxying hub found this
+	 * hub owning its topic, so it is published here without partitioning it
+	 * again, even while the hubs disagree on owners.
+	 */
+	void Hub::_servePartitionProxy() {
+		_ingestJob *job = new _ingestJob;
+
+		if(!Hub::_receiveFrames(_zmqPartitionProxySocket, job->frames)) {
+			delete job;
+			return;
+		}
+
+		job->first = 0;
+		job->responseFrames = 0;
+		job->respond = false;
+		job->relayed = true;
+		_dispatchJob(job);
+	}
+
+	/**
+	 * @brief      Serves the subscription messages on the publisher, with
+	 * --chain-subscriptions only, applying them to the subscriber they came
+	 * from and updating the subscription table the chain clients subscribe
+	 * by. Subscriptions to everything are applied as subscriptions to every
+	 * first byte but the one of the control topics, and to heartbeats, so
+	 * plain subscribers never match the hello. The hello is published once a
+	 * chain client subscribes to it.
+	 */
+	void Hub::_serveSubscriptions() {
+		bool hello = false;
+
+		pthread_mutex_lock(&_subscriptionTableMutex);
+
+		while(true) {
+			zmq::message_t subscription;
+
+			try {
+				if(!_zmqHubSocket.recv(&subscription, ZMQ_DONTWAIT)) {
+					break;
+				}
+			} catch(...) {
+				break;
+			}
+
+			const unsigned char *data = static_cast<const unsigned char*>(subscription.data());
+			if(subscription.size() < 1 || (data[0] != 0 && data[0] != 1)) {
+				continue;
+			}
+
+			bool subscribe = (data[0] == 1);
+			std::string topic(reinterpret_cast<const char*>(data + 1), subscription.size() - 1);
+			hello = (hello || (subscribe && topic == TDRS_CHAIN_HELLO_TOPIC));
+
+			// Applied topics come back as unsubscriptions once the subscriber is gone, so the table counts them
+			std::vector<std::string> topics;
+			size_t viaSize = strlen(TDRS_CHAIN_VIA_TOPIC) + 8;
+			if(topic.empty() || (topic.size() == viaSize && topic.compare(0, strlen(TDRS_CHAIN_VIA_TOPIC), TDRS_CHAIN_VIA_TOPIC) == 0)) {
+				for(int byte = 0; byte < 0xFF; byte++) {
+					topics.push_back(topic + (char)byte);
+				}
+				if(topic.empty()) {
+					topics.push_back(TDRS_CHAIN_HEARTBEAT_TOPIC);
+				}
+			} else {
+				topics.push_back(topic);
+			}
+
+			bool changed = false;
+			BOOST_FOREACH(const std::string &applied, topics) {
+				try {
+					_zmqHubSocket.setsockopt((subscribe ? ZMQ_SUBSCRIBE : ZMQ_UNSUBSCRIBE), applied.data(), applied.size());
+				} catch(...) {
+					TDRS_LOG_WARNING("Hub: Applying subscription failed!");
+				}
+
+				std::string update = (char)data[0] + applied;
+				changed = (_subscriptionTable.update(update.data(), update.size()) || changed);
+			}
+
+			if(changed) {
+				TDRS_LOG_DEBUG("Hub: Subscription changed, " << _subscriptionTable.size() << " prefixes subscribed to.");
+			}
+		}
+
+		pthread_mutex_unlock(&_subscriptionTableMutex);
+
+		if(hello) {
+			// Tells chain clients which hub they are linked to
+			std::string topic = HubSubscriptionTable::helloTopic(_hubId);
+			try {
+				_zmqHubSocket.send(topic.data(), topic.size(), ZMQ_DONTWAIT);
+			} catch(...) {
+				TDRS_LOG_WARNING("Hub: Sending hello to chain clients failed!");
+			}
+		}
+	}
+
+	/**
+	 * @brief      Serves the subscription messages of batched chain links. The
+	 * links asking for the same spec share one chain batcher, which lives
+	 * as long as any of them is subscribed.
+	 */
+	void Hub::_serveChainBatchSubscriptions() {
+		while(true) {
+			zmq::message_t subscription;
+
+			try {
+				if(!_zmqChainBatchSocket.recv(&subscription, ZMQ_DONTWAIT)) {
+					break;
+				}
+			} catch(...) {
+				break;
+			}
+
+			const unsigned char *data = static_cast<const unsigned char*>(subscription.data());
+			size_t heartbeatSize = strlen(TDRS_CHAIN_HEARTBEAT_TOPIC);
+			if(subscription.size() == heartbeatSize + 1 && memcmp(data + 1, TDRS_CHAIN_HEARTBEAT_TOPIC, heartbeatSize) == 0) {
+				// Batched links take heartbeats along with their batches
+				continue;
+			}
+
+			chainBatchSpec spec;
+			if(subscription.size() < 1 || (data[0] != 0 && data[0] != 1) || !HubChainBatcher::parseTopic(data + 1, subscription.size() - 1, &spec)) {
+				TDRS_LOG_DEBUG("Hub: Ignoring invalid chain batch subscription.");
+				continue;
+			}
+
+			std::string topic(reinterpret_cast<const char*>(data + 1), subscription.size() - 1);
+			std::map<std::string, HubChainBatcher*>::iterator batcher = _chainBatchers.find(topic);
+
+			if(data[0] == 1) {
+				if(batcher == _chainBatchers.end()) {
+					batcher = _chainBatchers.insert(std::make_pair(topic, new HubChainBatcher(spec))).first;
+				}
+				batcher->second->subscribe();
+				TDRS_LOG_INFO("Hub: Chain link subscribed to batches with codec " << (int)spec.codec << " of " << spec.size << " bytes or " << spec.window << " us.");
+			} else if(batcher != _chainBatchers.end() && batcher->second->unsubscribe() == 0) {
+				if(!batcher->second->empty()) {
+					_sendChainBatch(batcher->second);
+				}
+				delete batcher->second;
+				_chainBatchers.erase(batcher);
+				TDRS_LOG_INFO("Hub: Last chain link unsubscribed from batches with codec " << (int)spec.codec << " of " << spec.size << " bytes or " << spec.window << " us.");
+			}
+		}
+	}
+
+	/**
+	 * @brief      Adds a published event to the open batch of every chain
+	 * batcher, flushing the batches reaching their size. The batches carry
+	 * the event and its envelope; batched links take no offsets.
+	 *
+	 * @param[in]  event  The event
+	 */
+	void Hub::_batchEvent(const _publisherEvent &event) {
+		if(_chainBatchers.empty()) {
+			return;
+		}
+
+		uint64_t now = Hub::monotonicTime();
+		std::map<std::string, HubChainBatcher*>::iterator batcher;
+		for(batcher = _chainBatchers.begin(); batcher != _chainBatchers.end(); batcher++) {
+			if(batcher->second->append(event.payload.data(), event.payload.size(), event.envelope.data(), (event.enveloped ? event.envelope.size() : 0), now)) {
+				_sendChainBatch(batcher->second);
+			}
+		}
+	}
+
+	/**
+	 * @brief      Sends the batch of a chain batcher as `[topic][batch]`,
+	 * without blocking; like the publisher, the listener drops the batches
+	 * of links that cannot keep up.
+	 *
+	 * @param      batcher  The chain batcher
+	 */
+	void Hub::_sendChainBatch(HubChainBatcher *batcher) {
+		zmq::message_t topic;
+		zmq::message_t batch;
+		size_t decodedSize = batcher->flush(&topic, &batch);
+		size_t sentSize = batch.size();
+
+		try {
+			if(!_zmqChainBatchSocket.send(topic, ZMQ_SNDMORE | ZMQ_DONTWAIT) || !_zmqChainBatchSocket.send(batch, ZMQ_DONTWAIT)) {
+				return;
+			}
+		} catch(...) {
+			TDRS_LOG_WARNING("Hub: Sending chain batch failed!");
+			return;
+		}
+
+		_metricChainBatches++;
+		_metricChainBatchBytesDecoded += decodedSize;
+		_metricChainBatchBytesSent += sentSize;
+	}
+
+	/**
+	 * @brief      Sends the batches whose flush window passed, or all of them.
+	 *
+	 * @param[in]  all   Whether to send all batches
+	 *
+	 * @return     The time (ms) until the next batch is due, rounded up, -1 for none.
+	 */
+	long Hub::_flushChainBatches(bool all) {
+		long timeout = -1;
+
+		if(_chainBatchers.empty()) {
+			return timeout;
+		}
+
+		uint64_t now = Hub::monotonicTime();
+		std::map<std::string, HubChainBatcher*>::iterator batcher;
+		for(batcher = _chainBatchers.begin(); batcher != _chainBatchers.end(); batcher++) {
+			if(batcher->second->empty()) {
+				continue;
+			}
+
+			uint64_t deadline = batcher->second->deadline();
+			if(all || deadline <= now) {
+				_sendChainBatch(batcher->second);
+			} else {
+				long due = (long)((deadline - now + 999999) / 1000000);
+				if(timeout < 0 || due < timeout) {
+					timeout = due;
+				}
+			}
+		}
+
+		return timeout;
+	}
+
+	/**
+	 * @brief      Publishes a chain heartbeat to the chain links, on the
+	 * publisher and the chain batch listener, if it is due. Heartbeats are
+	 * sent without blocking; a link too backed up to take one is receiving
+	 * events anyway. Under the drop overflow policies the publisher refuses
+	 * every event while any subscriber is full, so heartbeats are sent lossy,
+	 * reaching every link with room even while events are held back.
+	 *
+	 * @return     The time (ms) until the next heartbeat is due, rounded up, -1 for none.
+	 */
+	long Hub::_sendHeartbeat() {
+		if(_optionChainHeartbeatInterval <= 0) {
+			return -1;
+		}
+
+		uint64_t now = Hub::monotonicTime();
+		if(now >= _nextHeartbeatAt) {
+			size_t heartbeatSize = strlen(TDRS_CHAIN_HEARTBEAT_TOPIC);
+			try {
+				bool sent;
+				if(_optionOverflowPolicy != TDRS_OVERFLOW_LOSSY) {
+					int nodrop = 0;
+					_zmqHubSocket.setsockopt(ZMQ_XPUB_NODROP, &nodrop, sizeof(nodrop));
+					sent = _zmqHubSocket.send(TDRS_CHAIN_HEARTBEAT_TOPIC, heartbeatSize, ZMQ_DONTWAIT);
+					nodrop = 1;
+					_zmqHubSocket.setsockopt(ZMQ_XPUB_NODROP, &nodrop, sizeof(nodrop));
+				} else {
+					sent = _zmqHubSocket.send(TDRS_CHAIN_HEARTBEAT_TOPIC, heartbeatSize, ZMQ_DONTWAIT);
+				}
+
+				if(!_optionChainBatchListen.empty() && !_zmqChainBatchSocket.send(TDRS_CHAIN_HEARTBEAT_TOPIC, heartbeatSize, ZMQ_DONTWAIT)) {
+					sent = false;
+				}
+
+				if(!sent) {
+					_metricChainHeartbeatsFailed++;
+				}
+			} catch(...) {
+				_metricChainHeartbeatsFailed++;
+				TDRS_LOG_WARNING("Hub: Sending chain heartbeat failed!");
+			}
+			_nextHeartbeatAt = now + (uint64_t)_optionChainHeartbeatInterval * 1000000;
+		}
+
+		return (long)((_nextHeartbeatAt - now + 999999) / 1000000);
+	}
+
+	/**
+	 * @brief      Serves one request on the metrics endpoint, responding with
+	 * the current metrics, whatever was asked for.
+	 */
+	void Hub::_serveMetrics() {
+		std::vector<zmq::message_t> request;
+
+		if(!Hub::_receiveFrames(_zmqMetricsSocket, request)) {
+			return;
+		}
+
+		std::string metrics = _renderMetrics();
+		zmq::message_t response(metrics.size());
+		memcpy(response.data(), metrics.data(), metrics.size());
+
+		try {
+			_zmqMetricsSocket.send(response);
+		} catch(...) {
+			TDRS_LOG_WARNING("Hub: Sending metrics failed!");
+		}
+	}
+
+	/**
+	 * @brief      Renders the metrics in the Prometheus text format. Rates are
+	 * per second, since the previous metrics request.
+	 *
+	 * @return     The metrics.
+	 */
+	std::string Hub::_renderMetrics() {
+		std::ostringstream metrics;
+		uint64_t now = Hub::monotonicTime();
+		double elapsed = (now - _metricsRequestedAt) / 1e9;
+
+		metrics << "# TYPE tdrs_events_received_total counter\n";
+		metrics << "tdrs_events_received_total " << _metricEventsReceived << "\n";
+		metrics << "# TYPE tdrs_events_published_total counter\n";
+		metrics << "tdrs_events_published_total " << _metricEventsPublished << "\n";
+		metrics << "# TYPE tdrs_acks_failed_total counter\n";
+		metrics << "tdrs_acks_failed_total " << _metricAcksFailed << "\n";
+		metrics << "# TYPE tdrs_events_received_per_second gauge\n";
+		metrics << "tdrs_events_received_per_second " << (elapsed > 0 ? (_metricEventsReceived - _metricsRequestedReceived) / elapsed : 0) << "\n";
+		metrics << "# TYPE tdrs_events_published_per_second gauge\n";
+		metrics << "tdrs_events_published_per_second " << (elapsed > 0 ? (_metricEventsPublished - _metricsRequestedPublished) / elapsed : 0) << "\n";
+
+		_metricsRequestedAt = now;
+		_metricsRequestedReceived = _metricEventsReceived;
+		_metricsRequestedPublished = _metricEventsPublished;
+
+		metrics << "# TYPE tdrs_chain_link_forwarded_total counter\n";
+		BOOST_FOREACH(_chainClientThread &client, _chainClientThreads) {
+			metrics << "tdrs_chain_link_forwarded_total{link=\"" << client.params->link << "\"} " << client.params->forwarded.load() << "\n";
+		}
+		metrics << "# TYPE tdrs_chain_link_discarded_total counter\n";
+		BOOST_FOREACH(_chainClientThread &client, _chainClientThreads) {
+			metrics << "tdrs_chain_link_discarded_total{link=\"" << client.params->link << "\"} " << client.params->discarded.load() << "\n";
+		}
+		metrics << "# TYPE tdrs_chain_heartbeats_failed_total counter\n";
+		metrics << "tdrs_chain_heartbeats_failed_total " << _metricChainHeartbeatsFailed << "\n";
+		metrics << "# TYPE tdrs_chain_link_state gauge\n";
+		BOOST_FOREACH(_chainClientThread &client, _chainClientThreads) {
+			metrics << "tdrs_chain_link_state{link=\"" << client.params->link << "\"} " << client.params->state.load() << "\n";
+		}
+		metrics << "# TYPE tdrs_chain_link_reconnects_total counter\n";
+		BOOST_FOREACH(_chainClientThread &client, _chainClientThreads) {
+			metrics << "tdrs_chain_link_reconnects_total{link=\"" << client.params->link << "\"} " << client.params->reconnects.load() << "\n";
+		}
+
+		metrics << "# TYPE tdrs_partition_hubs gauge\n";
+		metrics << "tdrs_partition_hubs " << _partitionRing.members().size() << "\n";
+		metrics << "# TYPE tdrs_partition_redirected_total counter\n";
+		metrics << "tdrs_partition_redirected_total " << _metricPartitionRedirected << "\n";
+		metrics << "# TYPE tdrs_partition_proxied_total counter\n";
+		metrics << "tdrs_partition_proxied_total " << _metricPartitionProxied << "\n";
+		metrics << "# TYPE tdrs_partition_dropped_total counter\n";
+		metrics << "tdrs_partition_dropped_total " << _metricPartitionDropped << "\n";
+		metrics << "# TYPE tdrs_partition_settling_total counter\n";
+		metrics << "tdrs_partition_settling_total " << _metricPartitionSettling << "\n";
+
+		metrics << "# TYPE tdrs_shm_rings gauge\n";
+		metrics << "tdrs_shm_rings " << _shmRings.size() << "\n";
+		metrics << "# TYPE tdrs_shm_events_total counter\n";
+		metrics << "tdrs_shm_events_total " << _metricShmEvents << "\n";
+
+		pthread_mutex_lock(&_dedupIndexMutex);
+		dedupIndexStats stats = _dedupIndex.stats();
+		sequenceWindowStats windowStats = _sequenceWindow.stats();
+		pthread_mutex_unlock(&_dedupIndexMutex);
+
+		metrics << "# TYPE tdrs_dedup_index_entries gauge\n";
+		metrics << "tdrs_dedup_index_entries " << stats.entries << "\n";
+		metrics << "# TYPE tdrs_dedup_index_bytes gauge\n";
+		metrics << "tdrs_dedup_index_bytes " << stats.bytes << "\n";
+		metrics << "# TYPE tdrs_dedup_index_matched_total counter\n";
+		metrics << "tdrs_dedup_index_matched_total " << stats.matched << "\n";
+		metrics << "# TYPE tdrs_dedup_index_expired_total counter\n";
+		metrics << "tdrs_dedup_index_expired_total " << stats.expired << "\n";
+		metrics << "# TYPE tdrs_dedup_index_evicted_total counter\n";
+		metrics << "tdrs_dedup_index_evicted_total " << stats.evicted << "\n";
+		metrics << "# TYPE tdrs_sequence_window_origins gauge\n";
+		metrics << "tdrs_sequence_window_origins " << windowStats.origins << "\n";
+		metrics << "# TYPE tdrs_sequence_window_duplicates_total counter\n";
+		metrics << "tdrs_sequence_window_duplicates_total " << windowStats.duplicates << "\n";
+		metrics << "# TYPE tdrs_sequence_window_stale_total counter\n";
+		metrics << "tdrs_sequence_window_stale_total " << windowStats.stale << "\n";
+
+		pthread_mutex_lock(&_subscriptionTableMutex);
+		size_t prefixes = _subscriptionTable.size();
+		pthread_mutex_unlock(&_subscriptionTableMutex);
+
+		metrics << "# TYPE tdrs_subscription_prefixes gauge\n";
+		metrics << "tdrs_subscription_prefixes " << prefixes << "\n";
+
+		metrics << "# TYPE tdrs_publisher_backlog gauge\n";
+		metrics << "tdrs_publisher_backlog " << _publisherBacklog.size() << "\n";
+		metrics << "# TYPE tdrs_publisher_dropped_total counter\n";
+		metrics << "tdrs_publisher_dropped_total{policy=\"drop-newest\"} " << _publisherStats.droppedNewest << "\n";
+		metrics << "tdrs_publisher_dropped_total{policy=\"drop-oldest\"} " << _publisherStats.droppedOldest << "\n";
+
+		if(!_optionJournalDir.empty()) {
+			journalStats journal = _journal.stats();
+			metrics << "# TYPE tdrs_journal_first_offset gauge\n";
+			metrics << "tdrs_journal_first_offset " << journal.firstOffset << "\n";
+			metrics << "# TYPE tdrs_journal_next_offset gauge\n";
+			metrics << "tdrs_journal_next_offset " << journal.nextOffset << "\n";
+			metrics << "# TYPE tdrs_journal_segments gauge\n";
+			metrics << "tdrs_journal_segments " << journal.segments << "\n";
+			metrics << "# TYPE tdrs_journal_bytes gauge\n";
+			metrics << "tdrs_journal_bytes " << journal.bytes << "\n";
+			metrics << "# TYPE tdrs_journal_segments_removed_total counter\n";
+			metrics << "tdrs_journal_segments_removed_total " << journal.removed << "\n";
+		}
+
+		if(!_optionChainBatchListen.empty()) {
+			metrics << "# TYPE tdrs_chain_batches_total counter\n";
+			metrics << "tdrs_chain_batches_total " << _metricChainBatches << "\n";
+			metrics << "# TYPE tdrs_chain_batch_decoded_bytes_total counter\n";
+			metrics << "tdrs_chain_batch_decoded_bytes_total " << _metricChainBatchBytesDecoded << "\n";
+			metrics << "# TYPE tdrs_chain_batch_sent_bytes_total counter\n";
+			metrics << "tdrs_chain_batch_sent_bytes_total " << _metricChainBatchBytesSent << "\n";
+		}
+
+		if(_optionCacheSize > 0) {
+			lastValueCacheStats cache = _lastValueCache.stats();
+			metrics << "# TYPE tdrs_cache_entries gauge\n";
+			metrics << "tdrs_cache_entries " << cache.entries << "\n";
+			metrics << "# TYPE tdrs_cache_bytes gauge\n";
+			metrics << "tdrs_cache_bytes " << cache.bytes << "\n";
+			metrics << "# TYPE tdrs_cache_evicted_total counter\n";
+			metrics << "tdrs_cache_evicted_total " << cache.evicted << "\n";
+		}
+
+		const char *stages[] = { "hash", "publish", "ack", "total" };
+		const HubHistogram *histograms[] = { &_metricHashLatency, &_metricPublishLatency, &_metricAckLatency, &_metricTotalLatency };
+		const double quantiles[] = { 0.5, 0.9, 0.99, 0.999, 1.0 };
+
+		metrics << "# TYPE tdrs_stage_latency_seconds summary\n";
+		for(size_t stage = 0; stage < 4; stage++) {
+			BOOST_FOREACH(double quantile, quantiles) {
+				metrics << "tdrs_stage_latency_seconds{stage=\"" << stages[stage] << "\",quantile=\"" << quantile << "\"} " << (histograms[stage]->quantile(quantile) / 1e9) << "\n";
+			}
+			metrics << "tdrs_stage_latency_seconds_sum{stage=\"" << stages[stage] << "\"} " << (histograms[stage]->sum() / 1e9) << "\n";
+			metrics << "tdrs_stage_latency_seconds_count{stage=\"" << stages[stage] << "\"} " << histograms[stage]->count() << "\n";
+		}
+
+		return metrics.str();
+	}
+
+	/**
+	 * @brief      Requests an exit of the run-loop on its next iteration.
+	 */
+	void Hub::shutdown() {
+		_runLoop = false;
+	}
+
+	/**
+	 * @brief      Runs the Hub.
+	 */
+	void Hub::run() {
+		// Open the journal, if requested, before anything gets published
+		if(!_optionJournalDir.empty() && !_journal.open()) {
+			TDRS_LOG_ERROR("Hub: Error, opening the journal failed.");
+			return;
+		}
+
+		// Create the wakeup FIFO of the shared-memory rings, if requested
+		if(!_optionShmDir.empty() && !_bindShm()) {
+			TDRS_LOG_ERROR("Hub: Error, binding the shared-memory transport failed.");
+			return;
+		}
+
+		// Bind the publisher
+		_bindPublisher();
+		// Bind the chain batch listener, if requested
+		if(!_optionChainBatchListen.empty()) {
+			_bindChainBatch();
+		}
+		// Bind the receiver
+		_bindReceiver();
+		// Bind the ingest, if requested
+		if(!_optionIngestListen.empty()) {
+			_bindIngest();
+		}
+
+		// Bind the metrics endpoint, if requested
+		if(!_optionMetricsListen.empty()) {
+			_bindMetrics();
+		}
+		// Bind the chain endpoint, before any chain client connects to it
+		_bindChain();
+
+		if(_optionChainReactor) {
+			// Run the chain reactor thread, serving all chain links
+			_runChainReactorThread();
+		}
+
+		if(!_optionReplayListen.empty()) {
+			// Run the replay server thread, streaming the journal
+			_runReplayServerThread();
+		}
+
+		if(!_optionSnapshotListen.empty()) {
+			// Run the snapshot server thread, sending the last-value cache
+			_runSnapshotServerThread();
+		}
+
+		if(_optionWorkers > 1) {
+			// Run the ingest worker threads
+			_runIngestWorkerThreads();
+		}
+
+		if(_optionPartition) {
+			// This hub owns its share of the topics from the start, named by its listeners on this host
+			std::regex wildcardRegex("(\\*|0\\.0\\.0\\.0)");
+			partitionMember self;
+			self.receiver = std::regex_replace(_optionReceiverListen, wildcardRegex, zsys_hostname());
+			self.publisher = std::regex_replace(_optionPublisherListen, wildcardRegex, zsys_hostname());
+			self.proxy = std::regex_replace(_optionPartitionProxyListen, wildcardRegex, zsys_hostname());
+			_partitionRing.add("", HubOverlay::memberKey(_hubId), self);
+
+			_bindPartition();
+		}
+
+		if(_optionDiscovery == true) {
+			// Bind the control endpoint, before the discovery service listener connects to it
+			_bindControl();
+			// Run the discovery service threads
+			_runDisoveryServiceThreads();
+		} else {
+			// Run chain client threads
+			_runChainClientThreads();
+		}
+
+		TDRS_LOG_INFO("Hub: Launching run-loop ...");
+
+		zmq::pollitem_t pollItems[] = {
+			{ (void *)_zmqReceiverSocket, 0, ZMQ_POLLIN, 0 },
+			{ (void *)_zmqIngestSocket, 0, (short)(_optionIngestListen.empty() ? 0 : ZMQ_POLLIN), 0 },
+			{ (void *)_zmqResultsSocket, 0, (short)(_ingestWorkerThreads.empty() ? 0 : ZMQ_POLLIN), 0 },
+			{ (void *)_zmqHubSocket, 0, (short)(_optionChainSubscriptions ? ZMQ_POLLIN : 0), 0 },
+			{ (void *)_zmqChainSocket, 0, ZMQ_POLLIN, 0 },
+			{ (void *)_zmqMetricsSocket, 0, (short)(_optionMetricsListen.empty() ? 0 : ZMQ_POLLIN), 0 },
+			{ (void *)_zmqControlSocket, 0, (short)(_optionDiscovery ? ZMQ_POLLIN : 0), 0 },
+			{ (void *)_zmqChainBatchSocket, 0, (short)(_optionChainBatchListen.empty() ? 0 : ZMQ_POLLIN), 0 },
+			{ (void *)_zmqPartitionSocket, 0, (short)(_optionPartitionListen.empty() ? 0 : ZMQ_POLLIN), 0 },
+			{ NULL, _shmWakeFd, (short)(_shmWakeFd < 0 ? 0 : ZMQ_POLLIN), 0 },
+			{ (void *)_zmqPartitionProxySocket, 0, (short)(_optionPartitionProxyListen.empty() ? 0 : ZMQ_POLLIN), 0 },
+			{ (void *)_zmqShmSocket, 0, (short)(_shmWakeFd < 0 ? 0 : ZMQ_POLLIN), 0 }
+		};
+
+		// Run loop
+		while(_runLoop == true) {
+			// A busy REP receiver cannot take the next request until a worker has finished
+			pollItems[0].events = (_receiverBusy ? 0 : ZMQ_POLLIN);
+
+			// A backlogged publisher is retried, as XPUB never reports a subscriber having room again
+			long timeout = -1;
+			if(!_publisherBacklog.empty()) {
+				timeout = TDRS_PUBLISHER_RETRY_INTERVAL;
+			} else if(!_optionJournalDir.empty()) {
+				timeout = TDRS_JOURNAL_MAINTAIN_INTERVAL;
+			}
+
+			// Batches are sent once due, the run-loop wakes up for the next one
+			long batchTimeout = _flushChainBatches(false);
+			if(batchTimeout >= 0 && (timeout < 0 || batchTimeout < timeout)) {
+				timeout = batchTimeout;
+			}
+
+			// Heartbeats keep the chain links of other hubs up while no events flow
+			long heartbeatTimeout = _sendHeartbeat();
+			if(heartbeatTimeout >= 0 && (timeout < 0 || heartbeatTimeout < timeout)) {
+				timeout = heartbeatTimeout;
+			}
+
+			// Stopped chain client threads are joined once they wound down
+			if(!_stoppingChainClientThreads.empty()) {
+				_reapChainClientThreads(false);
+				if(!_stoppingChainClientThreads.empty() && (timeout < 0 || timeout > TDRS_CHAIN_POLL_INTERVAL)) {
+					timeout = TDRS_CHAIN_POLL_INTERVAL;
+				}
+			}
+
+			// Events waiting in shared-memory rings keep the run-loop from sleeping
+			if(_shmWakeFd >= 0 && _drainShmRings()) {
+				timeout = 0;
+			} else if(!_shmRings.empty() && (timeout < 0 || timeout > TDRS_SHM_LIVENESS_INTERVAL)) {
+				// The publishers of the rings are checked even while none writes
+				timeout = TDRS_SHM_LIVENESS_INTERVAL;
+			}
+
+			try {
+				zmq::poll(pollItems, 12, timeout);
+			} catch(...) {
+				continue;
+			}
+
+			if(!_optionJournalDir.empty()) {
+				_journal.maintain();
+			}
+
+			if(!_publisherBacklog.empty()) {
+				_flushPublisher();
+			}
+
+			if(pollItems[3].revents & ZMQ_POLLIN) {
+				_serveSubscriptions();
+			}
+
+			if(pollItems[7].revents & ZMQ_POLLIN) {
+				_serveChainBatchSubscriptions();
+			}
+
+			if(pollItems[2].revents & ZMQ_POLLIN) {
+				_serveResults();
+			}
+
+			// Peer announcements go first, not queueing behind events
+			if(pollItems[6].revents & ZMQ_POLLIN) {
+				_serveControl();
+			}
+
+			if(pollItems[0].revents & ZMQ_POLLIN) {
+				if(_optionReceiverMode == "router") {
+					_serveReceiverRouter();
+				} else {
+					_serveReceiverRep();
+				}
+			}
+
+			if(pollItems[1].revents & ZMQ_POLLIN) {
+				_serveIngest();
+			}
+
+			if(pollItems[4].revents & ZMQ_POLLIN) {
+				_serveChain();
+			}
+
+			if(pollItems[5].revents & ZMQ_POLLIN) {
+				_serveMetrics();
+			}
+
+			if(pollItems[8].revents & ZMQ_POLLIN) {
+				_servePartition();
+			}
+
+			if(pollItems[9].revents & ZMQ_POLLIN) {
+				HubShmRing::drainWake(_shmWakeFd);
+			}
+
+			if(pollItems[10].revents & ZMQ_POLLIN) {
+				_servePartitionProxy();
+			}
+
+			if(pollItems[11].revents & ZMQ_POLLIN) {
+				_serveShmHello();
+			}
+		}
+
+
+		if(_optionDiscovery == true) {
+			// Shutdown the discovery service threads
+			_shutdownDisoveryServiceThreads();
+			// Unbind the control endpoint
+			_unbindControl();
+		}
+
+		if(_optionPartition) {
+			// Unbind the partition listener and stop proxying
+			_unbindPartition();
+		}
+
+		if(_shmWakeFd >= 0) {
+			// Remove the shared-memory rings and their wakeup FIFO
+			_unbindShm();
+		}
+
+		pthread_mutex_lock(&_dedupIndexMutex);
+		dedupIndexStats stats = _dedupIndex.stats();
+		sequenceWindowStats windowStats = _sequenceWindow.stats();
+		pthread_mutex_unlock(&_dedupIndexMutex);
+		TDRS_LOG_INFO("Hub: Dedup index held " << stats.entries << " entries (~" << stats.bytes << " bytes); "
+			<< stats.inserted << " inserted, " << stats.matched << " matched, "
+			<< stats.expired << " expired, " << stats.evicted << " evicted.");
+		TDRS_LOG_INFO("Hub: Sequence window held " << windowStats.origins << " origins; "
+			<< windowStats.accepted << " accepted, " << windowStats.duplicates << " duplicates, "
+			<< windowStats.stale << " stale.");
+		TDRS_LOG_INFO("Hub: Publisher backlog held " << _publisherBacklog.size() << " events; "
+			<< _publisherStats.backlogged << " backlogged, " << _publisherStats.droppedNewest << " newest dropped, "
+			<< _publisherStats.droppedOldest << " oldest dropped.");
+
+		// Shutdown chain client threads, from auto discovery or manual setup
+		_shutdownChainClientThreads();
+
+		if(_optionChainReactor) {
+			// Shutdown the chain reactor thread
+			_shutdownChainReactorThread();
+		}
+
+		// Unbind the chain endpoint
+		_unbindChain();
+
+		if(!_ingestWorkerThreads.empty()) {
+			// Shutdown the ingest worker threads
+			_shutdownIngestWorkerThreads();
+		}
+
+		// Unbind the ingest
+		if(!_optionIngestListen.empty()) {
+			_unbindIngest();
+		}
+		// Unbind the metrics endpoint
+		if(!_optionMetricsListen.empty()) {
+			_unbindMetrics();
+		}
+		// Events the subscribers never had room for are lost, their initiators get a NOK
+		while(!_publisherBacklog.empty()) {
+			_publisherEvent *backlogged = _publisherBacklog.front();
+			_publisherBacklog.pop_front();
+			_settleEvent(backlogged, false);
+			delete backlogged;
+		}
+		// Unbind the receiver
+		_unbindReceiver();
+
+		if(!_optionSnapshotListen.empty()) {
+			// Shutdown the snapshot server thread
+			_shutdownSnapshotServerThread();
+		}
+
+		if(!_optionReplayListen.empty()) {
+			// Shutdown the replay server thread
+			_shutdownReplayServerThread();
+		}
+
+		// Close the journal, once nothing gets published anymore
+		if(!_optionJournalDir.empty()) {
+			_journal.close();
+		}
+
+		// Unbind the chain batch listener, sending the open batches
+		if(!_optionChainBatchListen.empty()) {
+			_unbindChainBatch();
+		}
 
-		// Unbind the receiver
-		_unbindReceiver();
 		// Unbind the publisher
 		_unbindPublisher();
 
-		std::cout << "Hub: Hasta la vista." << std::endl;
+		TDRS_LOG_INFO("Hub: Hasta la vista.");
 	}
 }
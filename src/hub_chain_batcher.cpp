@@ -0,0 +1,341 @@
+#include "tdrs.hpp"
+#include <cstring>
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object.
+	 *
+	 * @param[in]  spec  The spec
+	 */
+	HubChainBatcher::HubChainBatcher(const chainBatchSpec &spec) {
+		_spec = spec;
+		_topic = HubChainBatcher::topic(spec);
+		_subscribers = 0;
+		_count = 0;
+		_openedAt = 0;
+		_zstdContext = (spec.codec == TDRS_CHAIN_BATCH_CODEC_ZSTD ? ZSTD_createCCtx() : NULL);
+		_events.reserve(spec.size + TDRS_CHAIN_BATCH_RECORD_HEADER_SIZE);
+	}
+
+	/**
+	 * @brief      Destroys the object.
+	 */
+	HubChainBatcher::~HubChainBatcher() {
+		if(_zstdContext != NULL) {
+			ZSTD_freeCCtx(_zstdContext);
+		}
+	}
+
+	/**
+	 * @brief      Static method for encoding a 4 byte integer (big endian).
+	 *
+	 * @param      data   The data
+	 * @param[in]  value  The value
+	 */
+	void HubChainBatcher::_put32(unsigned char *data, uint32_t value) {
+		for(size_t index = 0; index < 4; index++) {
+			data[3 - index] = (unsigned char)(value >> (8 * index));
+		}
+	}
+
+	/**
+	 * @brief      Static method for decoding a 4 byte integer (big endian).
+	 *
+	 * @param[in]  data  The data
+	 *
+	 * @return     The value.
+	 */
+	uint32_t HubChainBatcher::_get32(const unsigned char *data) {
+		uint32_t value = 0;
+
+		for(size_t index = 0; index < 4; index++) {
+			value = (value << 8) | data[index];
+		}
+
+		return value;
+	}
+
+	/**
+	 * @brief      Static method for parsing a codec name.
+	 *
+	 * @param[in]  name   The name, one of 'none', 'lz4', 'zstd'
+	 * @param      codec  The codec
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool HubChainBatcher::parseCodec(const std::string &name, uint8_t *codec) {
+		if(name == "none") {
+			*codec = TDRS_CHAIN_BATCH_CODEC_NONE;
+		} else if(name == "lz4") {
+			*codec = TDRS_CHAIN_BATCH_CODEC_LZ4;
+		} else if(name == "zstd") {
+			*codec = TDRS_CHAIN_BATCH_CODEC_ZSTD;
+		} else {
+			return false;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief      Static method returning the topic a batched chain link
+	 * subscribes with.
+	 *
+	 * @param[in]  spec  The spec
+	 *
+	 * @return     The topic.
+	 */
+	std::string HubChainBatcher::topic(const chainBatchSpec &spec) {
+		unsigned char encoded[9];
+
+		encoded[0] = spec.codec;
+		HubChainBatcher::_put32(encoded + 1, spec.size);
+		HubChainBatcher::_put32(encoded + 5, spec.window);
+
+		return std::string(TDRS_CHAIN_BATCH_TOPIC) + std::string(reinterpret_cast<const char*>(encoded), sizeof(encoded));
+	}
+
+	/**
+	 * @brief      Static method for parsing a topic a batched chain link
+	 * subscribed with.
+	 *
+	 * @param[in]  data  The topic data
+	 * @param[in]  size  The topic size
+	 * @param      spec  The spec
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool HubChainBatcher::parseTopic(const void *data, size_t size, chainBatchSpec *spec) {
+		const unsigned char *bytes = static_cast<const unsigned char*>(data);
+		size_t topicSize = strlen(TDRS_CHAIN_BATCH_TOPIC);
+
+		if(size != topicSize + 9 || memcmp(bytes, TDRS_CHAIN_BATCH_TOPIC, topicSize) != 0) {
+			return false;
+		}
+
+		spec->codec = bytes[topicSize];
+		spec->size = HubChainBatcher::_get32(bytes + topicSize + 1);
+		spec->window = HubChainBatcher::_get32(bytes + topicSize + 5);
+
+		return (spec->codec <= TDRS_CHAIN_BATCH_CODEC_ZSTD && spec->size > 0 && spec->size <= TDRS_CHAIN_BATCH_MAX_SIZE);
+	}
+
+	/**
+	 * @brief      Static method for decoding a batch frame.
+	 *
+	 * @param[in]  batch        The batch frame
+	 * @param      zstdContext  The decompression context of the zstd codec
+	 * @param      events       The events, uncompressed
+	 * @param      count        The number of events
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool HubChainBatcher::decode(const zmq::message_t &batch, ZSTD_DCtx *zstdContext, std::string *events, uint32_t *count) {
+		const unsigned char *data = static_cast<const unsigned char*>(const_cast<zmq::message_t&>(batch).data());
+		size_t size = batch.size();
+
+		if(size < TDRS_CHAIN_BATCH_HEADER_SIZE
+			|| memcmp(data, TDRS_CHAIN_BATCH_MAGIC, 4) != 0
+			|| data[4] != TDRS_CHAIN_BATCH_VERSION) {
+			return false;
+		}
+
+		uint8_t codec = data[5];
+		*count = HubChainBatcher::_get32(data + 8);
+		uint32_t decodedSize = HubChainBatcher::_get32(data + 12);
+		const char *body = reinterpret_cast<const char*>(data + TDRS_CHAIN_BATCH_HEADER_SIZE);
+		size_t bodySize = size - TDRS_CHAIN_BATCH_HEADER_SIZE;
+
+		if(decodedSize > TDRS_CHAIN_BATCH_MAX_DECODED_SIZE) {
+			return false;
+		}
+
+		switch(codec) {
+			case TDRS_CHAIN_BATCH_CODEC_NONE:
+				if(bodySize != decodedSize) {
+					return false;
+				}
+				events->assign(body, bodySize);
+				break;
+			case TDRS_CHAIN_BATCH_CODEC_LZ4:
+				events->resize(decodedSize);
+				if(LZ4_decompress_safe(body, &(*events)[0], (int)bodySize, (int)decodedSize) != (int)decodedSize) {
+					return false;
+				}
+				break;
+			case TDRS_CHAIN_BATCH_CODEC_ZSTD: {
+				if(zstdContext == NULL) {
+					return false;
+				}
+				events->resize(decodedSize);
+				size_t decoded = ZSTD_decompressDCtx(zstdContext, &(*events)[0], decodedSize, body, bodySize);
+				if(ZSTD_isError(decoded) || decoded != decodedSize) {
+					return false;
+				}
+				break;
+			}
+			default:
+				return false;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief      Static method for reading the next event of decoded events.
+	 *
+	 * @param[in]  events        The events
+	 * @param      position      The position of the next event, advanced
+	 * @param      payload       The event
+	 * @param      payloadSize   The event size
+	 * @param      envelope      The envelope
+	 * @param      envelopeSize  The envelope size, 0 for none
+	 *
+	 * @return     True if there was an event, false otherwise.
+	 */
+	bool HubChainBatcher::nextEvent(const std::string &events, size_t *position, const char **payload, size_t *payloadSize, const char **envelope, size_t *envelopeSize) {
+		if(events.size() - *position < TDRS_CHAIN_BATCH_RECORD_HEADER_SIZE) {
+			return false;
+		}
+
+		const unsigned char *header = reinterpret_cast<const unsigned char*>(events.data() + *position);
+		size_t eventSize = HubChainBatcher::_get32(header);
+		size_t eventEnvelopeSize = HubChainBatcher::_get32(header + 4);
+		size_t available = events.size() - *position - TDRS_CHAIN_BATCH_RECORD_HEADER_SIZE;
+
+		if(eventSize > available || eventEnvelopeSize > available - eventSize) {
+			return false;
+		}
+
+		*payload = events.data() + *position + TDRS_CHAIN_BATCH_RECORD_HEADER_SIZE;
+		*payloadSize = eventSize;
+		*envelope = *payload + eventSize;
+		*envelopeSize = eventEnvelopeSize;
+		*position += TDRS_CHAIN_BATCH_RECORD_HEADER_SIZE + eventSize + eventEnvelopeSize;
+
+		return true;
+	}
+
+	/**
+	 * @brief      Counts a chain link subscribing to the batches.
+	 */
+	void HubChainBatcher::subscribe() {
+		_subscribers++;
+	}
+
+	/**
+	 * @brief      Counts a chain link unsubscribing from the batches.
+	 *
+	 * @return     The number of chain links still subscribed.
+	 */
+	size_t HubChainBatcher::unsubscribe() {
+		if(_subscribers > 0) {
+			_subscribers--;
+		}
+
+		return _subscribers;
+	}
+
+	/**
+	 * @brief      Adds an event to the open batch.
+	 *
+	 * @param[in]  payload       The event
+	 * @param[in]  payloadSize   The event size
+	 * @param[in]  envelope      The envelope
+	 * @param[in]  envelopeSize  The envelope size, 0 for none
+	 * @param[in]  now           The current time (ns)
+	 *
+	 * @return     True if the batch reached its size, false otherwise.
+	 */
+	bool HubChainBatcher::append(const void *payload, size_t payloadSize, const void *envelope, size_t envelopeSize, uint64_t now) {
+		unsigned char header[TDRS_CHAIN_BATCH_RECORD_HEADER_SIZE];
+
+		if(_count == 0) {
+			_openedAt = now;
+		}
+
+		HubChainBatcher::_put32(header, (uint32_t)payloadSize);
+		HubChainBatcher::_put32(header + 4, (uint32_t)envelopeSize);
+		_events.append(reinterpret_cast<const char*>(header), sizeof(header));
+		_events.append(static_cast<const char*>(payload), payloadSize);
+		if(envelopeSize > 0) {
+			_events.append(static_cast<const char*>(envelope), envelopeSize);
+		}
+		_count++;
+
+		return (_events.size() >= _spec.size);
+	}
+
+	/**
+	 * @brief      Returns whether the open batch is empty.
+	 *
+	 * @return     True if empty, false otherwise.
+	 */
+	bool HubChainBatcher::empty() const {
+		return (_count == 0);
+	}
+
+	/**
+	 * @brief      Returns the time the open batch is due at, its flush window
+	 * after it got its first event.
+	 *
+	 * @return     The time (ns).
+	 */
+	uint64_t HubChainBatcher::deadline() const {
+		return _openedAt + (uint64_t)_spec.window * 1000;
+	}
+
+	/**
+	 * @brief      Compresses the open batch into a message and starts a new
+	 * one. Batches the codec cannot shrink are sent uncompressed.
+	 *
+	 * @param      topic  The topic frame
+	 * @param      batch  The batch frame
+	 *
+	 * @return     The size (bytes) of the events uncompressed.
+	 */
+	size_t HubChainBatcher::flush(zmq::message_t *topic, zmq::message_t *batch) {
+		size_t decodedSize = _events.size();
+		uint8_t codec = _spec.codec;
+		size_t compressedSize = 0;
+
+		if(codec == TDRS_CHAIN_BATCH_CODEC_LZ4) {
+			_compressed.resize(LZ4_compressBound((int)decodedSize));
+			int compressed = LZ4_compress_default(_events.data(), &_compressed[0], (int)decodedSize, (int)_compressed.size());
+			compressedSize = (compressed > 0 ? (size_t)compressed : 0);
+		} else if(codec == TDRS_CHAIN_BATCH_CODEC_ZSTD) {
+			_compressed.resize(ZSTD_compressBound(decodedSize));
+			size_t compressed = ZSTD_compressCCtx(_zstdContext, &_compressed[0], _compressed.size(), _events.data(), decodedSize, TDRS_CHAIN_BATCH_ZSTD_LEVEL);
+			compressedSize = (ZSTD_isError(compressed) ? 0 : compressed);
+		}
+
+		if(compressedSize == 0 || compressedSize >= decodedSize) {
+			codec = TDRS_CHAIN_BATCH_CODEC_NONE;
+		}
+
+		const std::string &body = (codec == TDRS_CHAIN_BATCH_CODEC_NONE ? _events : _compressed);
+		size_t bodySize = (codec == TDRS_CHAIN_BATCH_CODEC_NONE ? decodedSize : compressedSize);
+
+		topic->rebuild(_topic.size());
+		memcpy(topic->data(), _topic.data(), _topic.size());
+
+		batch->rebuild(TDRS_CHAIN_BATCH_HEADER_SIZE + bodySize);
+		unsigned char *data = static_cast<unsigned char*>(batch->data());
+		memcpy(data, TDRS_CHAIN_BATCH_MAGIC, 4);
+		data[4] = TDRS_CHAIN_BATCH_VERSION;
+		data[5] = codec;
+		data[6] = 0;
+		data[7] = 0;
+		HubChainBatcher::_put32(data + 8, _count);
+		HubChainBatcher::_put32(data + 12, (uint32_t)decodedSize);
+		memcpy(data + TDRS_CHAIN_BATCH_HEADER_SIZE, body.data(), bodySize);
+
+		_events.clear();
+		_count = 0;
+
+		return decodedSize;
+	}
+}
@@ -1,4 +1,5 @@
 #include "tdrs.hpp"
+#include <cstring>
 
 /**
  * tdrs namespace.
@@ -7,126 +8,551 @@ namespace tdrs {
 	/**
 	 * @brief      Constructs the object.
 	 *
-	 * @param[in]  ctxn  The number of context IO threads
+	 * @param      context  The hub's ZMQ context
+	 * @param      params   The chain client parameters (struct)
 	 */
-	HubChainClient::HubChainClient(int ctxn, _chainClientParams *params) : _zmqContext(ctxn), _zmqSubscriberSocket(_zmqContext, ZMQ_SUB), _zmqSenderSocket(_zmqContext, ZMQ_REQ) {
+	HubChainClient::HubChainClient(zmq::context_t *context, _chainClientParams *params) : _zmqSubscriberSocket(*context, ZMQ_SUB), _zmqSenderSocket(*context, ZMQ_PUSH) {
 		_params = params;
-		_runLoop = true;
+		_peerId = 0;
+		_subscriptionVersion = 0;
+		_zstdContext = (params->batched && params->batch.codec == TDRS_CHAIN_BATCH_CODEC_ZSTD ? ZSTD_createDCtx() : NULL);
+		_lastSeenAt = 0;
+		_reconnectAt = 0;
+		_reconnectDelay = params->heartbeatInterval;
+		_connected = false;
+		_pending = false;
+		_pendingEnveloped = false;
+		_retryDelay = TDRS_CHAIN_SEND_BACKOFF;
+		_batchPosition = 0;
+		_batchRemaining = false;
 	}
 
 	/**
-	 * @brief      Runs the chain client.
+	 * @brief      Destroys the object.
+	 */
+	HubChainClient::~HubChainClient() {
+		if(_zstdContext != NULL) {
+			ZSTD_freeDCtx(_zstdContext);
+		}
+	}
+
+	/**
+	 * @brief      Subscribes to the prefixes the subscribers of the hub are
+	 * interested in, except for the ones of the hub behind the link, and
+	 * unsubscribes from the others. Every prefix is accompanied by a marker
+	 * subscription, naming the hub subscribed for.
 	 *
-	 * @return     NULL
+	 * @param      socket  The subscriber socket
 	 */
-	void HubChainClient::run() {
-		std::vector<_sharedMessageEntry> &sharedMessageVector = *_params->shmsgvec;
+	void HubChainClient::_updateSubscriptions(zmq::socket_t &socket) {
+		std::set<std::string> prefixes;
+
+		pthread_mutex_lock(_params->subscriptionTableMutex);
+		_subscriptionVersion = _params->subscriptionTable->version();
+		_params->subscriptionTable->interest(_peerId, &prefixes);
+		pthread_mutex_unlock(_params->subscriptionTableMutex);
+
+		BOOST_FOREACH(const std::string &prefix, _subscribedPrefixes) {
+			if(prefixes.count(prefix) == 0) {
+				std::string via = HubSubscriptionTable::viaTopic(_params->hubId, prefix);
+				socket.setsockopt(ZMQ_UNSUBSCRIBE, prefix.data(), prefix.size());
+				socket.setsockopt(ZMQ_UNSUBSCRIBE, via.data(), via.size());
+				TDRS_LOG_DEBUG("Chain[" << _params->link << "]: Unsubscribed from prefix " << prefix);
+			}
+		}
+
+		BOOST_FOREACH(const std::string &prefix, prefixes) {
+			if(_subscribedPrefixes.count(prefix) == 0) {
+				std::string via = HubSubscriptionTable::viaTopic(_params->hubId, prefix);
+				socket.setsockopt(ZMQ_SUBSCRIBE, via.data(), via.size());
+				socket.setsockopt(ZMQ_SUBSCRIBE, prefix.data(), prefix.size());
+				TDRS_LOG_DEBUG("Chain[" << _params->link << "]: Subscribed to prefix " << prefix);
+			}
+		}
+
+		_subscribedPrefixes.swap(prefixes);
+	}
 
-		std::cout << "Chain[" << _params->link << "]: Starting ..." << std::endl;
-		zmq::context_t zmqContext(1);
+	/**
+	 * @brief      Connects to the hub and subscribes to the link publisher.
+	 */
+	void HubChainClient::open() {
+		TDRS_LOG_INFO("Chain[" << _params->link << "]: Starting ...");
 
-		std::cout << "Chain[" << _params->link << "]: Connecting to receiver at " << _params->receiver << " ..." << std::endl;
+		TDRS_LOG_INFO("Chain[" << _params->link << "]: Connecting to hub at " << TDRS_CHAIN_ENDPOINT << " ...");
 		int _zmqSenderSocketLinger = 0;
-		zmq::socket_t _zmqSenderSocket(zmqContext, ZMQ_REQ);
 		_zmqSenderSocket.setsockopt(ZMQ_LINGER, &_zmqSenderSocketLinger, sizeof(_zmqSenderSocketLinger));
-		_zmqSenderSocket.connect(_params->receiver);
-		_params->senderSocket = &_zmqSenderSocket;
-
-		std::cout << "Chain[" << _params->link << "]: Connected to receiver." << std::endl;
+		_zmqSenderSocket.setsockopt(ZMQ_SNDHWM, &_params->hwm, sizeof(_params->hwm));
+		_zmqSenderSocket.connect(TDRS_CHAIN_ENDPOINT);
+		TDRS_LOG_INFO("Chain[" << _params->link << "]: Connected to hub.");
 
 		int _zmqSubscriberSocketLinger = 0;
-		std::cout << "Chain[" << _params->link << "]: Subscribing to link publisher at " << _params->link << " ..." << std::endl;
-		zmq::socket_t _zmqSubscriberSocket(zmqContext, ZMQ_SUB);
+		TDRS_LOG_INFO("Chain[" << _params->link << "]: Subscribing to link publisher at " << _params->link << " ...");
 		_zmqSubscriberSocket.setsockopt(ZMQ_LINGER, &_zmqSubscriberSocketLinger, sizeof(_zmqSubscriberSocketLinger));
 		_zmqSubscriberSocket.setsockopt(ZMQ_IDENTITY, "hub", 3);
-		_zmqSubscriberSocket.setsockopt(ZMQ_SUBSCRIBE, "", 0);
-		_zmqSubscriberSocket.connect(_params->link);
-		_params->subscriberSocket = &_zmqSubscriberSocket;
-		std::cout << "Chain[" << _params->link << "]: Subscribed to link publisher." << std::endl;
+		_zmqSubscriberSocket.setsockopt(ZMQ_RCVHWM, &_params->hwm, sizeof(_params->hwm));
+		if(_params->batched) {
+			// Batched links take all events, in the batches of the spec asked for
+			std::string topic = HubChainBatcher::topic(_params->batch);
+			_zmqSubscriberSocket.setsockopt(ZMQ_SUBSCRIBE, topic.data(), topic.size());
+		} else if(_params->subscriptionTable != NULL) {
+			// Prefixes follow the subscription table, once the link's hub said hello
+			std::string hello = TDRS_CHAIN_HELLO_TOPIC;
+			_zmqSubscriberSocket.setsockopt(ZMQ_SUBSCRIBE, hello.data(), hello.size());
+		} else {
+			_zmqSubscriberSocket.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+		}
+		if(_params->heartbeatInterval > 0 && (_params->batched || _params->subscriptionTable != NULL)) {
+			std::string heartbeat = TDRS_CHAIN_HEARTBEAT_TOPIC;
+			_zmqSubscriberSocket.setsockopt(ZMQ_SUBSCRIBE, heartbeat.data(), heartbeat.size());
+		}
+		_zmqSubscriberSocket.connect(_params->endpoint);
+		_connected = true;
+		_lastSeenAt = Hub::monotonicTime();
+		TDRS_LOG_INFO("Chain[" << _params->link << "]: Subscribed to link publisher.");
+	}
 
-		while(_params->run == true) {
-			std::cout << "Chain[" << _params->link << "]: Loop started ..." << std::endl;
-			zmq::message_t zmqSubscriberMessageIncoming;
+	/**
+	 * @brief      Returns the poll item of the link publisher subscription.
+	 *
+	 * @return     The poll item.
+	 */
+	zmq::pollitem_t HubChainClient::pollItem() {
+		zmq::pollitem_t pollItem = { (void *)_zmqSubscriberSocket, 0, pollEvents(), 0 };
+		return pollItem;
+	}
 
+	/**
+	 * @brief      Returns the events the subscription is polled for: none
+	 * while the hub has not taken the events already received, so nothing
+	 * more is read from a link whose hub is backed up.
+	 *
+	 * @return     The poll events.
+	 */
+	short HubChainClient::pollEvents() {
+		return (_pending || _batchRemaining ? 0 : ZMQ_POLLIN);
+	}
+
+	/**
+	 * @brief      Returns the time (ms) the subscription may be polled for,
+	 * before the client needs to be maintained again. With heartbeats, that
+	 * is half the heartbeat interval, so a silent link is noticed in time;
+	 * with an event pending, it is the delay before the hub is retried.
+	 *
+	 * @return     The poll timeout.
+	 */
+	long HubChainClient::pollTimeout() {
+		long timeout = TDRS_CHAIN_POLL_INTERVAL;
+
+		if(_params->heartbeatInterval > 0) {
+			timeout = std::max(1L, std::min(timeout, (long)_params->heartbeatInterval / 2));
+		}
+
+		if(_pending) {
+			timeout = std::min(timeout, _retryDelay);
+		}
+
+		return timeout;
+	}
+
+	/**
+	 * @brief      Sets the link state. A link that goes down is removed from
+	 * the hub's chain links and its dedup index entries are dropped, so the
+	 * hub stops registering events for a peer that is gone; a link coming
+	 * back is added again, unless the client is shutting down.
+	 *
+	 * @param[in]  state  The link state
+	 */
+	void HubChainClient::_setState(int state) {
+		int previous = _params->state;
+		if(state == previous) {
+			return;
+		}
+
+		if(state == TDRS_CHAIN_LINK_DOWN || previous == TDRS_CHAIN_LINK_DOWN) {
+			pthread_mutex_lock(_params->dedupIndexMutex);
+			std::vector<uint32_t>::iterator chainLinkId = std::find(_params->chainLinkIds->begin(), _params->chainLinkIds->end(), _params->linkId);
+			if(state == TDRS_CHAIN_LINK_DOWN) {
+				if(chainLinkId != _params->chainLinkIds->end()) {
+					_params->chainLinkIds->erase(chainLinkId);
+				}
+				_params->dedupIndex->removeLink(_params->linkId);
+			} else if(chainLinkId == _params->chainLinkIds->end() && _params->run == true) {
+				_params->chainLinkIds->push_back(_params->linkId);
+			}
+			pthread_mutex_unlock(_params->dedupIndexMutex);
+		}
+
+		_params->state = state;
+
+		if(state == TDRS_CHAIN_LINK_UP) {
+			TDRS_LOG_INFO("Chain[" << _params->link << "]: Link is up.");
+		} else if(state == TDRS_CHAIN_LINK_SUSPECT) {
+			TDRS_LOG_WARNING("Chain[" << _params->link << "]: Link is suspect.");
+		} else {
+			TDRS_LOG_WARNING("Chain[" << _params->link << "]: Link is down.");
+		}
+	}
+
+	/**
+	 * @brief      Checks the heartbeats of the link publisher. A link silent
+	 * for two heartbeat intervals is suspect; one silent for the heartbeat
+	 * timeout is down and disconnected. A link that is down is reconnected
+	 * after a delay, which starts at the heartbeat interval and doubles with
+	 * every reconnect that does not bring the link up again, up to the
+	 * maximum reconnect delay. A reconnected link is suspect, until the link
+	 * publisher is heard from.
+	 *
+	 * Messages waiting on the subscription, and events the hub has not
+	 * taken yet, count as heard from: the link publisher is alive, only this
+	 * client has not caught up because the hub is backed up. Silence is
+	 * measured from the last message only once all of them are handed over.
+	 */
+	void HubChainClient::_checkHeartbeat() {
+		if(_params->heartbeatInterval <= 0) {
+			return;
+		}
+
+		uint64_t now = Hub::monotonicTime();
+
+		if(!_connected) {
+			if(now < _reconnectAt) {
+				return;
+			}
+
+			TDRS_LOG_INFO("Chain[" << _params->link << "]: Reconnecting to link publisher ...");
 			try {
-				_zmqSubscriberSocket.recv(&zmqSubscriberMessageIncoming);
+				_zmqSubscriberSocket.connect(_params->endpoint);
 			} catch(...) {
-				std::cout << "Chain[" << _params->link << "]: Message receiver failed. Looping." << std::endl;
-				continue;
+				TDRS_LOG_WARNING("Chain[" << _params->link << "]: Reconnecting failed!");
 			}
+			_connected = true;
+			_lastSeenAt = now;
+			_params->reconnects++;
+			_setState(TDRS_CHAIN_LINK_SUSPECT);
+			return;
+		}
 
-			std::string zmqSubscriberMessageIncomingString(
-				static_cast<const char*>(zmqSubscriberMessageIncoming.data()),
-				zmqSubscriberMessageIncoming.size()
-			);
-
-			std::cout << "Chain[" << _params->link << "]: Received message: " << zmqSubscriberMessageIncomingString << std::endl;
-
-			std::string hashedMessage = Hub::hashString(&zmqSubscriberMessageIncomingString);
-			std::cout << "Chain[" << _params->link << "]: Hashed message: " << hashedMessage << std::endl;
-
-			std::cout << "Chain[" << _params->link << "]: Checking hashed message in shared message vector ..." << std::endl;
-			bool processMessage = true;
-			pthread_mutex_lock(_params->shmsgvecmtx);
-			if(std::find_if(
-					sharedMessageVector.begin(),
-					sharedMessageVector.end(),
-					(boost::bind(&_sharedMessageEntry::hash, _1) == hashedMessage
-						&& boost::bind(&_sharedMessageEntry::link, _1) == _params->link)
-				) != sharedMessageVector.end()) {
-				sharedMessageVector.erase(
-					std::remove_if(
-						sharedMessageVector.begin(),
-						sharedMessageVector.end(),
-						(boost::bind(&_sharedMessageEntry::hash, _1) == hashedMessage
-							&& boost::bind(&_sharedMessageEntry::link, _1) == _params->link)
-					), sharedMessageVector.end());
-				processMessage = false;
+		int events = 0;
+		size_t eventsSize = sizeof(events);
+		try {
+			_zmqSubscriberSocket.getsockopt(ZMQ_EVENTS, &events, &eventsSize);
+		} catch(...) {
+			events = 0;
+		}
+		if((events & ZMQ_POLLIN) || _pending || _batchRemaining) {
+			_lastSeenAt = now;
+		}
+
+		uint64_t silent = (now - _lastSeenAt) / 1000000;
+
+		if(silent >= (uint64_t)_params->heartbeatTimeout) {
+			_setState(TDRS_CHAIN_LINK_DOWN);
+
+			try {
+				_zmqSubscriberSocket.disconnect(_params->endpoint);
+			} catch(...) {
+				// Not connected anymore
 			}
-			pthread_mutex_unlock(_params->shmsgvecmtx);
-			std::cout << "Chain[" << _params->link << "]: Checked hashed message in shared message vector." << std::endl;
+			_connected = false;
+			_reconnectAt = now + (uint64_t)_reconnectDelay * 1000000;
+			TDRS_LOG_WARNING("Chain[" << _params->link << "]: Link publisher silent for " << silent << " ms, reconnecting in " << _reconnectDelay << " ms.");
+			_reconnectDelay = std::min(_reconnectDelay * 2, _params->reconnectMax);
+		} else if(silent >= (uint64_t)_params->heartbeatInterval * TDRS_CHAIN_HEARTBEAT_SUSPECT_INTERVALS && _params->state == TDRS_CHAIN_LINK_UP) {
+			_setState(TDRS_CHAIN_LINK_SUSPECT);
+		}
+	}
 
-			if(processMessage) {
-				std::cout << "Chain[" << _params->link << "]: Forwarding message to receiver ..." << std::endl;
-				try {
-					_zmqSenderSocket.send(zmqSubscriberMessageIncoming);
-				} catch(...) {
-					std::cout << "Chain[" << _params->link << "]: Forwarding failed!" << std::endl;
-					continue;
+	/**
+	 * @brief      Hands the pending event to the hub, followed by the rest of
+	 * the batch it came in, if any. A hub that stays backed up is retried
+	 * less and less often, up to the poll interval.
+	 */
+	void HubChainClient::_retry() {
+		if(_pending) {
+			bool sent = false;
+			try {
+				// The envelope is always accepted along with the event
+				sent = _zmqSenderSocket.send(_pendingEvent, (_pendingEnveloped ? ZMQ_SNDMORE : 0) | ZMQ_DONTWAIT);
+				if(sent && _pendingEnveloped) {
+					_zmqSenderSocket.send(_pendingEnvelope);
 				}
+			} catch(...) {
+				// Dropped, retrying would not help
+				TDRS_LOG_WARNING("Chain[" << _params->link << "]: Forwarding failed!");
+				_pending = false;
+				return;
+			}
 
-				zmq::message_t zmqSenderMessageIncoming;
-				try {
-					_zmqSenderSocket.recv(&zmqSenderMessageIncoming);
-				} catch(...) {
-					continue;
-				}
+			if(!sent) {
+				_retryDelay = std::min(2 * _retryDelay, (long)TDRS_CHAIN_POLL_INTERVAL);
+				return;
+			}
 
-				std::string zmqSenderMessageIncomingString(
-					static_cast<const char*>(zmqSenderMessageIncoming.data()),
-					zmqSenderMessageIncoming.size()
-				);
+			_pending = false;
+			_retryDelay = TDRS_CHAIN_SEND_BACKOFF;
+			_params->forwarded++;
+			TDRS_LOG_DEBUG("Chain[" << _params->link << "]: Forwarding successful.");
+		}
 
-				if(zmqSenderMessageIncomingString.substr(0, 3) == "OOK") {
-					std::cout << "Chain[" << _params->link << "]: Forwarding successful." << std::endl;
-				} else {
-					std::cout << "Chain[" << _params->link << "]: Forwarding failed!" << std::endl;
+		if(_batchRemaining) {
+			_forwardBatch();
+		}
+	}
+
+	/**
+	 * @brief      Hands the pending event to the hub, if any, follows the
+	 * subscription table, if it changed since the subscriptions were last
+	 * updated, and checks the heartbeats of the link publisher, if enabled.
+	 */
+	void HubChainClient::maintain() {
+		_retry();
+
+		if(_params->subscriptionTable != NULL && !_params->batched && _peerId != 0 && _params->subscriptionTable->version() != _subscriptionVersion) {
+			_updateSubscriptions(_zmqSubscriberSocket);
+		}
+
+		_checkHeartbeat();
+	}
+
+	/**
+	 * @brief      Receives one message from the link publisher and hands it to
+	 * the hub, unless it was processed before. Must only be called once the
+	 * subscription is readable and polled for. Any message, heartbeat or
+	 * not, shows the link publisher is alive.
+	 */
+	void HubChainClient::serve() {
+		zmq::message_t zmqSubscriberMessageIncoming;
+
+		try {
+			_zmqSubscriberSocket.recv(&zmqSubscriberMessageIncoming);
+		} catch(...) {
+			TDRS_LOG_WARNING("Chain[" << _params->link << "]: Message receiver failed.");
+			return;
+		}
+
+		if(_params->heartbeatInterval > 0) {
+			_lastSeenAt = Hub::monotonicTime();
+			if(_params->state != TDRS_CHAIN_LINK_UP) {
+				_setState(TDRS_CHAIN_LINK_UP);
+				_reconnectDelay = _params->heartbeatInterval;
+			}
+
+			size_t heartbeatSize = strlen(TDRS_CHAIN_HEARTBEAT_TOPIC);
+			if(!zmqSubscriberMessageIncoming.more() && zmqSubscriberMessageIncoming.size() == heartbeatSize && memcmp(zmqSubscriberMessageIncoming.data(), TDRS_CHAIN_HEARTBEAT_TOPIC, heartbeatSize) == 0) {
+				return;
+			}
+		}
+
+		if(_params->batched) {
+			if(zmqSubscriberMessageIncoming.more()) {
+				_serveBatch();
+			}
+			return;
+		}
+
+		uint64_t peerId;
+		if(!zmqSubscriberMessageIncoming.more() && HubSubscriptionTable::parseHello(zmqSubscriberMessageIncoming.data(), zmqSubscriberMessageIncoming.size(), &peerId)) {
+			if(_params->subscriptionTable != NULL && peerId != _peerId) {
+				TDRS_LOG_INFO("Chain[" << _params->link << "]: Linked to hub " << peerId << ".");
+				_peerId = peerId;
+				_updateSubscriptions(_zmqSubscriberSocket);
+			}
+			return;
+		}
+
+		TDRS_LOG_DEBUG("Chain[" << _params->link << "]: Received message: " << logBytes(zmqSubscriberMessageIncoming.data(), zmqSubscriberMessageIncoming.size()));
+
+		// The chain envelope, if any, follows the event
+		zmq::message_t zmqEnvelopeMessageIncoming;
+		chainEnvelope envelope;
+		bool enveloped = false;
+		try {
+			bool more = zmqSubscriberMessageIncoming.more();
+			while(more) {
+				zmq::message_t zmqSubscriberFrameIncoming;
+				_zmqSubscriberSocket.recv(&zmqSubscriberFrameIncoming);
+				more = zmqSubscriberFrameIncoming.more();
+
+				if(!enveloped && Hub::parseEnvelope(zmqSubscriberFrameIncoming, &envelope)) {
+					zmqEnvelopeMessageIncoming.move(&zmqSubscriberFrameIncoming);
+					enveloped = true;
 				}
+			}
+		} catch(...) {
+			TDRS_LOG_WARNING("Chain[" << _params->link << "]: Message receiver failed.");
+			return;
+		}
+
+		_forward(zmqSubscriberMessageIncoming, enveloped, envelope, zmqEnvelopeMessageIncoming);
+	}
+
+	/**
+	 * @brief      Hands one event to the hub, unless it was processed before:
+	 * enveloped events are checked against the sequence window, others
+	 * against the dedup index. An event the backed up hub does not take
+	 * right away is kept pending, to be retried when the client is
+	 * maintained; the client never blocks on the hub, so a chain reactor
+	 * keeps serving its other links.
+	 *
+	 * @param      event            The event
+	 * @param[in]  enveloped        Whether the event came with an envelope
+	 * @param[in]  envelope         The parsed envelope
+	 * @param      envelopeMessage  The envelope frame
+	 */
+	void HubChainClient::_forward(zmq::message_t &event, bool enveloped, const chainEnvelope &envelope, zmq::message_t &envelopeMessage) {
+		bool processMessage = true;
+		if(enveloped) {
+			TDRS_LOG_DEBUG("Chain[" << _params->link << "]: Checking origin " << envelope.origin << " sequence " << envelope.sequence << " in sequence window ...");
+			if(envelope.origin == _params->hubId) {
+				processMessage = false;
+			} else if(envelope.previousRelay == _params->hubId) {
+				// Split horizon: the link received the event from this hub
+				processMessage = false;
+			} else if(envelope.hops >= _params->maxHops) {
+				TDRS_LOG_DEBUG("Chain[" << _params->link << "]: Dropping message after " << (int)envelope.hops << " hops.");
+				processMessage = false;
 			} else {
-				std::cout << "Chain[" << _params->link << "]: Not forwarding message to receiver as it was processed before." << std::endl;
+				pthread_mutex_lock(_params->dedupIndexMutex);
+				processMessage = _params->sequenceWindow->accept(envelope.origin, envelope.sequence);
+				pthread_mutex_unlock(_params->dedupIndexMutex);
+			}
+		} else {
+			std::string fingerprint = Hub::fingerprintData(event.data(), event.size(), _params->fingerprint);
+			TDRS_LOG_DEBUG("Chain[" << _params->link << "]: Fingerprinted message: " << logHex(fingerprint));
+
+			TDRS_LOG_DEBUG("Chain[" << _params->link << "]: Checking fingerprint in dedup index ...");
+			pthread_mutex_lock(_params->dedupIndexMutex);
+			processMessage = !_params->dedupIndex->consume(fingerprint, _params->linkId);
+			pthread_mutex_unlock(_params->dedupIndexMutex);
+			TDRS_LOG_DEBUG("Chain[" << _params->link << "]: Checked fingerprint in dedup index.");
+		}
+
+		if(processMessage) {
+			TDRS_LOG_DEBUG("Chain[" << _params->link << "]: Forwarding message to hub ...");
+			_pendingEvent.move(&event);
+			_pendingEnveloped = enveloped;
+			if(enveloped) {
+				_pendingEnvelope.move(&envelopeMessage);
 			}
+			_pending = true;
+			_retry();
+		} else {
+			_params->discarded++;
+			TDRS_LOG_DEBUG("Chain[" << _params->link << "]: Not forwarding message to hub as it was processed before.");
 		}
+	}
+
+	/**
+	 * @brief      Receives the batch following a batch topic and hands its
+	 * events to the hub, one by one, the way they would have arrived over a
+	 * link that is not batched.
+	 */
+	void HubChainClient::_serveBatch() {
+		zmq::message_t zmqBatchMessageIncoming;
+
+		try {
+			_zmqSubscriberSocket.recv(&zmqBatchMessageIncoming);
+			// Frames a later version may add are ignored
+			bool more = zmqBatchMessageIncoming.more();
+			while(more) {
+				zmq::message_t zmqSubscriberFrameIncoming;
+				_zmqSubscriberSocket.recv(&zmqSubscriberFrameIncoming);
+				more = zmqSubscriberFrameIncoming.more();
+			}
+		} catch(...) {
+			TDRS_LOG_WARNING("Chain[" << _params->link << "]: Message receiver failed.");
+			return;
+		}
+
+		uint32_t count;
+		if(!HubChainBatcher::decode(zmqBatchMessageIncoming, _zstdContext, &_batchEvents, &count)) {
+			TDRS_LOG_WARNING("Chain[" << _params->link << "]: Dropping undecodable batch.");
+			return;
+		}
+
+		TDRS_LOG_DEBUG("Chain[" << _params->link << "]: Received batch of " << count << " events, " << zmqBatchMessageIncoming.size() << " of " << _batchEvents.size() << " bytes.");
+
+		_batchPosition = 0;
+		_batchRemaining = true;
+		_forwardBatch();
+	}
+
+	/**
+	 * @brief      Hands the events of the batch being served to the hub, one
+	 * by one, until one of them is left pending or the batch is done.
+	 */
+	void HubChainClient::_forwardBatch() {
+		const char *payload;
+		const char *envelopeData;
+		size_t payloadSize;
+		size_t envelopeSize;
+		while(!_pending) {
+			if(!HubChainBatcher::nextEvent(_batchEvents, &_batchPosition, &payload, &payloadSize, &envelopeData, &envelopeSize)) {
+				_batchRemaining = false;
+				return;
+			}
+
+			zmq::message_t event(payload, payloadSize);
+			zmq::message_t envelopeMessage;
+			chainEnvelope envelope;
+			bool enveloped = false;
+
+			if(envelopeSize > 0) {
+				envelopeMessage.rebuild(envelopeSize);
+				memcpy(envelopeMessage.data(), envelopeData, envelopeSize);
+				enveloped = Hub::parseEnvelope(envelopeMessage, &envelope);
+			}
+
+			_forward(event, enveloped, envelope, envelopeMessage);
+		}
+	}
 
-		std::cout << std::endl << "Chain[" << _params->link << "]: Unsubscribing from link publisher at " << _params->link << " ..." << std::endl;
+	/**
+	 * @brief      Unsubscribes from the link publisher and disconnects from the
+	 * hub.
+	 */
+	void HubChainClient::close() {
+		TDRS_LOG_INFO("Chain[" << _params->link << "]: Unsubscribing from link publisher at " << _params->link << " ...");
 		_zmqSubscriberSocket.close();
-		std::cout << std::endl << "Chain[" << _params->link << "]: Unsubscribed from link publisher." << std::endl;
+		TDRS_LOG_INFO("Chain[" << _params->link << "]: Unsubscribed from link publisher.");
 
-		std::cout << std::endl << "Chain[" << _params->link << "]: Disconnecting from from receiver at " << _params->receiver << " ..." << std::endl;
+		TDRS_LOG_INFO("Chain[" << _params->link << "]: Disconnecting from hub at " << TDRS_CHAIN_ENDPOINT << " ...");
 		_zmqSenderSocket.close();
-		std::cout << std::endl << "Chain[" << _params->link << "]: Disconnected from from receiver ..." << std::endl;
+		TDRS_LOG_INFO("Chain[" << _params->link << "]: Disconnected from hub.");
+	}
+
+	/**
+	 * @brief      Runs the chain client on its own thread, until it is
+	 * requested to stop.
+	 */
+	void HubChainClient::run() {
+		open();
+
+		zmq::pollitem_t pollItems[] = {
+			pollItem()
+		};
+
+		while(_params->run == true) {
+			TDRS_LOG_DEBUG("Chain[" << _params->link << "]: Loop started ...");
+			maintain();
+			pollItems[0].events = pollEvents();
+
+			try {
+				if(zmq::poll(pollItems, 1, pollTimeout()) == 0) {
+					continue;
+				}
+			} catch(...) {
+				TDRS_LOG_WARNING("Chain[" << _params->link << "]: Message receiver failed. Looping.");
+				continue;
+			}
+
+			if(pollItems[0].revents & ZMQ_POLLIN) {
+				serve();
+			}
+		}
 
-		std::cout << std::endl << "Chain[" << _params->link << "]: Goodbye!" << std::endl;
-		std::cout.flush();
-		delete _params;
+		close();
+		TDRS_LOG_INFO("Chain[" << _params->link << "]: Goodbye!");
 	}
 }
@@ -0,0 +1,137 @@
+#include "tdrs.hpp"
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object.
+	 *
+	 * @param      context  The hub's ZMQ context
+	 */
+	HubChainReactor::HubChainReactor(zmq::context_t *context) : _zmqControlSocket(*context, ZMQ_PAIR) {
+		_zmqContext = context;
+	}
+
+	/**
+	 * @brief      Registers or unregisters one chain link.
+	 *
+	 * Registering opens the link's subscription on the reactor thread, as
+	 * ZMQ sockets must not be shared between threads. Unregistering closes
+	 * it and releases the link's parameters.
+	 *
+	 * @param[in]  command  The command
+	 */
+	void HubChainReactor::_execute(const _chainReactorCommand &command) {
+		if(command.add) {
+			HubChainClient *client = new HubChainClient(_zmqContext, command.params);
+			client->open();
+			_clients[command.params] = client;
+			TDRS_LOG_INFO("Chain reactor: Registered link " << command.params->link << ", serving " << _clients.size() << " links.");
+			return;
+		}
+
+		std::map<_chainClientParams*, HubChainClient*>::iterator registered = _clients.find(command.params);
+		if(registered != _clients.end()) {
+			registered->second->close();
+			delete registered->second;
+			_clients.erase(registered);
+		}
+
+		TDRS_LOG_INFO("Chain reactor: Unregistered link " << command.params->link << ", serving " << _clients.size() << " links.");
+		delete command.params;
+	}
+
+	/**
+	 * @brief      Runs the chain reactor, polling the subscriptions of all
+	 * registered links, until the hub requests it to exit.
+	 */
+	void HubChainReactor::run() {
+		TDRS_LOG_INFO("Chain reactor: Starting ...");
+
+		int _zmqControlSocketLinger = 0;
+		_zmqControlSocket.setsockopt(ZMQ_LINGER, &_zmqControlSocketLinger, sizeof(_zmqControlSocketLinger));
+		_zmqControlSocket.connect(TDRS_CHAIN_REACTOR_ENDPOINT);
+
+		std::vector<zmq::pollitem_t> pollItems;
+		std::vector<HubChainClient*> polledClients;
+		bool clientsChanged = true;
+		bool runLoop = true;
+
+		while(runLoop == true) {
+			if(clientsChanged) {
+				pollItems.clear();
+				polledClients.clear();
+
+				zmq::pollitem_t controlPollItem = { (void *)_zmqControlSocket, 0, ZMQ_POLLIN, 0 };
+				pollItems.push_back(controlPollItem);
+
+				std::map<_chainClientParams*, HubChainClient*>::iterator registered;
+				for(registered = _clients.begin(); registered != _clients.end(); registered++) {
+					pollItems.push_back(registered->second->pollItem());
+					polledClients.push_back(registered->second);
+				}
+
+				clientsChanged = false;
+			}
+
+			// Clients with an event the hub did not take yet retry it, and are not read from meanwhile
+			long timeout = TDRS_CHAIN_POLL_INTERVAL;
+			for(size_t index = 1; index < pollItems.size(); index++) {
+				HubChainClient *client = polledClients[index - 1];
+				client->maintain();
+				pollItems[index].events = client->pollEvents();
+				timeout = std::min(timeout, client->pollTimeout());
+			}
+
+			try {
+				if(zmq::poll(pollItems.data(), pollItems.size(), timeout) == 0) {
+					continue;
+				}
+			} catch(...) {
+				TDRS_LOG_WARNING("Chain reactor: Polling failed. Looping.");
+				continue;
+			}
+
+			for(size_t index = 1; index < pollItems.size(); index++) {
+				if(pollItems[index].revents & ZMQ_POLLIN) {
+					polledClients[index - 1]->serve();
+				}
+			}
+
+			// Commands come last, so no client is closed while its poll item is pending
+			if(pollItems[0].revents & ZMQ_POLLIN) {
+				while(true) {
+					_chainReactorCommand command;
+
+					try {
+						if(_zmqControlSocket.recv(&command, sizeof(command), ZMQ_DONTWAIT) == 0) {
+							break;
+						}
+					} catch(...) {
+						break;
+					}
+
+					if(command.params == NULL) {
+						runLoop = false;
+						break;
+					}
+
+					_execute(command);
+					clientsChanged = true;
+				}
+			}
+		}
+
+		std::map<_chainClientParams*, HubChainClient*>::iterator remaining;
+		for(remaining = _clients.begin(); remaining != _clients.end(); remaining++) {
+			remaining->second->close();
+			delete remaining->second;
+			delete remaining->first;
+		}
+		_clients.clear();
+
+		_zmqControlSocket.close();
+		TDRS_LOG_INFO("Chain reactor: Goodbye!");
+	}
+}
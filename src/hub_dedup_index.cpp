@@ -0,0 +1,223 @@
+#include "tdrs.hpp"
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object.
+	 */
+	HubDedupIndex::HubDedupIndex() {
+		_maxEntries = TDRS_DEDUP_DEFAULT_MAX_ENTRIES;
+		_maxBytes = TDRS_DEDUP_DEFAULT_MAX_BYTES;
+		_ttl = TDRS_DEDUP_DEFAULT_TTL;
+		_nextLinkId = 0;
+		_bytes = 0;
+		_inserted = 0;
+		_matched = 0;
+		_expired = 0;
+		_evicted = 0;
+	}
+
+	/**
+	 * @brief      Sets the bounds of the index.
+	 *
+	 * @param[in]  maxEntries  The maximum number of entries
+	 * @param[in]  maxBytes    The maximum (estimated) memory used by entries
+	 * @param[in]  ttl         The time (ms) after which unmatched entries expire
+	 */
+	void HubDedupIndex::configure(size_t maxEntries, size_t maxBytes, uint64_t ttl) {
+		_maxEntries = maxEntries;
+		_maxBytes = maxBytes;
+		_ttl = ttl;
+	}
+
+	/**
+	 * @brief      Static method returning the current monotonic time.
+	 *
+	 * @return     The time (ms).
+	 */
+	uint64_t HubDedupIndex::_now() {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	 * @brief      Static method estimating the memory used by one entry: the
+	 * list node, holding the fingerprint, and the index node with its bucket.
+	 *
+	 * @return     The size (bytes).
+	 */
+	size_t HubDedupIndex::_entryBytes() {
+		size_t bytes = sizeof(_dedupNode) + 2 * sizeof(void *);
+		bytes += sizeof(const _dedupKey *) + sizeof(std::list<_dedupNode>::iterator) + 3 * sizeof(void *);
+		return bytes;
+	}
+
+	/**
+	 * @brief      Static method building the key of an entry. SHA1 hex
+	 * fingerprints are stored as their binary digest, binary ones as they
+	 * are, padded with zeros.
+	 *
+	 * @param[in]  fingerprint  The event's fingerprint
+	 * @param[in]  link         The link identifier
+	 * @param      key          The key
+	 */
+	void HubDedupIndex::_buildKey(const std::string &fingerprint, uint32_t link, _dedupKey *key) {
+		memset(key->fingerprint, 0, TDRS_DEDUP_KEY_SIZE);
+		key->link = link;
+
+		if(fingerprint.size() == 2 * TDRS_DEDUP_KEY_SIZE) {
+			for(size_t index = 0; index < TDRS_DEDUP_KEY_SIZE; index++) {
+				unsigned char digit[2];
+				for(size_t nibble = 0; nibble < 2; nibble++) {
+					char hex = fingerprint[2 * index + nibble];
+					digit[nibble] = (hex >= 'A' ? (hex & 0x0f) + 9 : hex - '0');
+				}
+				key->fingerprint[index] = (digit[0] << 4) | digit[1];
+			}
+			return;
+		}
+
+		memcpy(key->fingerprint, fingerprint.data(), std::min(fingerprint.size(), (size_t)TDRS_DEDUP_KEY_SIZE));
+	}
+
+	/**
+	 * @brief      Removes one entry from the index.
+	 *
+	 * @param[in]  node  The entry's node
+	 */
+	void HubDedupIndex::_erase(std::list<_dedupNode>::iterator node) {
+		std::pair<_dedupIndexMap::iterator, _dedupIndexMap::iterator> range = _index.equal_range(&node->key);
+
+		for(_dedupIndexMap::iterator entry = range.first; entry != range.second; entry++) {
+			if(entry->second == node) {
+				_index.erase(entry);
+				break;
+			}
+		}
+
+		_bytes -= HubDedupIndex::_entryBytes();
+		_nodes.erase(node);
+	}
+
+	/**
+	 * @brief      Evicts the oldest entries, as long as they are expired or the
+	 * index exceeds its bounds.
+	 *
+	 * @param[in]  now   The current time (ms)
+	 */
+	void HubDedupIndex::_evict(uint64_t now) {
+		while(!_nodes.empty()) {
+			if(now - _nodes.front().insertedAt >= _ttl) {
+				_expired++;
+			} else if(_nodes.size() > _maxEntries || _bytes > _maxBytes) {
+				_evicted++;
+			} else {
+				break;
+			}
+
+			_erase(_nodes.begin());
+		}
+	}
+
+	/**
+	 * @brief      Returns the identifier of a link, assigning one on first use.
+	 *
+	 * @param[in]  link  The link
+	 *
+	 * @return     The link identifier.
+	 */
+	uint32_t HubDedupIndex::linkId(const std::string &link) {
+		std::unordered_map<std::string, uint32_t>::iterator known = _linkIds.find(link);
+
+		if(known != _linkIds.end()) {
+			return known->second;
+		}
+
+		_linkIds[link] = _nextLinkId;
+		return _nextLinkId++;
+	}
+
+	/**
+	 * @brief      Inserts an entry, expecting the event with the given
+	 * fingerprint to come back once over the given link.
+	 *
+	 * @param[in]  fingerprint  The event's fingerprint
+	 * @param[in]  link         The link identifier
+	 */
+	void HubDedupIndex::insert(const std::string &fingerprint, uint32_t link) {
+		uint64_t now = HubDedupIndex::_now();
+
+		_dedupNode node;
+		HubDedupIndex::_buildKey(fingerprint, link, &node.key);
+		node.insertedAt = now;
+
+		_nodes.push_back(node);
+		std::list<_dedupNode>::iterator inserted = --_nodes.end();
+		_index.insert(std::make_pair(&inserted->key, inserted));
+		_bytes += HubDedupIndex::_entryBytes();
+		_inserted++;
+
+		_evict(now);
+	}
+
+	/**
+	 * @brief      Looks up an entry and removes it, if found.
+	 *
+	 * @param[in]  fingerprint  The event's fingerprint
+	 * @param[in]  link         The link identifier the event came in over
+	 *
+	 * @return     True if the event was expected over the link, i.e. is a
+	 * duplicate, false otherwise.
+	 */
+	bool HubDedupIndex::consume(const std::string &fingerprint, uint32_t link) {
+		_evict(HubDedupIndex::_now());
+
+		_dedupKey key;
+		HubDedupIndex::_buildKey(fingerprint, link, &key);
+
+		_dedupIndexMap::iterator entry = _index.find(&key);
+		if(entry == _index.end()) {
+			return false;
+		}
+
+		_erase(entry->second);
+		_matched++;
+		return true;
+	}
+
+	/**
+	 * @brief      Removes all entries of a link, e.g. once it was shut down.
+	 *
+	 * @param[in]  link  The link identifier
+	 */
+	void HubDedupIndex::removeLink(uint32_t link) {
+		std::list<_dedupNode>::iterator node = _nodes.begin();
+
+		while(node != _nodes.end()) {
+			std::list<_dedupNode>::iterator current = node++;
+
+			if(current->key.link == link) {
+				_erase(current);
+			}
+		}
+	}
+
+	/**
+	 * @brief      Returns the occupancy and counters of the index.
+	 *
+	 * @return     The stats.
+	 */
+	dedupIndexStats HubDedupIndex::stats() const {
+		dedupIndexStats stats;
+
+		stats.entries = _nodes.size();
+		stats.bytes = _bytes;
+		stats.inserted = _inserted;
+		stats.matched = _matched;
+		stats.expired = _expired;
+		stats.evicted = _evicted;
+
+		return stats;
+	}
+}
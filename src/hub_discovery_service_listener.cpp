@@ -20,20 +20,13 @@ namespace tdrs {
 	 * @return     NULL
 	 */
 	void HubDiscoveryServiceListener::run() {
-		std::cout << "DL: Running discovery service listener ..." << std::endl;
+		TDRS_LOG_INFO("DL: Running discovery service listener ...");
 
 		zeroAddress *publisherAddress = Hub::parseZeroAddress(_params->publisher);
 		zeroAddress *receiverAddress = Hub::parseZeroAddress(_params->receiver);
-		zmq::context_t zmqContext(1);
-
-		std::cout << "DL: Connecting to receiver at " << _params->receiver << " ..." << std::endl;
-		int _zmqSenderSocketLinger = 0;
-		zmq::socket_t _zmqSenderSocket(zmqContext, ZMQ_REQ);
-		_zmqSenderSocket.setsockopt(ZMQ_LINGER, &_zmqSenderSocketLinger, sizeof(_zmqSenderSocketLinger));
-		_zmqSenderSocket.connect(_params->receiver);
 
 		zyre::node_t _zyreListenerNode;
-		std::cout << "DL: Adding node for discovery service listener ..." << std::endl;
+		TDRS_LOG_INFO("DL: Adding node for discovery service listener ...");
 		_zyreListenerNode = zyre::node_t(zsys_hostname());
 
 		if(!_params->interface.empty()) {
@@ -42,25 +35,31 @@ namespace tdrs {
 		_zyreListenerNode.set_port(_params->port);
 		_zyreListenerNode.set_interval(_params->interval);
 
-		std::cout << "DL: Setting header to discovery service listener ..." << std::endl;
+		TDRS_LOG_INFO("DL: Setting header to discovery service listener ...");
 		_zyreListenerNode.set_header("X-PUB-PTCL", publisherAddress->protocol);
 		_zyreListenerNode.set_header("X-PUB-ADDR", publisherAddress->address);
 		_zyreListenerNode.set_header("X-PUB-PORT", publisherAddress->port);
 		_zyreListenerNode.set_header("X-REC-PTCL", receiverAddress->protocol);
 		_zyreListenerNode.set_header("X-REC-ADDR", receiverAddress->address);
 		_zyreListenerNode.set_header("X-REC-PORT", receiverAddress->port);
+		zeroAddress *proxyAddress = (_params->proxy.empty() ? NULL : Hub::parseZeroAddress(_params->proxy));
+		if(proxyAddress != NULL) {
+			_zyreListenerNode.set_header("X-PRX-PTCL", proxyAddress->protocol);
+			_zyreListenerNode.set_header("X-PRX-PORT", proxyAddress->port);
+		}
 		_zyreListenerNode.set_header("X-KEY", Hub::hashString(&_params->key));
+		_zyreListenerNode.set_header("X-HUB-KEY", HubOverlay::memberKey(_params->hubId));
 		// _zyreListenerNode.set_verbose();
-		std::cout << "DL: Starting node for discovery service listener ..." << std::endl;
+		TDRS_LOG_INFO("DL: Starting node for discovery service listener ...");
 		_zyreListenerNode.start();
-		std::cout << "DL: Joining group as discovery service listener ..." << std::endl;
+		TDRS_LOG_INFO("DL: Joining group as discovery service listener ...");
 		_zyreListenerNode.join(_params->group);
 
-		std::cout << "DL: Listening for discovery service events ..." << std::endl;
+		TDRS_LOG_INFO("DL: Listening for discovery service events ...");
 		while(_params->run == true) {
 			zyre::event_t zyreEvent = _zyreListenerNode.event();
 
-			std::cout << "DL: Got discovery service event ..." << std::endl;
+			TDRS_LOG_DEBUG("DL: Got discovery service event ...");
 			std::string eventType                    = zyreEvent.type();
 			std::string eventSenderId                = zyreEvent.sender();
 			std::string eventSenderName              = zyreEvent.name();
@@ -72,70 +71,59 @@ namespace tdrs {
 			std::string eventSenderReceiverProtocol  = zyreEvent.header_value("X-REC-PTCL");
 			std::string eventSenderReceiverAddress   = zyreEvent.header_value("X-REC-ADDR");
 			std::string eventSenderReceiverPort      = zyreEvent.header_value("X-REC-PORT");
+			std::string eventSenderProxyProtocol     = zyreEvent.header_value("X-PRX-PTCL");
+			std::string eventSenderProxyPort         = zyreEvent.header_value("X-PRX-PORT");
 			std::string eventSenderKey               = zyreEvent.header_value("X-KEY");
+			std::string eventSenderHubKey            = zyreEvent.header_value("X-HUB-KEY");
 			std::string eventGroup                   = zyreEvent.group();
 
-			zyreEvent.print();
+			if(Logger::level.load(std::memory_order_relaxed) >= TDRS_LOG_LEVEL_DEBUG) {
+				zyreEvent.print();
+			}
 
-			std::string message;
+			peerMessage peer;
+			peer.id = eventSenderId;
 			if(eventType == "ENTER") {
 				if(Hub::hashString(&_params->key) != eventSenderKey) {
-					std::cout << "DL: Ignoring discovery service event, as key does not fit." << std::endl;
+					TDRS_LOG_WARNING("DL: Ignoring discovery service event, as key does not fit.");
 					continue;
 				}
 
-				message = "PEER:ENTER:" + eventSenderId + \
-										":" + eventSenderPublisherProtocol + \
-										":" + eventSenderZyreAddress->address + \
-										":" + eventSenderPublisherPort + \
-										":" + eventSenderReceiverProtocol + \
-										":" + eventSenderZyreAddress->address + \
-										":" + eventSenderReceiverPort;
+				peer.event = TDRS_CONTROL_PEER_ENTER;
+				peer.publisher = eventSenderPublisherProtocol + "://" + eventSenderZyreAddress->address + (eventSenderPublisherPort != "" ? (":" + eventSenderPublisherPort) : "");
+				peer.receiver = eventSenderReceiverProtocol + "://" + eventSenderZyreAddress->address + (eventSenderReceiverPort != "" ? (":" + eventSenderReceiverPort) : "");
+				peer.key = eventSenderHubKey;
+				peer.proxy = (eventSenderProxyProtocol != "" ? eventSenderProxyProtocol + "://" + eventSenderZyreAddress->address + (eventSenderProxyPort != "" ? (":" + eventSenderProxyPort) : "") : "");
 			} else if(eventType == "EXIT") {
-				message = "PEER:EXIT:" + eventSenderId + \
-										":*" \
-										":*" \
-										":*" \
-										":*" \
-										":*" \
-										":*" ;
+				peer.event = TDRS_CONTROL_PEER_EXIT;
 			} else {
-				std::cout << "DL: Ignoring unhandled discovery service event." << std::endl;
+				TDRS_LOG_DEBUG("DL: Ignoring unhandled discovery service event.");
 				continue;
 			}
 
+			zmq::message_t zmqControlMessage;
+			Hub::buildControl(peer, &zmqControlMessage);
 
-			zmq::message_t zmqSenderMessageOutgoing(message.size());
-			memcpy(zmqSenderMessageOutgoing.data(), message.c_str(), message.size());
-
-			_zmqSenderSocket.send(zmqSenderMessageOutgoing);
-
-			zmq::message_t zmqSenderMessageIncoming;
+			// The socket lives only as long as the announcement, so that it never holds up the hub's context
 			try {
-				_zmqSenderSocket.recv(&zmqSenderMessageIncoming);
+				int _zmqControlSocketLinger = TDRS_CONTROL_LINGER;
+				zmq::socket_t _zmqControlSocket(*_params->context, ZMQ_PUSH);
+				_zmqControlSocket.setsockopt(ZMQ_LINGER, &_zmqControlSocketLinger, sizeof(_zmqControlSocketLinger));
+				_zmqControlSocket.connect(TDRS_CONTROL_ENDPOINT);
+				_zmqControlSocket.send(zmqControlMessage);
+				TDRS_LOG_DEBUG("DL: Handed peer announcement to hub.");
 			} catch(...) {
-				continue;
-			}
-
-			std::string zmqSenderMessageIncomingString(
-				static_cast<const char*>(zmqSenderMessageIncoming.data()),
-				zmqSenderMessageIncoming.size()
-			);
-
-			if(zmqSenderMessageIncomingString.substr(0, 3) == "OOK") {
-				std::cout << "DL: Receiver responded with success." << std::endl;
-			} else {
-				std::cout << "DL: Receiver responded with failure!" << std::endl;
+				TDRS_LOG_WARNING("DL: Handing peer announcement to hub failed!");
 			}
 		}
 
-		std::cout << "DL: Leaving group ..." << std::endl;
+		TDRS_LOG_INFO("DL: Leaving group ...");
 		_zyreListenerNode.leave(_params->group);
 
-		std::cout << "DL: Stopping node ..." << std::endl;
+		TDRS_LOG_INFO("DL: Stopping node ...");
 		_zyreListenerNode.stop();
 
 		delete _params;
-		std::cout << "DL: Goodbye!" << std::endl;
+		TDRS_LOG_INFO("DL: Goodbye!");
 	}
 }
@@ -0,0 +1,153 @@
+#include "tdrs.hpp"
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object.
+	 */
+	HubHistogram::HubHistogram() {
+		reset();
+	}
+
+	/**
+	 * @brief      Static method returning the bucket of a value.
+	 *
+	 * Values below 2^TDRS_HISTOGRAM_SUB_BUCKET_BITS have a bucket each; above
+	 * that, every power of two is split into 2^TDRS_HISTOGRAM_SUB_BUCKET_BITS
+	 * linear buckets.
+	 *
+	 * @param[in]  value  The value
+	 *
+	 * @return     The bucket index.
+	 */
+	size_t HubHistogram::_bucket(uint64_t value) {
+		const uint64_t subBuckets = (uint64_t)1 << TDRS_HISTOGRAM_SUB_BUCKET_BITS;
+
+		if(value < subBuckets) {
+			return value;
+		}
+
+		int magnitude = 63 - __builtin_clzll(value);
+		int shift = magnitude - TDRS_HISTOGRAM_SUB_BUCKET_BITS;
+
+		return (shift + 1) * subBuckets + ((value >> shift) & (subBuckets - 1));
+	}
+
+	/**
+	 * @brief      Static method returning the highest value of a bucket.
+	 *
+	 * @param[in]  bucket  The bucket index
+	 *
+	 * @return     The value.
+	 */
+	uint64_t HubHistogram::_highestValue(size_t bucket) {
+		const uint64_t subBuckets = (uint64_t)1 << TDRS_HISTOGRAM_SUB_BUCKET_BITS;
+
+		if(bucket < subBuckets) {
+			return bucket;
+		}
+
+		int shift = (bucket / subBuckets) - 1;
+		uint64_t lowest = (subBuckets + (bucket % subBuckets)) << shift;
+
+		return lowest + (((uint64_t)1 << shift) - 1);
+	}
+
+	/**
+	 * @brief      Records one value.
+	 *
+	 * @param[in]  value  The value
+	 */
+	void HubHistogram::record(uint64_t value) {
+		_counts[HubHistogram::_bucket(value)]++;
+		_count++;
+		_sum += value;
+
+		if(value > _max) {
+			_max = value;
+		}
+	}
+
+	/**
+	 * @brief      Adds the values recorded by another histogram.
+	 *
+	 * @param[in]  other  The other histogram
+	 */
+	void HubHistogram::merge(const HubHistogram &other) {
+		for(size_t bucket = 0; bucket < TDRS_HISTOGRAM_BUCKETS; bucket++) {
+			_counts[bucket] += other._counts[bucket];
+		}
+
+		_count += other._count;
+		_sum += other._sum;
+		_max = std::max(_max, other._max);
+	}
+
+	/**
+	 * @brief      Forgets all recorded values.
+	 */
+	void HubHistogram::reset() {
+		memset(_counts, 0, sizeof(_counts));
+		_count = 0;
+		_sum = 0;
+		_max = 0;
+	}
+
+	/**
+	 * @brief      Returns the number of recorded values.
+	 *
+	 * @return     The count.
+	 */
+	uint64_t HubHistogram::count() const {
+		return _count;
+	}
+
+	/**
+	 * @brief      Returns the sum of all recorded values.
+	 *
+	 * @return     The sum.
+	 */
+	uint64_t HubHistogram::sum() const {
+		return _sum;
+	}
+
+	/**
+	 * @brief      Returns the highest recorded value.
+	 *
+	 * @return     The value.
+	 */
+	uint64_t HubHistogram::max() const {
+		return _max;
+	}
+
+	/**
+	 * @brief      Returns the value below or at which the given share of the
+	 * recorded values lie, accurate to the bucket width (about 6%).
+	 *
+	 * @param[in]  quantile  The quantile, between 0 and 1
+	 *
+	 * @return     The value, 0 if nothing was recorded.
+	 */
+	uint64_t HubHistogram::quantile(double quantile) const {
+		if(_count == 0) {
+			return 0;
+		}
+
+		uint64_t rank = (uint64_t)(quantile * _count + 0.5);
+		if(rank < 1) {
+			rank = 1;
+		}
+
+		uint64_t seen = 0;
+		for(size_t bucket = 0; bucket < TDRS_HISTOGRAM_BUCKETS; bucket++) {
+			seen += _counts[bucket];
+			if(seen >= rank) {
+				return std::min(HubHistogram::_highestValue(bucket), _max);
+			}
+		}
+
+		return _max;
+	}
+}
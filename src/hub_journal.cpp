@@ -0,0 +1,610 @@
+#include "tdrs.hpp"
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object.
+	 */
+	HubJournal::HubJournal() {
+		pthread_mutex_init(&_segmentsMutex, NULL);
+		pthread_mutex_init(&_syncMutex, NULL);
+		pthread_cond_init(&_syncCondition, NULL);
+		_syncThreadStarted = false;
+		_syncStop = false;
+		_segmentSize = TDRS_JOURNAL_DEFAULT_SEGMENT_SIZE;
+		_retentionSize = TDRS_JOURNAL_DEFAULT_RETENTION_SIZE;
+		_retentionAge = TDRS_JOURNAL_DEFAULT_RETENTION_AGE;
+		_fsyncInterval = TDRS_JOURNAL_DEFAULT_FSYNC_INTERVAL;
+		_fd = -1;
+		_map = NULL;
+		_mapSize = 0;
+		_used = 0;
+		_synced = 0;
+		_nextOffset = 0;
+		_committedOffset = 0;
+		_committedBytes = 0;
+		_syncedAt = 0;
+		_retainedAt = 0;
+		_removed = 0;
+	}
+
+	/**
+	 * @brief      Static method returning the current wall-clock time, as
+	 * segment ages have to survive restarts.
+	 *
+	 * @return     The time (ms since epoch).
+	 */
+	uint64_t HubJournal::_now() {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	 * @brief      Returns the path of a segment. The base offset is zero-padded,
+	 * so that segments sort by name.
+	 *
+	 * @param[in]  baseOffset  The segment's first offset
+	 *
+	 * @return     The path.
+	 */
+	std::string HubJournal::_segmentPath(uint64_t baseOffset) const {
+		char name[32];
+		snprintf(name, sizeof(name), "%020llu", (unsigned long long)baseOffset);
+		return _directory + "/" + name + TDRS_JOURNAL_SEGMENT_SUFFIX;
+	}
+
+	/**
+	 * @brief      Sets the directory and bounds of the journal.
+	 *
+	 * @param[in]  directory      The directory
+	 * @param[in]  segmentSize    The size (bytes) of new segments
+	 * @param[in]  retentionSize  The maximum size (bytes) of all segments, 0 for unlimited
+	 * @param[in]  retentionAge   The maximum age (s) of closed segments, 0 for unlimited
+	 * @param[in]  fsyncInterval  The interval (ms) records are synced in, 0 for every maintenance
+	 */
+	void HubJournal::configure(const std::string &directory, size_t segmentSize, uint64_t retentionSize, uint64_t retentionAge, uint64_t fsyncInterval) {
+		_directory = directory;
+		_segmentSize = segmentSize;
+		_retentionSize = retentionSize;
+		_retentionAge = retentionAge;
+		_fsyncInterval = fsyncInterval;
+	}
+
+	/**
+	 * @brief      Opens and maps a segment for appending, creating it if
+	 * required. Segments are extended to their full size up front, as a
+	 * mapping cannot grow.
+	 *
+	 * @param[in]  baseOffset  The segment's first offset
+	 * @param[in]  size        The size to map, at least
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool HubJournal::_openSegment(uint64_t baseOffset, size_t size) {
+		std::string path = _segmentPath(baseOffset);
+
+		int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+		if(fd < 0) {
+			TDRS_LOG_ERROR("Journal: Opening segment " << path << " failed: " << strerror(errno));
+			return false;
+		}
+
+		struct stat fileStat;
+		if(fstat(fd, &fileStat) != 0 || ((size_t)fileStat.st_size < size && ftruncate(fd, size) != 0)) {
+			TDRS_LOG_ERROR("Journal: Extending segment " << path << " failed: " << strerror(errno));
+			::close(fd);
+			return false;
+		}
+
+		size_t mapSize = std::max((size_t)fileStat.st_size, size);
+		void *map = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if(map == MAP_FAILED) {
+			TDRS_LOG_ERROR("Journal: Mapping segment " << path << " failed: " << strerror(errno));
+			::close(fd);
+			return false;
+		}
+
+		_fd = fd;
+		_map = static_cast<unsigned char*>(map);
+		_mapSize = mapSize;
+		_used = 0;
+		_synced = 0;
+
+		pthread_mutex_lock(&_segmentsMutex);
+		if(_segments.empty() || _segments.back().baseOffset != baseOffset) {
+			_journalSegment segment;
+			segment.baseOffset = baseOffset;
+			segment.path = path;
+			_segments.push_back(segment);
+		}
+		// Its records are only committed once found again, see _recoverSegment()
+		_segments.back().size = 0;
+		_segments.back().closedAt = 0;
+		_committedBytes = 0;
+		pthread_mutex_unlock(&_segmentsMutex);
+
+		TDRS_LOG_INFO("Journal: Opened segment " << path << ".");
+		return true;
+	}
+
+	/**
+	 * @brief      Hands the active segment to the sync thread, which syncs
+	 * its remaining records, unmaps it and trims it to the records it holds.
+	 */
+	void HubJournal::_closeSegment() {
+		static const size_t pageSize = sysconf(_SC_PAGESIZE);
+
+		_journalSync request;
+		request.map = _map;
+		request.mapSize = _mapSize;
+		request.fd = _fd;
+		request.from = _synced - (_synced % pageSize);
+		request.to = _used;
+		request.closing = true;
+		_queueSync(request);
+
+		pthread_mutex_lock(&_segmentsMutex);
+		_segments.back().size = _used;
+		_segments.back().closedAt = HubJournal::_now();
+		pthread_mutex_unlock(&_segmentsMutex);
+
+		_fd = -1;
+		_map = NULL;
+		_mapSize = 0;
+		_used = 0;
+		_synced = 0;
+	}
+
+	/**
+	 * @brief      Hands a range of a segment mapping to the sync thread. A
+	 * range following the last queued one of the same mapping is merged
+	 * into it, so a slow disk does not let the queue grow.
+	 *
+	 * @param[in]  request  The range
+	 */
+	void HubJournal::_queueSync(const _journalSync &request) {
+		pthread_mutex_lock(&_syncMutex);
+		if(!_syncQueue.empty() && _syncQueue.back().map == request.map && !_syncQueue.back().closing) {
+			_syncQueue.back().to = request.to;
+			_syncQueue.back().closing = request.closing;
+		} else {
+			_syncQueue.push_back(request);
+		}
+		pthread_cond_signal(&_syncCondition);
+		pthread_mutex_unlock(&_syncMutex);
+	}
+
+	/**
+	 * @brief      Syncs the queued ranges to disk, off the run-loop, until
+	 * stopped and the queue is empty. Closed segments are unmapped and
+	 * trimmed once synced.
+	 */
+	void HubJournal::_runSync() {
+		pthread_mutex_lock(&_syncMutex);
+		while(true) {
+			while(_syncQueue.empty() && !_syncStop) {
+				pthread_cond_wait(&_syncCondition, &_syncMutex);
+			}
+			if(_syncQueue.empty()) {
+				break;
+			}
+
+			_journalSync request = _syncQueue.front();
+			_syncQueue.pop_front();
+			pthread_mutex_unlock(&_syncMutex);
+
+			if(request.to > request.from && msync(request.map + request.from, request.to - request.from, MS_SYNC) != 0) {
+				TDRS_LOG_WARNING("Journal: Syncing segment failed: " << strerror(errno));
+			}
+
+			if(request.closing) {
+				munmap(request.map, request.mapSize);
+				if(ftruncate(request.fd, request.to) != 0) {
+					TDRS_LOG_WARNING("Journal: Trimming segment failed: " << strerror(errno));
+				}
+				::close(request.fd);
+			}
+
+			pthread_mutex_lock(&_syncMutex);
+		}
+		pthread_mutex_unlock(&_syncMutex);
+	}
+
+	/**
+	 * @brief      The sync thread; static method instantiated as an own
+	 * thread.
+	 *
+	 * @param      journal  The journal
+	 *
+	 * @return     NULL
+	 */
+	void *HubJournal::_syncer(void *journal) {
+		static_cast<HubJournal*>(journal)->_runSync();
+		return NULL;
+	}
+
+	/**
+	 * @brief      Finds the end of the records of the active segment, after a
+	 * restart. Scanning stops at the first record that is incomplete or out
+	 * of sequence; it and everything after it gets overwritten.
+	 */
+	void HubJournal::_recoverSegment() {
+		_nextOffset = _segments.back().baseOffset;
+
+		while(_used + TDRS_JOURNAL_RECORD_HEADER_SIZE <= _mapSize) {
+			uint32_t recordSize;
+			uint64_t offset;
+			memcpy(&recordSize, _map + _used, sizeof(recordSize));
+			memcpy(&offset, _map + _used + 8, sizeof(offset));
+
+			if(recordSize < TDRS_JOURNAL_RECORD_HEADER_SIZE || _used + recordSize > _mapSize || offset != _nextOffset) {
+				break;
+			}
+
+			_used += recordSize;
+			_nextOffset++;
+		}
+
+		// Whatever follows the last record must not be mistaken for one, by replays of records yet to come
+		memset(_map + _used, 0, _mapSize - _used);
+		_synced = _used;
+		_committedBytes.store(_used, std::memory_order_release);
+	}
+
+	/**
+	 * @brief      Opens the journal. Existing segments are kept, appending
+	 * continues after the last complete record.
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool HubJournal::open() {
+		if(mkdir(_directory.c_str(), 0755) != 0 && errno != EEXIST) {
+			TDRS_LOG_ERROR("Journal: Creating directory " << _directory << " failed: " << strerror(errno));
+			return false;
+		}
+
+		DIR *directory = opendir(_directory.c_str());
+		if(directory == NULL) {
+			TDRS_LOG_ERROR("Journal: Opening directory " << _directory << " failed: " << strerror(errno));
+			return false;
+		}
+
+		std::vector<uint64_t> baseOffsets;
+		struct dirent *entry;
+		while((entry = readdir(directory)) != NULL) {
+			std::string name(entry->d_name);
+			size_t suffix = name.size() - strlen(TDRS_JOURNAL_SEGMENT_SUFFIX);
+			if(name.size() > strlen(TDRS_JOURNAL_SEGMENT_SUFFIX) && name.compare(suffix, std::string::npos, TDRS_JOURNAL_SEGMENT_SUFFIX) == 0) {
+				baseOffsets.push_back(strtoull(name.c_str(), NULL, 10));
+			}
+		}
+		closedir(directory);
+		std::sort(baseOffsets.begin(), baseOffsets.end());
+
+		BOOST_FOREACH(uint64_t baseOffset, baseOffsets) {
+			_journalSegment segment;
+			segment.baseOffset = baseOffset;
+			segment.path = _segmentPath(baseOffset);
+
+			struct stat fileStat;
+			if(stat(segment.path.c_str(), &fileStat) != 0) {
+				continue;
+			}
+			segment.size = fileStat.st_size;
+			segment.closedAt = (uint64_t)fileStat.st_mtime * 1000;
+			_segments.push_back(segment);
+		}
+
+		if(_segments.empty()) {
+			if(!_openSegment(0, _segmentSize)) {
+				return false;
+			}
+		} else {
+			if(!_openSegment(_segments.back().baseOffset, std::max(_segments.back().size, _segmentSize))) {
+				return false;
+			}
+			_recoverSegment();
+		}
+
+		_committedOffset = _nextOffset;
+		_syncedAt = HubJournal::_now();
+		_retainedAt = _syncedAt;
+
+		_syncStop = false;
+		if(pthread_create(&_syncThread, NULL, &HubJournal::_syncer, this) != 0) {
+			TDRS_LOG_ERROR("Journal: Starting the sync thread failed.");
+			return false;
+		}
+		_syncThreadStarted = true;
+
+		TDRS_LOG_INFO("Journal: Opened " << _directory << " with " << _segments.size() << " segments, next offset " << _nextOffset << ".");
+		return true;
+	}
+
+	/**
+	 * @brief      Appends a record, rolling over to a new segment once the
+	 * active one is full. Records larger than a segment get a segment of
+	 * their own.
+	 *
+	 * @param[in]  payload       The payload
+	 * @param[in]  payloadSize   The payload size
+	 * @param[in]  envelope      The envelope, if any
+	 * @param[in]  envelopeSize  The envelope size, 0 for none
+	 * @param      offset        The record's offset
+	 *
+	 * @return     True on success, false if no segment could be opened.
+	 */
+	bool HubJournal::append(const void *payload, size_t payloadSize, const void *envelope, size_t envelopeSize, uint64_t *offset) {
+		size_t recordSize = TDRS_JOURNAL_RECORD_HEADER_SIZE + payloadSize + envelopeSize;
+
+		if(_map == NULL || _used + recordSize > _mapSize) {
+			if(_map != NULL) {
+				_closeSegment();
+			}
+
+			if(!_openSegment(_nextOffset, std::max(_segmentSize, recordSize))) {
+				return false;
+			}
+		}
+
+		unsigned char *record = _map + _used;
+		uint32_t recordSize32 = recordSize;
+		uint32_t envelopeSize32 = envelopeSize;
+		uint64_t journaledAt = HubJournal::_now();
+
+		memcpy(record + 4, &envelopeSize32, sizeof(envelopeSize32));
+		memcpy(record + 8, &_nextOffset, sizeof(_nextOffset));
+		memcpy(record + 16, &journaledAt, sizeof(journaledAt));
+		memcpy(record + TDRS_JOURNAL_RECORD_HEADER_SIZE, payload, payloadSize);
+		if(envelopeSize > 0) {
+			memcpy(record + TDRS_JOURNAL_RECORD_HEADER_SIZE + payloadSize, envelope, envelopeSize);
+		}
+		memcpy(record, &recordSize32, sizeof(recordSize32));
+
+		_used += recordSize;
+		*offset = _nextOffset++;
+		_committedBytes.store(_used, std::memory_order_release);
+		_committedOffset.store(_nextOffset, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief      Hands the records appended since the last sync to the sync
+	 * thread, without waiting for the disk.
+	 */
+	void HubJournal::sync() {
+		if(_map == NULL || _used == _synced) {
+			return;
+		}
+
+		static const size_t pageSize = sysconf(_SC_PAGESIZE);
+
+		_journalSync request;
+		request.map = _map;
+		request.mapSize = _mapSize;
+		request.fd = _fd;
+		request.from = _synced - (_synced % pageSize);
+		request.to = _used;
+		request.closing = false;
+		_queueSync(request);
+
+		_synced = _used;
+		_syncedAt = HubJournal::_now();
+	}
+
+	/**
+	 * @brief      Hands the appended records to the sync thread and checks
+	 * the retention, when due. Called by the run-loop after every published
+	 * batch and when idle.
+	 */
+	void HubJournal::maintain() {
+		uint64_t now = HubJournal::_now();
+
+		if(_used != _synced && now - _syncedAt >= _fsyncInterval) {
+			sync();
+		}
+
+		if(now - _retainedAt >= TDRS_JOURNAL_RETENTION_INTERVAL) {
+			_retain(now);
+			_retainedAt = now;
+		}
+	}
+
+	/**
+	 * @brief      Removes the oldest closed segments, as long as all segments
+	 * exceed the retention size or the oldest one exceeds the retention age.
+	 * The active segment is always kept. Replays still reading a removed
+	 * segment keep their mapping.
+	 *
+	 * @param[in]  now   The current time (ms since epoch)
+	 */
+	void HubJournal::_retain(uint64_t now) {
+		pthread_mutex_lock(&_segmentsMutex);
+
+		uint64_t bytes = _used;
+		for(size_t segment = 0; segment + 1 < _segments.size(); segment++) {
+			bytes += _segments[segment].size;
+		}
+
+		while(_segments.size() > 1) {
+			const _journalSegment &oldest = _segments.front();
+			bool tooLarge = (_retentionSize > 0 && bytes > _retentionSize);
+			bool tooOld = (_retentionAge > 0 && oldest.closedAt + _retentionAge * 1000 < now);
+
+			if(!tooLarge && !tooOld) {
+				break;
+			}
+
+			if(unlink(oldest.path.c_str()) != 0) {
+				TDRS_LOG_WARNING("Journal: Removing segment " << oldest.path << " failed: " << strerror(errno));
+			} else {
+				TDRS_LOG_INFO("Journal: Removed segment " << oldest.path << ".");
+			}
+
+			bytes -= oldest.size;
+			_segments.pop_front();
+			_removed++;
+		}
+
+		pthread_mutex_unlock(&_segmentsMutex);
+	}
+
+	/**
+	 * @brief      Closes the journal, once the sync thread synced all
+	 * records.
+	 */
+	void HubJournal::close() {
+		if(_map != NULL) {
+			_closeSegment();
+		}
+
+		pthread_mutex_lock(&_syncMutex);
+		_syncStop = true;
+		pthread_cond_signal(&_syncCondition);
+		pthread_mutex_unlock(&_syncMutex);
+
+		if(_syncThreadStarted) {
+			pthread_join(_syncThread, NULL);
+			_syncThreadStarted = false;
+		} else {
+			_runSync();
+		}
+
+		TDRS_LOG_INFO("Journal: Closed at offset " << _nextOffset << ".");
+	}
+
+	/**
+	 * @brief      Replays the records from an offset on, up to the last
+	 * complete one, reading the segments through mappings of their own.
+	 * Records lost to retention are skipped. Mappings are bounded by the
+	 * committed length of their segment, as taken under the segments lock:
+	 * the active segment is trimmed when it is closed, but never below its
+	 * committed length.
+	 *
+	 * @param[in]  from     The first offset
+	 * @param[in]  handler  The handler, called once per record
+	 * @param      context  The handler's context
+	 *
+	 * @return     The offset following the last replayed record.
+	 */
+	uint64_t HubJournal::replay(uint64_t from, journalReplayHandler handler, void *context) {
+		uint64_t committed = _committedOffset.load(std::memory_order_acquire);
+		uint64_t next = from;
+
+		pthread_mutex_lock(&_segmentsMutex);
+		std::vector<_journalSegment> segments(_segments.begin(), _segments.end());
+		if(!segments.empty() && segments.back().closedAt == 0) {
+			segments.back().size = _committedBytes.load(std::memory_order_acquire);
+		}
+		pthread_mutex_unlock(&_segmentsMutex);
+
+		for(size_t segment = 0; segment < segments.size() && next < committed; segment++) {
+			uint64_t endOffset = (segment + 1 < segments.size() ? segments[segment + 1].baseOffset : committed);
+			if(endOffset <= next) {
+				continue;
+			}
+
+			int fd = ::open(segments[segment].path.c_str(), O_RDONLY);
+			if(fd < 0) {
+				// Removed by retention in the meantime
+				continue;
+			}
+
+			struct stat fileStat;
+			size_t size = 0;
+			void *map = MAP_FAILED;
+			if(fstat(fd, &fileStat) == 0) {
+				size = std::min((size_t)fileStat.st_size, segments[segment].size);
+			}
+			if(size > 0) {
+				map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+			}
+			::close(fd);
+
+			if(map == MAP_FAILED) {
+				continue;
+			}
+
+			const unsigned char *data = static_cast<const unsigned char*>(map);
+			size_t position = 0;
+			bool stopped = false;
+
+			madvise(map, size, MADV_SEQUENTIAL);
+			if(next < segments[segment].baseOffset) {
+				next = segments[segment].baseOffset;
+			}
+
+			while(position + TDRS_JOURNAL_RECORD_HEADER_SIZE <= size) {
+				uint32_t recordSize;
+				uint32_t envelopeSize;
+				uint64_t offset;
+				memcpy(&recordSize, data + position, sizeof(recordSize));
+				memcpy(&envelopeSize, data + position + 4, sizeof(envelopeSize));
+				memcpy(&offset, data + position + 8, sizeof(offset));
+
+				if(recordSize < TDRS_JOURNAL_RECORD_HEADER_SIZE + envelopeSize || position + recordSize > size || offset >= committed) {
+					break;
+				}
+
+				if(offset >= next) {
+					const unsigned char *payload = data + position + TDRS_JOURNAL_RECORD_HEADER_SIZE;
+					size_t payloadSize = recordSize - TDRS_JOURNAL_RECORD_HEADER_SIZE - envelopeSize;
+
+					if(!handler(context, offset, payload, payloadSize, payload + payloadSize, envelopeSize)) {
+						stopped = true;
+						break;
+					}
+					next = offset + 1;
+				}
+
+				position += recordSize;
+			}
+
+			munmap(map, size);
+
+			if(stopped) {
+				break;
+			}
+		}
+
+		return next;
+	}
+
+	/**
+	 * @brief      Returns the offset the next record will get.
+	 *
+	 * @return     The offset.
+	 */
+	uint64_t HubJournal::nextOffset() const {
+		return _committedOffset.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * @brief      Returns the occupancy and counters of the journal.
+	 *
+	 * @return     The stats.
+	 */
+	journalStats HubJournal::stats() {
+		journalStats stats;
+
+		pthread_mutex_lock(&_segmentsMutex);
+		stats.firstOffset = (_segments.empty() ? _nextOffset : _segments.front().baseOffset);
+		stats.segments = _segments.size();
+		stats.bytes = _used;
+		for(size_t segment = 0; segment + 1 < _segments.size(); segment++) {
+			stats.bytes += _segments[segment].size;
+		}
+		pthread_mutex_unlock(&_segmentsMutex);
+
+		stats.nextOffset = _nextOffset;
+		stats.removed = _removed;
+		return stats;
+	}
+}
@@ -0,0 +1,185 @@
+#include "tdrs.hpp"
+#include <cstring>
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object.
+	 */
+	HubLastValueCache::HubLastValueCache() {
+		pthread_mutex_init(&_entriesMutex, NULL);
+		_maxBytes = 0;
+		_delimiter = TDRS_CACHE_DEFAULT_DELIMITER;
+		_bytes = 0;
+		_evicted = 0;
+	}
+
+	/**
+	 * @brief      Destroys the object.
+	 */
+	HubLastValueCache::~HubLastValueCache() {
+		pthread_mutex_destroy(&_entriesMutex);
+	}
+
+	/**
+	 * @brief      Static method returning the memory an entry accounts for:
+	 * its key, the rest of its event and the bookkeeping around both.
+	 *
+	 * @param[in]  key    The key
+	 * @param[in]  entry  The entry
+	 *
+	 * @return     The memory (bytes).
+	 */
+	size_t HubLastValueCache::_entryBytes(const std::string &key, const _cacheEntry &entry) {
+		return key.size() + entry.rest.capacity() + TDRS_CACHE_ENTRY_OVERHEAD;
+	}
+
+	/**
+	 * @brief      Removes an entry. Requires the entries to be locked.
+	 *
+	 * @param[in]  entry  The entry
+	 */
+	void HubLastValueCache::_erase(std::map<std::string, _cacheEntry>::iterator entry) {
+		_bytes -= HubLastValueCache::_entryBytes(entry->first, entry->second);
+		_updated.erase(entry->second.updated);
+		_entries.erase(entry);
+	}
+
+	/**
+	 * @brief      Configures the cache.
+	 *
+	 * @param[in]  maxBytes   The maximum memory (bytes)
+	 * @param[in]  delimiter  The delimiter ending the key of an event
+	 */
+	void HubLastValueCache::configure(size_t maxBytes, char delimiter) {
+		_maxBytes = maxBytes;
+		_delimiter = delimiter;
+	}
+
+	/**
+	 * @brief      Caches an event as the last value of its key, if it has one,
+	 * evicting the least recently updated keys once the cache exceeds its
+	 * maximum memory. The key is only stored once, the entry holds the rest of
+	 * the event.
+	 *
+	 * @param[in]  payload  The event
+	 * @param[in]  size     The event size
+	 *
+	 * @return     True if the event was cached, false otherwise.
+	 */
+	bool HubLastValueCache::update(const void *payload, size_t size) {
+		const char *bytes = static_cast<const char*>(payload);
+		size_t controlSize = strlen(TDRS_CHAIN_CONTROL_TOPIC);
+
+		if(size >= controlSize && memcmp(bytes, TDRS_CHAIN_CONTROL_TOPIC, controlSize) == 0) {
+			return false;
+		}
+
+		const char *delimiter = static_cast<const char*>(memchr(bytes, _delimiter, std::min(size, (size_t)TDRS_CACHE_MAX_KEY_SIZE + 1)));
+		if(delimiter == NULL || delimiter == bytes) {
+			return false;
+		}
+
+		std::string key(bytes, delimiter - bytes);
+		bool cached = true;
+
+		pthread_mutex_lock(&_entriesMutex);
+		std::map<std::string, _cacheEntry>::iterator entry = _entries.find(key);
+		if(entry == _entries.end()) {
+			entry = _entries.insert(std::make_pair(key, _cacheEntry())).first;
+			entry->second.updated = _updated.insert(_updated.end(), &entry->first);
+		} else {
+			_bytes -= HubLastValueCache::_entryBytes(entry->first, entry->second);
+			_updated.splice(_updated.end(), _updated, entry->second.updated);
+		}
+
+		entry->second.rest.assign(delimiter, bytes + size - delimiter);
+		if(entry->second.rest.capacity() > 2 * entry->second.rest.size()) {
+			// Values shrinking for good must not keep their old capacity
+			std::string(entry->second.rest).swap(entry->second.rest);
+		}
+		size_t entryBytes = HubLastValueCache::_entryBytes(entry->first, entry->second);
+		_bytes += entryBytes;
+
+		if(entryBytes > _maxBytes) {
+			// An event that cannot fit on its own is not cached, nor is its stale predecessor
+			_erase(entry);
+			cached = false;
+		}
+
+		while(_bytes > _maxBytes && !_updated.empty()) {
+			_erase(_entries.find(*_updated.front()));
+			_evicted++;
+		}
+		pthread_mutex_unlock(&_entriesMutex);
+
+		return cached;
+	}
+
+	/**
+	 * @brief      Collects the cached events starting with a prefix, in key
+	 * order, continuing after the key of the last one collected before. The
+	 * entries are only locked while collecting, so that snapshots of any size
+	 * can be taken in batches while the cache keeps being updated.
+	 *
+	 * A prefix shorter than a key matches all keys starting with it; a prefix
+	 * reaching beyond a key matches the events of that key starting with it,
+	 * just like subscriptions do.
+	 *
+	 * @param[in]  prefix    The prefix
+	 * @param      cursor    The key of the last event collected, empty to start
+	 * @param[in]  max       The maximum number of events to collect
+	 * @param      payloads  The events
+	 *
+	 * @return     True if there are more events to collect, false otherwise.
+	 */
+	bool HubLastValueCache::collect(const std::string &prefix, std::string *cursor, size_t max, std::vector<std::string> *payloads) {
+		size_t delimiter = prefix.find(_delimiter);
+		std::string keyPrefix = prefix.substr(0, delimiter);
+		bool exact = (delimiter != std::string::npos);
+		bool more = false;
+
+		payloads->clear();
+
+		pthread_mutex_lock(&_entriesMutex);
+		std::map<std::string, _cacheEntry>::const_iterator entry = (cursor->empty() ? _entries.lower_bound(keyPrefix) : _entries.upper_bound(*cursor));
+		for(; entry != _entries.end(); entry++) {
+			if(entry->first.compare(0, keyPrefix.size(), keyPrefix) != 0 || (exact && entry->first.size() != keyPrefix.size())) {
+				break;
+			}
+
+			if(payloads->size() >= max) {
+				more = true;
+				break;
+			}
+
+			std::string payload = entry->first + entry->second.rest;
+			if(payload.compare(0, prefix.size(), prefix) == 0) {
+				payloads->push_back(payload);
+			}
+			*cursor = entry->first;
+		}
+		pthread_mutex_unlock(&_entriesMutex);
+
+		return more;
+	}
+
+	/**
+	 * @brief      Returns the occupancy and counters of the cache.
+	 *
+	 * @return     The stats.
+	 */
+	lastValueCacheStats HubLastValueCache::stats() {
+		lastValueCacheStats stats;
+
+		pthread_mutex_lock(&_entriesMutex);
+		stats.entries = _entries.size();
+		stats.bytes = _bytes;
+		stats.evicted = _evicted;
+		pthread_mutex_unlock(&_entriesMutex);
+
+		return stats;
+	}
+}
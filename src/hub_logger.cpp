@@ -0,0 +1,233 @@
+#include "tdrs.hpp"
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * Log level, lines above it are discarded.
+	 */
+	std::atomic<int> Logger::level(TDRS_LOG_LEVEL_INFO);
+	/**
+	 * Mutex guarding the buffers vector and the draining of the buffers.
+	 */
+	pthread_mutex_t Logger::_buffersMutex = PTHREAD_MUTEX_INITIALIZER;
+	/**
+	 * Buffers of all threads that logged at least once.
+	 */
+	std::vector<_logBuffer*> Logger::_buffers;
+	/**
+	 * Writer thread.
+	 */
+	pthread_t Logger::_writerThread;
+	/**
+	 * The writer's run-loop variable.
+	 */
+	std::atomic<bool> Logger::_runWriter(false);
+	/**
+	 * Number of lines dropped since the last report, as their buffer was full.
+	 */
+	std::atomic<uint64_t> Logger::_droppedLines(0);
+
+	/**
+	 * @brief      Owner of a thread's log buffer, handing the buffer over to the
+	 * writer when the thread exits. The writer frees it from then on, so it
+	 * is forgotten here; lines logged later on while the thread exits go to
+	 * a new buffer.
+	 */
+	struct _logBufferOwner {
+		_logBuffer *buffer;
+
+		~_logBufferOwner() {
+			if(buffer != NULL) {
+				buffer->orphaned.store(true, std::memory_order_release);
+				buffer = NULL;
+			}
+		}
+	};
+
+	static thread_local _logBufferOwner logBufferOwner = { NULL };
+
+	/**
+	 * @brief      Returns the calling thread's log buffer, registering it on first use.
+	 *
+	 * @return     The log buffer.
+	 */
+	_logBuffer *Logger::_threadBuffer() {
+		if(logBufferOwner.buffer == NULL) {
+			_logBuffer *buffer = new _logBuffer;
+			buffer->lines.resize(TDRS_LOG_BUFFER_LINES);
+			buffer->head.store(0);
+			buffer->tail.store(0);
+			buffer->orphaned.store(false);
+
+			pthread_mutex_lock(&_buffersMutex);
+			_buffers.push_back(buffer);
+			pthread_mutex_unlock(&_buffersMutex);
+
+			logBufferOwner.buffer = buffer;
+		}
+
+		return logBufferOwner.buffer;
+	}
+
+	/**
+	 * @brief      Parses a log level name.
+	 *
+	 * @param[in]  name   The name, one of error, warning, info, debug
+	 * @param      level  The parsed level
+	 *
+	 * @return     True on success, false on unknown names.
+	 */
+	bool Logger::parseLevel(const std::string &name, int *level) {
+		static const char *names[] = { "error", "warning", "info", "debug" };
+
+		for(int index = TDRS_LOG_LEVEL_ERROR; index <= TDRS_LOG_LEVEL_DEBUG; index++) {
+			if(name == names[index]) {
+				*level = index;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/**
+	 * @brief      Returns the calling thread's stream for formatting one line,
+	 * writing into the thread's fixed line buffer.
+	 *
+	 * @return     The emptied stream.
+	 */
+	std::ostream &Logger::stream() {
+		_logBuffer *buffer = _threadBuffer();
+		buffer->line.reset();
+		// A line cut off leaves the stream failed
+		buffer->stream.clear();
+		return buffer->stream;
+	}
+
+	/**
+	 * @brief      Commits the line formatted on the calling thread's stream.
+	 * Never blocks: if the thread's buffer is full, the line is dropped.
+	 */
+	void Logger::commit() {
+		_logBuffer *buffer = _threadBuffer();
+		size_t head = buffer->head.load(std::memory_order_relaxed);
+
+		if(head - buffer->tail.load(std::memory_order_acquire) >= buffer->lines.size()) {
+			_droppedLines.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		// Lines keep their capacity once drained, so this only allocates while the buffer warms up
+		std::string &line = buffer->lines[head % buffer->lines.size()];
+		line.assign(buffer->line.data(), buffer->line.size());
+		line += '\n';
+		buffer->head.store(head + 1, std::memory_order_release);
+	}
+
+	/**
+	 * @brief      Moves all committed lines into the output, freeing the
+	 * buffers of exited threads. Requires the buffers mutex.
+	 *
+	 * @param      output  The output
+	 */
+	void Logger::_drain(std::string &output) {
+		std::vector<_logBuffer*>::iterator buffer = _buffers.begin();
+
+		while(buffer != _buffers.end()) {
+			// Read before the lines, so no line committed by an exited thread is missed
+			bool orphaned = (*buffer)->orphaned.load(std::memory_order_acquire);
+			size_t tail = (*buffer)->tail.load(std::memory_order_relaxed);
+			size_t head = (*buffer)->head.load(std::memory_order_acquire);
+
+			for(; tail != head; tail++) {
+				std::string &line = (*buffer)->lines[tail % (*buffer)->lines.size()];
+				output += line;
+				line.clear();
+			}
+			(*buffer)->tail.store(tail, std::memory_order_release);
+
+			if(orphaned) {
+				delete *buffer;
+				buffer = _buffers.erase(buffer);
+			} else {
+				buffer++;
+			}
+		}
+
+		uint64_t droppedLines = _droppedLines.exchange(0, std::memory_order_relaxed);
+		if(droppedLines > 0) {
+			output += "Logger: Dropped " + std::to_string(droppedLines) + " lines, as log buffers were full.\n";
+		}
+	}
+
+	/**
+	 * @brief      The writer; static method instantiated as an own thread.
+	 *
+	 * @return     NULL
+	 */
+	void *Logger::_writer(void *) {
+		std::string output;
+
+		while(_runWriter.load(std::memory_order_acquire)) {
+			pthread_mutex_lock(&_buffersMutex);
+			_drain(output);
+			pthread_mutex_unlock(&_buffersMutex);
+
+			if(output.empty()) {
+				usleep(TDRS_LOG_WRITER_IDLE_USEC);
+				continue;
+			}
+
+			fwrite(output.data(), 1, output.size(), stdout);
+			fflush(stdout);
+			output.clear();
+		}
+
+		return NULL;
+	}
+
+	/**
+	 * @brief      Starts the writer thread.
+	 */
+	void Logger::start() {
+		if(_runWriter.exchange(true)) {
+			return;
+		}
+
+		// Signals are handled by the main thread only
+		sigset_t signalSet, previousSignalSet;
+		sigemptyset(&signalSet);
+		sigaddset(&signalSet, SIGINT);
+		pthread_sigmask(SIG_BLOCK, &signalSet, &previousSignalSet);
+
+		pthread_create(&_writerThread, NULL, &Logger::_writer, NULL);
+
+		pthread_sigmask(SIG_SETMASK, &previousSignalSet, NULL);
+	}
+
+	/**
+	 * @brief      Synchronously writes all committed lines.
+	 */
+	void Logger::flush() {
+		std::string output;
+
+		pthread_mutex_lock(&_buffersMutex);
+		_drain(output);
+		fwrite(output.data(), 1, output.size(), stdout);
+		fflush(stdout);
+		pthread_mutex_unlock(&_buffersMutex);
+	}
+
+	/**
+	 * @brief      Stops the writer thread and writes all remaining lines.
+	 */
+	void Logger::shutdown() {
+		if(_runWriter.exchange(false)) {
+			pthread_join(_writerThread, NULL);
+		}
+
+		flush();
+	}
+}
@@ -0,0 +1,267 @@
+#include "tdrs.hpp"
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object.
+	 */
+	HubOverlay::HubOverlay() {
+		_topology = TDRS_OVERLAY_MESH;
+		_fanout = TDRS_OVERLAY_DEFAULT_FANOUT;
+		_superPeers = TDRS_OVERLAY_DEFAULT_SUPER_PEERS;
+	}
+
+	/**
+	 * @brief      Static method parsing the name of an overlay topology.
+	 *
+	 * @param[in]  name      The name, one of 'mesh', 'tree', 'super-peer'
+	 * @param      topology  The topology
+	 *
+	 * @return     True on success, false for an unknown name.
+	 */
+	bool HubOverlay::parseTopology(const std::string &name, int *topology) {
+		if(name == "mesh") {
+			*topology = TDRS_OVERLAY_MESH;
+		} else if(name == "tree") {
+			*topology = TDRS_OVERLAY_TREE;
+		} else if(name == "super-peer") {
+			*topology = TDRS_OVERLAY_SUPER_PEER;
+		} else {
+			return false;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief      Static method returning the key a hub is ordered by in the
+	 * overlay, its identifier as 16 hex digits, so keys order like the
+	 * identifiers.
+	 *
+	 * @param[in]  hubId  The hub identifier
+	 *
+	 * @return     The key.
+	 */
+	std::string HubOverlay::memberKey(uint64_t hubId) {
+		char key[17];
+		snprintf(key, sizeof(key), "%016llx", (unsigned long long)hubId);
+		return std::string(key, 16);
+	}
+
+	/**
+	 * @brief      Configures the overlay.
+	 *
+	 * @param[in]  topology    The topology
+	 * @param[in]  fanout      The number of children per hub, with the tree topology
+	 * @param[in]  superPeers  The number of super-peers, with the super-peer topology
+	 * @param[in]  self        The key of this hub
+	 */
+	void HubOverlay::configure(int topology, size_t fanout, size_t superPeers, const std::string &self) {
+		_topology = topology;
+		_fanout = std::max(fanout, (size_t)1);
+		_superPeers = std::max(superPeers, (size_t)1);
+		_self = self;
+	}
+
+	/**
+	 * @brief      Adds a peer to the members, replacing a former peer with the
+	 * same key.
+	 *
+	 * @param[in]  key   The key of the peer
+	 * @param[in]  id    The peer identifier
+	 */
+	void HubOverlay::enter(const std::string &key, const std::string &id) {
+		exit(id);
+
+		std::map<std::string, std::string>::iterator former = _members.find(key);
+		if(former != _members.end()) {
+			_keys.erase(former->second);
+		}
+
+		_members[key] = id;
+		_keys[id] = key;
+	}
+
+	/**
+	 * @brief      Removes a peer from the members.
+	 *
+	 * @param[in]  id    The peer identifier
+	 */
+	void HubOverlay::exit(const std::string &id) {
+		std::map<std::string, std::string>::iterator key = _keys.find(id);
+		if(key == _keys.end()) {
+			return;
+		}
+
+		_members.erase(key->second);
+		_keys.erase(key);
+	}
+
+	/**
+	 * @brief      Returns the number of members, this hub included.
+	 *
+	 * @return     The number of members.
+	 */
+	size_t HubOverlay::size() const {
+		return _members.size() + (_members.count(_self) == 0 ? 1 : 0);
+	}
+
+	/**
+	 * @brief      Returns the level of a member in the tree, derived from its
+	 * key alone: every level is `fanout` times rarer than the one below.
+	 *
+	 * @param[in]  key   The key of the member
+	 *
+	 * @return     The level.
+	 */
+	size_t HubOverlay::_level(const std::string &key) const {
+		uint64_t hash = XXH3_64bits(key.data(), key.size());
+		size_t level = 0;
+
+		while(level < TDRS_OVERLAY_MAX_LEVEL && hash % _fanout == 0) {
+			hash /= _fanout;
+			level++;
+		}
+
+		return level;
+	}
+
+	/**
+	 * @brief      Returns the parents of all members in the tree. The parent
+	 * of a member is the nearest member before it, in key order and wrapping
+	 * around, on a higher level; members on the highest level hang off the
+	 * first of them, the root. A member entering or exiting thus only moves
+	 * the members following it up to the next one on its level or higher,
+	 * `fanout` per level below its own on average, and events cross
+	 * O(log N) hubs.
+	 *
+	 * @param[in]  keys     The keys of the members, ordered
+	 * @param      parents  The index of every member's parent, the root's own
+	 */
+	void HubOverlay::_parents(const std::vector<std::string> &keys, std::vector<size_t> *parents) const {
+		parents->assign(keys.size(), 0);
+
+		// A single child per hub is a line
+		if(_fanout < 2) {
+			for(size_t member = 1; member < keys.size(); member++) {
+				(*parents)[member] = member - 1;
+			}
+			return;
+		}
+
+		std::vector<size_t> levels;
+		size_t root = 0;
+		for(size_t member = 0; member < keys.size(); member++) {
+			levels.push_back(_level(keys[member]));
+			if(levels[member] > levels[root]) {
+				root = member;
+			}
+		}
+
+		for(size_t member = 0; member < keys.size(); member++) {
+			(*parents)[member] = root;
+			for(size_t step = 1; step < keys.size(); step++) {
+				size_t before = (member + keys.size() - step) % keys.size();
+				if(levels[before] > levels[member]) {
+					(*parents)[member] = before;
+					break;
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief      Returns the super-peer a member links to, by rendezvous
+	 * hashing: the one whose key hashes highest along with the member's.
+	 * Members only move when their own super-peer exits or another becomes
+	 * one.
+	 *
+	 * @param[in]  keys        The keys of the members, ordered
+	 * @param[in]  superPeers  The number of super-peers, the first members
+	 * @param[in]  member      The index of the member
+	 *
+	 * @return     The index of the super-peer.
+	 */
+	size_t HubOverlay::_superPeer(const std::vector<std::string> &keys, size_t superPeers, size_t member) const {
+		size_t chosen = 0;
+		uint64_t highest = 0;
+
+		for(size_t superPeer = 0; superPeer < superPeers; superPeer++) {
+			std::string pair = keys[member] + keys[superPeer];
+			uint64_t weight = XXH3_64bits(pair.data(), pair.size());
+			if(superPeer == 0 || weight > highest) {
+				chosen = superPeer;
+				highest = weight;
+			}
+		}
+
+		return chosen;
+	}
+
+	/**
+	 * @brief      Returns the peers this hub links to, derived from the members
+	 * ordered by key. As every hub orders the same members the same way, two
+	 * hubs agree on linking to each other, so events flow both ways.
+	 *
+	 * With the mesh topology, every hub links to every other. With the tree
+	 * topology, every hub links to its parent and its children, about
+	 * `fanout` per level below its own. With the super-peer topology, the
+	 * `superPeers` members with the lowest keys link to each other and every
+	 * other hub links to one of them only. Either way, a hub entering or
+	 * exiting only moves the links of a few hubs around it, not of all that
+	 * follow it in key order.
+	 *
+	 * @param      ids   The identifiers of the peers to link to
+	 */
+	void HubOverlay::neighbors(std::set<std::string> *ids) const {
+		ids->clear();
+
+		if(_topology == TDRS_OVERLAY_MESH) {
+			std::map<std::string, std::string>::const_iterator member;
+			for(member = _members.begin(); member != _members.end(); member++) {
+				ids->insert(member->second);
+			}
+			return;
+		}
+
+		// Members in key order, this hub included as an empty identifier
+		std::map<std::string, std::string> ordered(_members);
+		ordered[_self] = "";
+		std::vector<std::string> keys;
+		std::vector<std::string> members;
+		size_t self = 0;
+		std::map<std::string, std::string>::const_iterator member;
+		for(member = ordered.begin(); member != ordered.end(); member++) {
+			if(member->first == _self) {
+				self = members.size();
+			}
+			keys.push_back(member->first);
+			members.push_back(member->second);
+		}
+
+		if(_topology == TDRS_OVERLAY_TREE) {
+			std::vector<size_t> parents;
+			_parents(keys, &parents);
+			for(size_t index = 0; index < members.size(); index++) {
+				if(index != self && (parents[self] == index || parents[index] == self)) {
+					ids->insert(members[index]);
+				}
+			}
+		} else {
+			size_t superPeers = std::min(_superPeers, members.size());
+			if(self < superPeers) {
+				for(size_t index = 0; index < members.size(); index++) {
+					if(index != self && (index < superPeers || _superPeer(keys, superPeers, index) == self)) {
+						ids->insert(members[index]);
+					}
+				}
+			} else {
+				ids->insert(members[_superPeer(keys, superPeers, self)]);
+			}
+		}
+
+		ids->erase("");
+	}
+}
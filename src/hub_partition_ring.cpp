@@ -0,0 +1,167 @@
+#include "tdrs.hpp"
+#include <cstring>
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object.
+	 */
+	HubPartitionRing::HubPartitionRing() {
+		_delimiter = TDRS_PARTITION_DEFAULT_DELIMITER;
+	}
+
+	/**
+	 * @brief      Configures the ring.
+	 *
+	 * @param[in]  delimiter  The delimiter ending the topic of an event
+	 */
+	void HubPartitionRing::configure(char delimiter) {
+		_delimiter = delimiter;
+	}
+
+	/**
+	 * @brief      Static method hashing bytes onto the ring.
+	 *
+	 * @param[in]  data  The data
+	 * @param[in]  size  The size
+	 *
+	 * @return     The position on the ring.
+	 */
+	uint64_t HubPartitionRing::hash(const void *data, size_t size) {
+		return XXH3_64bits(data, size);
+	}
+
+	/**
+	 * @brief      Adds a hub to the ring, at TDRS_PARTITION_VIRTUAL_NODES
+	 * positions derived from its key, replacing a former hub with the same
+	 * identifier or key.
+	 *
+	 * @param[in]  id      The peer identifier, empty for this hub
+	 * @param[in]  key     The key of the hub
+	 * @param[in]  member  The addresses of the hub
+	 */
+	void HubPartitionRing::add(const std::string &id, const std::string &key, const partitionMember &member) {
+		remove(id);
+		_removeKey(key);
+
+		for(size_t node = 0; node < TDRS_PARTITION_VIRTUAL_NODES; node++) {
+			std::string point = key + "#" + std::to_string(node);
+			uint64_t position = HubPartitionRing::hash(point.data(), point.size());
+			// Colliding positions go to the smaller key, on every hub alike
+			std::map<uint64_t, std::string>::iterator taken = _points.find(position);
+			if(taken == _points.end() || key < taken->second) {
+				_points[position] = key;
+			}
+		}
+
+		_members[key] = member;
+		_keys[id] = key;
+	}
+
+	/**
+	 * @brief      Removes a hub from the ring; its topics move to the hubs
+	 * following its positions, all others stay where they are.
+	 *
+	 * @param[in]  id    The peer identifier
+	 */
+	void HubPartitionRing::remove(const std::string &id) {
+		std::map<std::string, std::string>::iterator key = _keys.find(id);
+		if(key == _keys.end()) {
+			return;
+		}
+
+		std::string removed = key->second;
+		_keys.erase(key);
+		_removeKey(removed);
+	}
+
+	/**
+	 * @brief      Removes the positions and addresses of the hub with a key.
+	 *
+	 * @param[in]  key   The key of the hub
+	 */
+	void HubPartitionRing::_removeKey(const std::string &key) {
+		if(_members.erase(key) == 0) {
+			return;
+		}
+
+		std::map<uint64_t, std::string>::iterator point = _points.begin();
+		while(point != _points.end()) {
+			if(point->second == key) {
+				_points.erase(point++);
+			} else {
+				point++;
+			}
+		}
+
+		std::map<std::string, std::string>::iterator id;
+		for(id = _keys.begin(); id != _keys.end(); id++) {
+			if(id->second == key) {
+				_keys.erase(id);
+				break;
+			}
+		}
+	}
+
+	/**
+	 * @brief      Returns the key of the hub owning a topic, the first hub at
+	 * or after the topic's position on the ring.
+	 *
+	 * @param[in]  topic  The topic
+	 * @param[in]  size   The size of the topic
+	 *
+	 * @return     The key of the owner, empty for an empty ring.
+	 */
+	const std::string &HubPartitionRing::owner(const char *topic, size_t size) const {
+		static const std::string none;
+
+		if(_points.empty()) {
+			return none;
+		}
+
+		std::map<uint64_t, std::string>::const_iterator point = _points.lower_bound(HubPartitionRing::hash(topic, size));
+		if(point == _points.end()) {
+			point = _points.begin();
+		}
+
+		return point->second;
+	}
+
+	/**
+	 * @brief      Returns the key of the hub owning the topic of an event, its
+	 * leading bytes up to the delimiter, or all of them without one.
+	 *
+	 * @param[in]  data  The event
+	 * @param[in]  size  The size of the event
+	 *
+	 * @return     The key of the owner, empty for an empty ring.
+	 */
+	const std::string &HubPartitionRing::ownerOf(const void *data, size_t size) const {
+		const char *bytes = static_cast<const char*>(data);
+		const char *delimiter = static_cast<const char*>(memchr(bytes, _delimiter, size));
+		return owner(bytes, (delimiter == NULL ? size : delimiter - bytes));
+	}
+
+	/**
+	 * @brief      Returns the addresses of a hub.
+	 *
+	 * @param[in]  key   The key of the hub
+	 *
+	 * @return     The addresses, NULL for an unknown hub.
+	 */
+	const partitionMember *HubPartitionRing::member(const std::string &key) const {
+		std::map<std::string, partitionMember>::const_iterator member = _members.find(key);
+		return (member == _members.end() ? NULL : &member->second);
+	}
+
+	/**
+	 * @brief      Returns the addresses of all hubs, by key.
+	 *
+	 * @return     The members.
+	 */
+	const std::map<std::string, partitionMember> &HubPartitionRing::members() const {
+		return _members;
+	}
+}
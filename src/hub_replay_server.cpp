@@ -0,0 +1,148 @@
+#include "tdrs.hpp"
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object.
+	 *
+	 * @param      params  The parameters
+	 */
+	HubReplayServer::HubReplayServer(_replayServerParams *params) : _zmqReplaySocket(*params->context, ZMQ_ROUTER) {
+		_params = params;
+		_failed = false;
+	}
+
+	/**
+	 * @brief      Sends one message to the client being served, prefixed by its
+	 * routing frames, waiting for a client that cannot keep up for a while.
+	 *
+	 * @param      frames  The frames
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool HubReplayServer::_reply(std::vector<zmq::message_t> &frames) {
+		return Hub::sendRouted(_zmqReplaySocket, _routing, frames, _params->run);
+	}
+
+	/**
+	 * @brief      Static method sending one replayed record as
+	 * `[event]([envelope])[offset]`, the way it was published.
+	 *
+	 * @return     True to continue, false to stop the replay.
+	 */
+	bool HubReplayServer::_replayRecord(void *context, uint64_t offset, const void *payload, size_t payloadSize, const void *envelope, size_t envelopeSize) {
+		HubReplayServer *server = static_cast<HubReplayServer*>(context);
+		std::vector<zmq::message_t> frames;
+
+		frames.push_back(zmq::message_t(payload, payloadSize));
+		if(envelopeSize > 0) {
+			frames.push_back(zmq::message_t(envelope, envelopeSize));
+		}
+		frames.push_back(zmq::message_t());
+		Hub::buildOffset(offset, &frames.back());
+
+		if(!server->_reply(frames)) {
+			server->_failed = true;
+			return false;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief      Serves one replay request.
+	 *
+	 * The request's last frame holds the offset to replay from, in decimal;
+	 * any frames before it are routing frames and are mirrored. The journaled
+	 * events follow, up to the most recent one, each as one message. A
+	 * message holding nothing but an offset frame ends the replay: it is the
+	 * offset of the first event not replayed, from which on the client takes
+	 * the live events.
+	 */
+	void HubReplayServer::_serve() {
+		std::vector<zmq::message_t> frames;
+
+		try {
+			do {
+				frames.push_back(zmq::message_t());
+				_zmqReplaySocket.recv(&frames.back());
+			} while(frames.back().more());
+		} catch(...) {
+			return;
+		}
+
+		std::string request(static_cast<const char*>(frames.back().data()), frames.back().size());
+		frames.pop_back();
+		_routing.swap(frames);
+		_failed = false;
+
+		char *end = NULL;
+		uint64_t from = strtoull(request.c_str(), &end, 10);
+		std::vector<zmq::message_t> response;
+
+		if(request.empty() || end == NULL || *end != '\0') {
+			TDRS_LOG_WARNING("Replay: Ignoring invalid request.");
+			std::string error = "NOK INVALID OFFSET";
+			response.push_back(zmq::message_t(error.data(), error.size()));
+			_reply(response);
+			return;
+		}
+
+		TDRS_LOG_INFO("Replay: Replaying from offset " << from << " ...");
+		uint64_t next = _params->journal->replay(from, &HubReplayServer::_replayRecord, this);
+
+		if(_failed || _params->run == false) {
+			TDRS_LOG_WARNING("Replay: Replay stopped at offset " << next << ".");
+			return;
+		}
+
+		response.push_back(zmq::message_t());
+		Hub::buildOffset(next, &response.back());
+		_reply(response);
+		TDRS_LOG_INFO("Replay: Replayed up to offset " << next << ".");
+	}
+
+	/**
+	 * @brief      Runs the replay server, serving one replay at a time, until
+	 * it is requested to stop.
+	 */
+	void HubReplayServer::run() {
+		TDRS_LOG_INFO("Replay: Binding replay server at " << _params->listen << " ...");
+		int _zmqReplaySocketLinger = 0;
+		int _zmqReplaySocketTimeout = TDRS_REPLAY_POLL_INTERVAL;
+		int _zmqReplaySocketMandatory = 1;
+		_zmqReplaySocket.setsockopt(ZMQ_LINGER, &_zmqReplaySocketLinger, sizeof(_zmqReplaySocketLinger));
+		_zmqReplaySocket.setsockopt(ZMQ_SNDTIMEO, &_zmqReplaySocketTimeout, sizeof(_zmqReplaySocketTimeout));
+		// Wait for clients that cannot keep up, for a while, instead of dropping events for them
+		_zmqReplaySocket.setsockopt(ZMQ_ROUTER_MANDATORY, &_zmqReplaySocketMandatory, sizeof(_zmqReplaySocketMandatory));
+		try {
+			_zmqReplaySocket.bind(_params->listen);
+		} catch(...) {
+			TDRS_LOG_ERROR("Replay: Binding replay server at " << _params->listen << " failed!");
+			_zmqReplaySocket.close();
+			return;
+		}
+		TDRS_LOG_INFO("Replay: Bound replay server.");
+
+		zmq::pollitem_t pollItems[] = {
+			{ (void *)_zmqReplaySocket, 0, ZMQ_POLLIN, 0 }
+		};
+
+		while(_params->run == true) {
+			try {
+				if(zmq::poll(pollItems, 1, TDRS_REPLAY_POLL_INTERVAL) == 0) {
+					continue;
+				}
+			} catch(...) {
+				continue;
+			}
+
+			_serve();
+		}
+
+		_zmqReplaySocket.close();
+		TDRS_LOG_INFO("Replay: Goodbye!");
+	}
+}
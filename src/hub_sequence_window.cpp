@@ -0,0 +1,104 @@
+#include "tdrs.hpp"
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object.
+	 */
+	HubSequenceWindow::HubSequenceWindow() {
+		_accepted = 0;
+		_duplicates = 0;
+		_stale = 0;
+	}
+
+	/**
+	 * @brief      Forgets the origin seen least recently, to make room for a
+	 * new one.
+	 */
+	void HubSequenceWindow::_evictOrigin() {
+		std::unordered_map<uint64_t, _sequenceWindowEntry>::iterator oldest = _origins.begin();
+
+		for(std::unordered_map<uint64_t, _sequenceWindowEntry>::iterator entry = _origins.begin(); entry != _origins.end(); entry++) {
+			if(entry->second.lastSeen < oldest->second.lastSeen) {
+				oldest = entry;
+			}
+		}
+
+		_origins.erase(oldest);
+	}
+
+	/**
+	 * @brief      Checks an event against the window of its origin and marks
+	 * it as seen.
+	 *
+	 * @param[in]  origin    The origin hub identifier
+	 * @param[in]  sequence  The event's sequence number at its origin
+	 *
+	 * @return     True if the event was not seen before, false if it is a
+	 * duplicate or too old to tell.
+	 */
+	bool HubSequenceWindow::accept(uint64_t origin, uint64_t sequence) {
+		std::unordered_map<uint64_t, _sequenceWindowEntry>::iterator known = _origins.find(origin);
+
+		if(known == _origins.end()) {
+			if(_origins.size() >= TDRS_SEQUENCE_WINDOW_MAX_ORIGINS) {
+				_evictOrigin();
+			}
+
+			_sequenceWindowEntry &entry = _origins[origin];
+			memset(entry.seen, 0, sizeof(entry.seen));
+			entry.highest = sequence;
+			entry.lastSeen = _accepted;
+			entry.seen[(sequence % TDRS_SEQUENCE_WINDOW) / 64] |= (uint64_t)1 << (sequence % 64);
+
+			_accepted++;
+			return true;
+		}
+
+		_sequenceWindowEntry &entry = known->second;
+
+		if(sequence > entry.highest) {
+			// Slide the window, forgetting the sequence numbers that drop out
+			if(sequence - entry.highest >= TDRS_SEQUENCE_WINDOW) {
+				memset(entry.seen, 0, sizeof(entry.seen));
+			} else {
+				for(uint64_t cleared = entry.highest + 1; cleared < sequence; cleared++) {
+					entry.seen[(cleared % TDRS_SEQUENCE_WINDOW) / 64] &= ~((uint64_t)1 << (cleared % 64));
+				}
+				entry.seen[(sequence % TDRS_SEQUENCE_WINDOW) / 64] &= ~((uint64_t)1 << (sequence % 64));
+			}
+
+			entry.highest = sequence;
+		} else if(entry.highest - sequence >= TDRS_SEQUENCE_WINDOW) {
+			_stale++;
+			return false;
+		} else if(entry.seen[(sequence % TDRS_SEQUENCE_WINDOW) / 64] & ((uint64_t)1 << (sequence % 64))) {
+			_duplicates++;
+			return false;
+		}
+
+		entry.seen[(sequence % TDRS_SEQUENCE_WINDOW) / 64] |= (uint64_t)1 << (sequence % 64);
+		entry.lastSeen = _accepted;
+
+		_accepted++;
+		return true;
+	}
+
+	/**
+	 * @brief      Returns the occupancy and counters of the window.
+	 *
+	 * @return     The stats.
+	 */
+	sequenceWindowStats HubSequenceWindow::stats() const {
+		sequenceWindowStats stats;
+
+		stats.origins = _origins.size();
+		stats.accepted = _accepted;
+		stats.duplicates = _duplicates;
+		stats.stale = _stale;
+
+		return stats;
+	}
+}
@@ -0,0 +1,397 @@
+#include "tdrs.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object.
+	 */
+	HubShmRing::HubShmRing() {
+		_header = NULL;
+		_data = NULL;
+		_mapSize = 0;
+		_mask = 0;
+		_wakeFd = -1;
+		_owner = false;
+		_broken = false;
+		_tail = 0;
+		_createdAt = 0;
+	}
+
+	/**
+	 * @brief      Destroys the object, closing the ring.
+	 */
+	HubShmRing::~HubShmRing() {
+		close();
+	}
+
+	/**
+	 * @brief      Static method checking whether a message is the handshake
+	 * a publisher asks for a ring with.
+	 *
+	 * @param[in]  message  The message
+	 *
+	 * @return     True for the handshake, false otherwise.
+	 */
+	bool HubShmRing::isHello(const zmq::message_t &message) {
+		size_t helloSize = strlen(TDRS_SHM_HELLO);
+		return message.size() == helloSize && memcmp(const_cast<zmq::message_t&>(message).data(), TDRS_SHM_HELLO, helloSize) == 0;
+	}
+
+	/**
+	 * @brief      Static method creating the wakeup FIFO publishers write to
+	 * once the hub sleeps, and opening it for the hub to poll. It is opened
+	 * for writing, too, so it never reports the last publisher closing it.
+	 *
+	 * @param[in]  path  The path
+	 *
+	 * @return     The file descriptor, -1 on failure.
+	 */
+	int HubShmRing::openWake(const std::string &path) {
+		unlink(path.c_str());
+		if(mkfifo(path.c_str(), 0600) != 0) {
+			TDRS_LOG_ERROR("Shm: Creating wakeup FIFO " << path << " failed: " << strerror(errno));
+			return -1;
+		}
+
+		int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK);
+		if(fd < 0) {
+			TDRS_LOG_ERROR("Shm: Opening wakeup FIFO " << path << " failed: " << strerror(errno));
+			unlink(path.c_str());
+		}
+
+		return fd;
+	}
+
+	/**
+	 * @brief      Static method discarding the wakeups written to the FIFO.
+	 *
+	 * @param[in]  fd    The file descriptor
+	 */
+	void HubShmRing::drainWake(int fd) {
+		char wakeups[64];
+		while(::read(fd, wakeups, sizeof(wakeups)) > 0) {
+		}
+	}
+
+	/**
+	 * @brief      Maps a ring file.
+	 *
+	 * @param[in]  fd       The file descriptor
+	 * @param[in]  mapSize  The size of the file
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool HubShmRing::_map(int fd, size_t mapSize) {
+		void *map = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if(map == MAP_FAILED) {
+			TDRS_LOG_ERROR("Shm: Mapping ring " << _path << " failed: " << strerror(errno));
+			return false;
+		}
+
+		_header = static_cast<_shmRingHeader*>(map);
+		_data = static_cast<unsigned char*>(map) + TDRS_SHM_HEADER_SIZE;
+		_mapSize = mapSize;
+		return true;
+	}
+
+	/**
+	 * @brief      Creates a ring for one publisher, as the hub.
+	 *
+	 * @param[in]  path      The path of the ring file
+	 * @param[in]  capacity  The capacity (bytes), rounded up to a power of two
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool HubShmRing::create(const std::string &path, size_t capacity) {
+		size_t rounded = TDRS_SHM_MIN_RING_SIZE;
+		while(rounded < capacity) {
+			rounded <<= 1;
+		}
+
+		_path = path;
+		int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+		if(fd < 0) {
+			TDRS_LOG_ERROR("Shm: Creating ring " << path << " failed: " << strerror(errno));
+			return false;
+		}
+
+		if(ftruncate(fd, TDRS_SHM_HEADER_SIZE + rounded) != 0) {
+			TDRS_LOG_ERROR("Shm: Sizing ring " << path << " failed: " << strerror(errno));
+			::close(fd);
+			unlink(path.c_str());
+			return false;
+		}
+
+		if(!_map(fd, TDRS_SHM_HEADER_SIZE + rounded)) {
+			unlink(path.c_str());
+			return false;
+		}
+
+		// The file is zeroed, so are the positions and flags
+		memcpy(_header->magic, TDRS_SHM_MAGIC, 4);
+		_header->version = TDRS_SHM_VERSION;
+		_header->capacity = rounded;
+		_mask = rounded - 1;
+		_owner = true;
+		_createdAt = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		return true;
+	}
+
+	/**
+	 * @brief      Attaches to a ring the hub created, as its publisher.
+	 *
+	 * @param[in]  path  The path of the ring file
+	 * @param[in]  wake  The path of the hub's wakeup FIFO
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool HubShmRing::attach(const std::string &path, const std::string &wake) {
+		_path = path;
+		int fd = ::open(path.c_str(), O_RDWR);
+		if(fd < 0) {
+			return false;
+		}
+
+		struct stat fileStat;
+		if(fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size <= TDRS_SHM_HEADER_SIZE) {
+			::close(fd);
+			return false;
+		}
+
+		if(!_map(fd, fileStat.st_size)) {
+			return false;
+		}
+
+		if(memcmp(_header->magic, TDRS_SHM_MAGIC, 4) != 0 || _header->version != TDRS_SHM_VERSION || TDRS_SHM_HEADER_SIZE + _header->capacity != _mapSize) {
+			close();
+			return false;
+		}
+
+		_mask = _header->capacity - 1;
+		_wakeFd = ::open(wake.c_str(), O_WRONLY | O_NONBLOCK);
+		if(_wakeFd < 0) {
+			close();
+			return false;
+		}
+
+		// The hub reclaims the ring once this process is gone
+		_header->publisher.store(getpid());
+		return true;
+	}
+
+	/**
+	 * @brief      Writes one event to the ring, as the publisher, waking up
+	 * the hub if it sleeps. Every event takes its size (4 bytes) and
+	 * payload, padded to 8 bytes; an event not fitting before the end of the
+	 * ring is preceded by a wrap marker and starts over at its beginning.
+	 *
+	 * @param[in]  data  The event
+	 * @param[in]  size  The size of the event
+	 *
+	 * @return     True on success, false if the ring is full.
+	 */
+	bool HubShmRing::write(const void *data, size_t size) {
+		size_t needed = (4 + size + 7) & ~(size_t)7;
+		if(needed > _header->capacity / 2) {
+			return false;
+		}
+
+		uint64_t head = _header->head.load(std::memory_order_relaxed);
+		uint64_t tail = _header->tail.load(std::memory_order_acquire);
+		size_t contiguous = _header->capacity - (head & _mask);
+		size_t skipped = (contiguous < needed ? contiguous : 0);
+
+		if(head + skipped + needed - tail > _header->capacity) {
+			return false;
+		}
+
+		if(skipped > 0) {
+			uint32_t marker = TDRS_SHM_WRAP_MARKER;
+			memcpy(_data + (head & _mask), &marker, 4);
+			head += skipped;
+		}
+
+		uint32_t eventSize = size;
+		memcpy(_data + (head & _mask), &eventSize, 4);
+		memcpy(_data + (head & _mask) + 4, data, size);
+		// Sequentially consistent, so the hub either sees the event or is woken up
+		_header->head.store(head + needed);
+
+		if(_header->sleeping.load() != 0 && _header->sleeping.exchange(0) != 0) {
+			char wakeup = 0;
+			// A full FIFO holds wakeups enough, so failing writes are fine
+			ssize_t written = ::write(_wakeFd, &wakeup, 1);
+			(void)written;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief      Reads events from the ring, as the hub, copying each into a
+	 * message of its own. A ring whose head or event sizes are out of range
+	 * is rejected, as closed, rather than read past its end.
+	 *
+	 * @param      frames  The frames vector to append to
+	 * @param[in]  max     The maximum number of events
+	 *
+	 * @return     The number of events read.
+	 */
+	size_t HubShmRing::read(std::vector<zmq::message_t> &frames, size_t max) {
+		if(_broken) {
+			return 0;
+		}
+
+		// Only the hub's own positions and capacity are trusted, the publisher may write anything to the header
+		uint64_t capacity = _mask + 1;
+		uint64_t tail = _tail;
+		uint64_t head = _header->head.load(std::memory_order_acquire);
+		size_t count = 0;
+
+		if(head < tail || head - tail > capacity) {
+			_break("head out of range");
+			return 0;
+		}
+
+		while(tail < head && count < max) {
+			uint32_t eventSize;
+			memcpy(&eventSize, _data + (tail & _mask), 4);
+			if(eventSize == TDRS_SHM_WRAP_MARKER) {
+				tail += capacity - (tail & _mask);
+				continue;
+			}
+
+			uint64_t needed = (4 + (uint64_t)eventSize + 7) & ~(uint64_t)7;
+			if(eventSize > capacity / 2 || 4 + (uint64_t)eventSize > capacity - (tail & _mask) || tail + needed > head) {
+				_break("event size out of range");
+				break;
+			}
+
+			frames.push_back(zmq::message_t(_data + (tail & _mask) + 4, eventSize));
+			tail += needed;
+			count++;
+		}
+
+		if(tail > head) {
+			_break("wrap marker out of range");
+			return count;
+		}
+
+		_tail = tail;
+		_header->tail.store(tail, std::memory_order_release);
+		return count;
+	}
+
+	/**
+	 * @brief      Rejects a ring whose publisher left it inconsistent, marking
+	 * it closed so the hub drops it.
+	 *
+	 * @param[in]  reason  The reason
+	 */
+	void HubShmRing::_break(const char *reason) {
+		TDRS_LOG_WARNING("Shm: Rejecting ring " << _path << ", " << reason << ".");
+		_broken = true;
+		_header->closed.store(1);
+	}
+
+	/**
+	 * @brief      Asks the publisher to wake up the hub with its next event,
+	 * as the hub, before it sleeps.
+	 *
+	 * @return     True if the ring is empty, false if events arrived meanwhile
+	 * and the hub must not sleep.
+	 */
+	bool HubShmRing::sleep() {
+		_header->sleeping.store(1);
+		return _broken || _header->head.load() == _tail;
+	}
+
+	/**
+	 * @brief      Returns whether the publisher closed the ring.
+	 *
+	 * @return     True if closed, false otherwise.
+	 */
+	bool HubShmRing::closed() const {
+		return _broken || _header->closed.load() != 0;
+	}
+
+	/**
+	 * @brief      Returns whether the publisher of the ring is alive, as the
+	 * hub. A publisher that has not attached yet is given some time to.
+	 *
+	 * @param[in]  now   The current monotonic time (ns)
+	 *
+	 * @return     True if alive or still attaching, false otherwise.
+	 */
+	bool HubShmRing::alive(uint64_t now) const {
+		int32_t publisher = _header->publisher.load();
+		if(publisher <= 0) {
+			return now < _createdAt + (uint64_t)TDRS_SHM_ATTACH_TIMEOUT * 1000000;
+		}
+
+		// Signal 0 only checks for the process; lacking permission to signal it, it still exists
+		return kill(publisher, 0) == 0 || errno != ESRCH;
+	}
+
+	/**
+	 * @brief      Marks the ring closed, as the hub, for a publisher that is
+	 * gone; the events it wrote are still drained.
+	 */
+	void HubShmRing::abandon() {
+		_header->closed.store(1);
+	}
+
+	/**
+	 * @brief      Returns whether the ring holds no events.
+	 *
+	 * @return     True if empty, false otherwise.
+	 */
+	bool HubShmRing::empty() const {
+		return _broken || _header->head.load(std::memory_order_acquire) == _tail;
+	}
+
+	/**
+	 * @brief      Returns the path of the ring file.
+	 *
+	 * @return     The path.
+	 */
+	const std::string &HubShmRing::path() const {
+		return _path;
+	}
+
+	/**
+	 * @brief      Closes the ring. The publisher marks it closed, so the hub
+	 * drains and removes it; the hub removes the ring file.
+	 */
+	void HubShmRing::close() {
+		if(_header == NULL) {
+			return;
+		}
+
+		if(_owner) {
+			unlink(_path.c_str());
+		} else {
+			_header->closed.store(1);
+			if(_wakeFd >= 0) {
+				char wakeup = 0;
+				ssize_t written = ::write(_wakeFd, &wakeup, 1);
+				(void)written;
+				::close(_wakeFd);
+				_wakeFd = -1;
+			}
+		}
+
+		munmap(_header, _mapSize);
+		_header = NULL;
+		_data = NULL;
+	}
+}
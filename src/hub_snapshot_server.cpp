@@ -0,0 +1,118 @@
+#include "tdrs.hpp"
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object.
+	 *
+	 * @param      params  The parameters
+	 */
+	HubSnapshotServer::HubSnapshotServer(_snapshotServerParams *params) : _zmqSnapshotSocket(*params->context, ZMQ_ROUTER) {
+		_params = params;
+	}
+
+	/**
+	 * @brief      Sends one message to the client being served, prefixed by its
+	 * routing frames, waiting for a client that cannot keep up for a while.
+	 *
+	 * @param      message  The message
+	 *
+	 * @return     True on success, false on failure.
+	 */
+	bool HubSnapshotServer::_reply(zmq::message_t &message) {
+		std::vector<zmq::message_t> frames(1);
+		frames[0].move(&message);
+		return Hub::sendRouted(_zmqSnapshotSocket, _routing, frames, _params->run);
+	}
+
+	/**
+	 * @brief      Serves one snapshot request.
+	 *
+	 * The request's last frame holds the prefix to take the snapshot of, empty
+	 * for all keys; any frames before it are routing frames and are mirrored.
+	 * The cached events follow in key order, each as one message, and an
+	 * empty message ends the snapshot.
+	 */
+	void HubSnapshotServer::_serve() {
+		std::vector<zmq::message_t> frames;
+
+		try {
+			do {
+				frames.push_back(zmq::message_t());
+				_zmqSnapshotSocket.recv(&frames.back());
+			} while(frames.back().more());
+		} catch(...) {
+			return;
+		}
+
+		std::string prefix(static_cast<const char*>(frames.back().data()), frames.back().size());
+		frames.pop_back();
+		_routing.swap(frames);
+
+		std::string cursor;
+		std::vector<std::string> payloads;
+		size_t sent = 0;
+		bool more = true;
+
+		while(more) {
+			more = _params->cache->collect(prefix, &cursor, TDRS_SNAPSHOT_BATCH_SIZE, &payloads);
+
+			BOOST_FOREACH(const std::string &payload, payloads) {
+				zmq::message_t message(payload.data(), payload.size());
+				if(!_reply(message)) {
+					TDRS_LOG_WARNING("Snapshot: Snapshot stopped after " << sent << " events.");
+					return;
+				}
+				sent++;
+			}
+		}
+
+		zmq::message_t end;
+		_reply(end);
+		TDRS_LOG_DEBUG("Snapshot: Sent " << sent << " events.");
+	}
+
+	/**
+	 * @brief      Runs the snapshot server, serving one snapshot at a time,
+	 * until it is requested to stop.
+	 */
+	void HubSnapshotServer::run() {
+		TDRS_LOG_INFO("Snapshot: Binding snapshot server at " << _params->listen << " ...");
+		int _zmqSnapshotSocketLinger = 0;
+		int _zmqSnapshotSocketTimeout = TDRS_SNAPSHOT_POLL_INTERVAL;
+		int _zmqSnapshotSocketMandatory = 1;
+		_zmqSnapshotSocket.setsockopt(ZMQ_LINGER, &_zmqSnapshotSocketLinger, sizeof(_zmqSnapshotSocketLinger));
+		_zmqSnapshotSocket.setsockopt(ZMQ_SNDTIMEO, &_zmqSnapshotSocketTimeout, sizeof(_zmqSnapshotSocketTimeout));
+		// Wait for clients that cannot keep up, for a while, instead of dropping values for them
+		_zmqSnapshotSocket.setsockopt(ZMQ_ROUTER_MANDATORY, &_zmqSnapshotSocketMandatory, sizeof(_zmqSnapshotSocketMandatory));
+		try {
+			_zmqSnapshotSocket.bind(_params->listen);
+		} catch(...) {
+			TDRS_LOG_ERROR("Snapshot: Binding snapshot server at " << _params->listen << " failed!");
+			_zmqSnapshotSocket.close();
+			return;
+		}
+		TDRS_LOG_INFO("Snapshot: Bound snapshot server.");
+
+		zmq::pollitem_t pollItems[] = {
+			{ (void *)_zmqSnapshotSocket, 0, ZMQ_POLLIN, 0 }
+		};
+
+		while(_params->run == true) {
+			try {
+				if(zmq::poll(pollItems, 1, TDRS_SNAPSHOT_POLL_INTERVAL) == 0) {
+					continue;
+				}
+			} catch(...) {
+				continue;
+			}
+
+			_serve();
+		}
+
+		_zmqSnapshotSocket.close();
+		TDRS_LOG_INFO("Snapshot: Goodbye!");
+	}
+}
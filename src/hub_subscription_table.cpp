@@ -0,0 +1,196 @@
+#include "tdrs.hpp"
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object.
+	 */
+	HubSubscriptionTable::HubSubscriptionTable() : _version(0) {
+	}
+
+	/**
+	 * @brief      Static method for encoding a hub identifier (big endian).
+	 *
+	 * @param[in]  hub   The hub identifier
+	 *
+	 * @return     The encoded identifier.
+	 */
+	std::string HubSubscriptionTable::_encodeHub(uint64_t hub) {
+		std::string encoded(8, '\0');
+
+		for(size_t index = 0; index < 8; index++) {
+			encoded[7 - index] = (char)(hub >> (8 * index));
+		}
+
+		return encoded;
+	}
+
+	/**
+	 * @brief      Static method for decoding a hub identifier (big endian).
+	 *
+	 * @param[in]  data  The encoded identifier, 8 bytes
+	 *
+	 * @return     The hub identifier.
+	 */
+	uint64_t HubSubscriptionTable::_decodeHub(const unsigned char *data) {
+		uint64_t hub = 0;
+
+		for(size_t index = 0; index < 8; index++) {
+			hub = (hub << 8) | data[index];
+		}
+
+		return hub;
+	}
+
+	/**
+	 * @brief      Static method returning the hello topic a hub tells chain
+	 * clients its identifier with.
+	 *
+	 * @param[in]  hub   The hub identifier
+	 *
+	 * @return     The topic.
+	 */
+	std::string HubSubscriptionTable::helloTopic(uint64_t hub) {
+		return std::string(TDRS_CHAIN_HELLO_TOPIC) + HubSubscriptionTable::_encodeHub(hub);
+	}
+
+	/**
+	 * @brief      Static method for parsing a hello message.
+	 *
+	 * @param[in]  data  The message data
+	 * @param[in]  size  The message size
+	 * @param      hub   The identifier of the hub that sent the hello
+	 *
+	 * @return     True if the message is a hello, false otherwise.
+	 */
+	bool HubSubscriptionTable::parseHello(const void *data, size_t size, uint64_t *hub) {
+		size_t topicSize = strlen(TDRS_CHAIN_HELLO_TOPIC);
+
+		if(size != topicSize + 8 || memcmp(data, TDRS_CHAIN_HELLO_TOPIC, topicSize) != 0) {
+			return false;
+		}
+
+		*hub = HubSubscriptionTable::_decodeHub(static_cast<const unsigned char*>(data) + topicSize);
+		return true;
+	}
+
+	/**
+	 * @brief      Static method returning the marker topic a chain client
+	 * subscribes along with each prefix, naming the hub it subscribes for.
+	 *
+	 * @param[in]  hub     The hub identifier
+	 * @param[in]  prefix  The prefix
+	 *
+	 * @return     The topic.
+	 */
+	std::string HubSubscriptionTable::viaTopic(uint64_t hub, const std::string &prefix) {
+		return std::string(TDRS_CHAIN_VIA_TOPIC) + HubSubscriptionTable::_encodeHub(hub) + prefix;
+	}
+
+	/**
+	 * @brief      Applies one subscription message, as received on the hub's
+	 * XPUB socket.
+	 *
+	 * @param[in]  data  The message data
+	 * @param[in]  size  The message size
+	 *
+	 * @return     True if the interest changed, false otherwise.
+	 */
+	bool HubSubscriptionTable::update(const void *data, size_t size) {
+		const unsigned char *bytes = static_cast<const unsigned char*>(data);
+
+		if(size < 1 || (bytes[0] != 0 && bytes[0] != 1)) {
+			return false;
+		}
+
+		bool subscribe = (bytes[0] == 1);
+		std::string topic(reinterpret_cast<const char*>(bytes + 1), size - 1);
+		std::map<std::string, size_t> *counts = &_prefixes;
+		uint64_t viaHub = 0;
+
+		size_t viaSize = strlen(TDRS_CHAIN_VIA_TOPIC);
+		if(topic.compare(0, viaSize, TDRS_CHAIN_VIA_TOPIC) == 0) {
+			if(topic.size() < viaSize + 8) {
+				return false;
+			}
+
+			viaHub = HubSubscriptionTable::_decodeHub(bytes + 1 + viaSize);
+			counts = &_viaHubs[viaHub];
+			topic.erase(0, viaSize + 8);
+		} else if(topic.compare(0, strlen(TDRS_CHAIN_CONTROL_TOPIC), TDRS_CHAIN_CONTROL_TOPIC) == 0) {
+			// Other control topics, like the hello, are no interest
+			return false;
+		}
+
+		if(subscribe) {
+			(*counts)[topic]++;
+		} else {
+			std::map<std::string, size_t>::iterator count = counts->find(topic);
+			if(count == counts->end()) {
+				if(counts != &_prefixes && counts->empty()) {
+					_viaHubs.erase(viaHub);
+				}
+				return false;
+			}
+
+			if(--count->second == 0) {
+				counts->erase(count);
+			}
+		}
+
+		if(counts != &_prefixes && counts->empty()) {
+			_viaHubs.erase(viaHub);
+		}
+
+		_version.fetch_add(1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief      Collects the prefixes somebody subscribed to, apart from
+	 * the subscriptions made on behalf of one hub.
+	 *
+	 * @param[in]  excludedHub  The hub identifier, 0 for none
+	 * @param      prefixes     The prefixes
+	 */
+	void HubSubscriptionTable::interest(uint64_t excludedHub, std::set<std::string> *prefixes) const {
+		std::map<uint64_t, std::map<std::string, size_t> >::const_iterator excluded = _viaHubs.find(excludedHub);
+
+		prefixes->clear();
+		for(std::map<std::string, size_t>::const_iterator prefix = _prefixes.begin(); prefix != _prefixes.end(); prefix++) {
+			size_t count = prefix->second;
+
+			if(excludedHub != 0 && excluded != _viaHubs.end()) {
+				std::map<std::string, size_t>::const_iterator via = excluded->second.find(prefix->first);
+				if(via != excluded->second.end()) {
+					count -= std::min(count, via->second);
+				}
+			}
+
+			if(count > 0) {
+				prefixes->insert(prefix->first);
+			}
+		}
+	}
+
+	/**
+	 * @brief      Returns the version of the table, increased on every change.
+	 * May be called without locking.
+	 *
+	 * @return     The version.
+	 */
+	uint64_t HubSubscriptionTable::version() const {
+		return _version.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * @brief      Returns the number of distinct prefixes subscribed to.
+	 *
+	 * @return     The number of prefixes.
+	 */
+	size_t HubSubscriptionTable::size() const {
+		return _prefixes.size();
+	}
+}
@@ -25,7 +25,10 @@ void signalHandler(int signalNumber) {
  */
 int main(int argc, char* argv[])
 {
+	tdrs::Logger::start();
+
 	if(hub.options(argc, argv) == false) {
+		tdrs::Logger::shutdown();
 		return -1;
 	}
 
@@ -43,6 +46,7 @@ int main(int argc, char* argv[])
 
 	// zsys_shutdown();
 
+	tdrs::Logger::shutdown();
 	std::cout << "Quit." << std::endl;
 	return 0;
 }
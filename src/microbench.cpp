@@ -0,0 +1,340 @@
+#include "microbench.hpp"
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Constructs the object, registering all microbenchmarks.
+	 *
+	 * @param[in]  filter   Regex microbenchmark names have to match to be run
+	 * @param[in]  minTime  Time (ms) each microbenchmark runs for, at least
+	 */
+	Microbench::Microbench(const std::string &filter, uint64_t minTime) : _filter(filter) {
+		_minTime = minTime;
+
+		std::vector<int64_t> sizes = { 64, 1024, 16384, 262144 };
+		std::vector<int64_t> occupancies = { 1000, 100000, 1000000 };
+		std::vector<int64_t> none = { 0 };
+
+		_register("hashString", &Microbench::_hashString, sizes);
+		_register("fingerprintData/sha1", &Microbench::_fingerprintSha1, sizes);
+		_register("fingerprintData/xxh3", &Microbench::_fingerprintXxh3, sizes);
+		_register("parseControl", &Microbench::_parseControl, none);
+		_register("parseZeroAddress", &Microbench::_parseZeroAddress, none);
+		_register("rewriteReceiver", &Microbench::_rewriteReceiver, none);
+		_register("dedupConsume", &Microbench::_dedupConsume, occupancies);
+		_register("dedupMiss", &Microbench::_dedupMiss, occupancies);
+		_register("sequenceWindowAccept", &Microbench::_sequenceWindowAccept, { 1, 16, 256 });
+		_register("lastValueUpdate", &Microbench::_lastValueUpdate, occupancies);
+	}
+
+	/**
+	 * @brief      Static method returning the current monotonic time.
+	 *
+	 * @return     The time (ns).
+	 */
+	uint64_t Microbench::_now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	 * @brief      Static method restarting the timer of a run, for
+	 * microbenchmarks to exclude their setup.
+	 *
+	 * @param      state  The state
+	 */
+	void Microbench::_resetTimer(microbenchState *state) {
+		state->startedAt = Microbench::_now();
+	}
+
+	/**
+	 * @brief      Static method returning a payload of the given size.
+	 *
+	 * @param[in]  size  The size
+	 *
+	 * @return     The payload.
+	 */
+	std::string Microbench::_payload(size_t size) {
+		std::string payload(size, 'x');
+		for(size_t index = 0; index < size; index++) {
+			payload[index] = 'a' + (index * 7) % 26;
+		}
+
+		return payload;
+	}
+
+	/**
+	 * @brief      Registers a microbenchmark.
+	 *
+	 * @param[in]  name       The name
+	 * @param[in]  function   The function
+	 * @param[in]  arguments  The arguments it is run with
+	 */
+	void Microbench::_register(const std::string &name, void (*function)(microbenchState *state), const std::vector<int64_t> &arguments) {
+		microbench bench;
+		bench.name = name;
+		bench.function = function;
+		bench.arguments = arguments;
+		_microbenchs.push_back(bench);
+	}
+
+	/**
+	 * @brief      Runs one microbenchmark with one argument, raising the number
+	 * of iterations until it runs long enough, and prints its result.
+	 *
+	 * @param[in]  bench     The microbenchmark
+	 * @param[in]  argument  The argument
+	 */
+	void Microbench::_run(const microbench &bench, int64_t argument) {
+		std::string name = bench.name + (bench.arguments.size() > 1 ? "/" + std::to_string(argument) : "");
+		uint64_t minTime = _minTime * 1000000;
+		uint64_t iterations = 1;
+		uint64_t elapsed = 0;
+		microbenchState state;
+
+		while(true) {
+			state.argument = argument;
+			state.iterations = iterations;
+			state.bytes = 0;
+			Microbench::_resetTimer(&state);
+			bench.function(&state);
+			elapsed = Microbench::_now() - state.startedAt;
+
+			if(elapsed >= minTime || iterations >= TDRS_MICROBENCH_MAX_ITERATIONS) {
+				break;
+			}
+
+			// Aim a bit beyond the minimum time, growing by at most 10x per run
+			uint64_t next = (elapsed > 0 ? (uint64_t)(iterations * 1.4 * minTime / elapsed) : iterations * 10);
+			iterations = std::min(std::max(next, iterations + 1), std::min(iterations * 10, (uint64_t)TDRS_MICROBENCH_MAX_ITERATIONS));
+		}
+
+		std::cout << std::left << std::setw(36) << name << std::right
+			<< std::setw(14) << std::fixed << std::setprecision(1) << (double)elapsed / iterations << " ns"
+			<< std::setw(14) << iterations;
+
+		if(state.bytes > 0) {
+			std::cout << std::setw(14) << std::setprecision(1) << state.bytes / (elapsed / 1000000000.0) / (1024 * 1024) << " MB/s";
+		}
+
+		std::cout << std::endl;
+	}
+
+	/**
+	 * @brief      Hashes a payload of the argument's size with SHA1, the way
+	 * every received event is.
+	 *
+	 * @param      state  The state
+	 */
+	void Microbench::_hashString(microbenchState *state) {
+		std::string payload = Microbench::_payload(state->argument);
+
+		Microbench::_resetTimer(state);
+		for(uint64_t iteration = 0; iteration < state->iterations; iteration++) {
+			Microbench::_keep(Hub::hashString(&payload));
+		}
+		state->bytes = state->iterations * payload.size();
+	}
+
+	/**
+	 * @brief      Fingerprints a payload of the argument's size with SHA1.
+	 *
+	 * @param      state  The state
+	 */
+	void Microbench::_fingerprintSha1(microbenchState *state) {
+		std::string payload = Microbench::_payload(state->argument);
+
+		Microbench::_resetTimer(state);
+		for(uint64_t iteration = 0; iteration < state->iterations; iteration++) {
+			Microbench::_keep(Hub::fingerprintData(payload.data(), payload.size(), TDRS_FINGERPRINT_SHA1));
+		}
+		state->bytes = state->iterations * payload.size();
+	}
+
+	/**
+	 * @brief      Fingerprints a payload of the argument's size with XXH3.
+	 *
+	 * @param      state  The state
+	 */
+	void Microbench::_fingerprintXxh3(microbenchState *state) {
+		std::string payload = Microbench::_payload(state->argument);
+
+		Microbench::_resetTimer(state);
+		for(uint64_t iteration = 0; iteration < state->iterations; iteration++) {
+			Microbench::_keep(Hub::fingerprintData(payload.data(), payload.size(), TDRS_FINGERPRINT_XXH3));
+		}
+		state->bytes = state->iterations * payload.size();
+	}
+
+	/**
+	 * @brief      Parses a peer announcement control message.
+	 *
+	 * @param      state  The state
+	 */
+	void Microbench::_parseControl(microbenchState *state) {
+		peerMessage peer;
+		peer.event = TDRS_CONTROL_PEER_ENTER;
+		peer.id = "3F2A9C0B71D84E6A9F1C2B3D4E5F6A7B";
+		peer.publisher = "tcp://127.0.0.1:19891";
+		peer.receiver = "tcp://127.0.0.1:19890";
+
+		zmq::message_t message;
+		Hub::buildControl(peer, &message);
+
+		Microbench::_resetTimer(state);
+		for(uint64_t iteration = 0; iteration < state->iterations; iteration++) {
+			Microbench::_keep(Hub::parseControl(message, &peer));
+		}
+	}
+
+	/**
+	 * @brief      Parses a ZeroMQ address.
+	 *
+	 * @param      state  The state
+	 */
+	void Microbench::_parseZeroAddress(microbenchState *state) {
+		std::string address = "tcp://127.0.0.1:19890";
+
+		Microbench::_resetTimer(state);
+		for(uint64_t iteration = 0; iteration < state->iterations; iteration++) {
+			zeroAddress *za = Hub::parseZeroAddress(address);
+			Microbench::_keep(za);
+			delete za;
+		}
+	}
+
+	/**
+	 * @brief      Rewrites a wildcard receiver address.
+	 *
+	 * @param      state  The state
+	 */
+	void Microbench::_rewriteReceiver(microbenchState *state) {
+		// Never destroyed, so its context cannot hold up the exit
+		static Hub *hub = new Hub(1);
+		hub->_optionReceiverListen = "tcp://*:19890";
+
+		Microbench::_resetTimer(state);
+		for(uint64_t iteration = 0; iteration < state->iterations; iteration++) {
+			Microbench::_keep(hub->_rewriteReceiver(&hub->_optionReceiverListen));
+		}
+	}
+
+	/**
+	 * @brief      Consumes and re-inserts expected events in a dedup index
+	 * holding the argument's number of entries, the way a chain link matches
+	 * an event coming back.
+	 *
+	 * @param      state  The state
+	 */
+	void Microbench::_dedupConsume(microbenchState *state) {
+		HubDedupIndex index;
+		std::vector<std::string> fingerprints;
+
+		index.configure(state->argument, SIZE_MAX, UINT64_MAX / 2);
+		for(int64_t entry = 0; entry < state->argument; entry++) {
+			fingerprints.push_back(Hub::fingerprintData(&entry, sizeof(entry), TDRS_FINGERPRINT_XXH3));
+			index.insert(fingerprints.back(), 0);
+		}
+
+		Microbench::_resetTimer(state);
+		for(uint64_t iteration = 0; iteration < state->iterations; iteration++) {
+			const std::string &fingerprint = fingerprints[iteration % fingerprints.size()];
+			Microbench::_keep(index.consume(fingerprint, 0));
+			index.insert(fingerprint, 0);
+		}
+	}
+
+	/**
+	 * @brief      Looks up unexpected events in a dedup index holding the
+	 * argument's number of entries.
+	 *
+	 * @param      state  The state
+	 */
+	void Microbench::_dedupMiss(microbenchState *state) {
+		HubDedupIndex index;
+		std::vector<std::string> fingerprints;
+
+		index.configure(state->argument, SIZE_MAX, UINT64_MAX / 2);
+		for(int64_t entry = 0; entry < state->argument; entry++) {
+			index.insert(Hub::fingerprintData(&entry, sizeof(entry), TDRS_FINGERPRINT_XXH3), 0);
+			int64_t missing = -entry - 1;
+			fingerprints.push_back(Hub::fingerprintData(&missing, sizeof(missing), TDRS_FINGERPRINT_XXH3));
+		}
+
+		Microbench::_resetTimer(state);
+		for(uint64_t iteration = 0; iteration < state->iterations; iteration++) {
+			Microbench::_keep(index.consume(fingerprints[iteration % fingerprints.size()], 0));
+		}
+	}
+
+	/**
+	 * @brief      Accepts enveloped events of the argument's number of origins
+	 * into a sequence window.
+	 *
+	 * @param      state  The state
+	 */
+	void Microbench::_sequenceWindowAccept(microbenchState *state) {
+		HubSequenceWindow window;
+		uint64_t origins = state->argument;
+
+		Microbench::_resetTimer(state);
+		for(uint64_t iteration = 0; iteration < state->iterations; iteration++) {
+			Microbench::_keep(window.accept(iteration % origins + 1, iteration / origins + 1));
+		}
+	}
+
+	/**
+	 * @brief      Updates keys of a last-value cache holding the argument's
+	 * number of keys, the way every published event does.
+	 *
+	 * @param      state  The state
+	 */
+	void Microbench::_lastValueUpdate(microbenchState *state) {
+		HubLastValueCache cache;
+		std::vector<std::string> payloads;
+
+		cache.configure(SIZE_MAX, TDRS_CACHE_DEFAULT_DELIMITER);
+		for(int64_t key = 0; key < state->argument; key++) {
+			payloads.push_back("sensors." + std::to_string(key) + " " + Microbench::_payload(64));
+			cache.update(payloads.back().data(), payloads.back().size());
+		}
+
+		Microbench::_resetTimer(state);
+		for(uint64_t iteration = 0; iteration < state->iterations; iteration++) {
+			const std::string &payload = payloads[iteration % payloads.size()];
+			Microbench::_keep(cache.update(payload.data(), payload.size()));
+		}
+		state->bytes = state->iterations * payloads[0].size();
+	}
+
+	/**
+	 * @brief      Lists the names of all microbenchmarks.
+	 */
+	void Microbench::list() {
+		BOOST_FOREACH(const microbench &bench, _microbenchs) {
+			BOOST_FOREACH(int64_t argument, bench.arguments) {
+				std::cout << bench.name << (bench.arguments.size() > 1 ? "/" + std::to_string(argument) : "") << std::endl;
+			}
+		}
+	}
+
+	/**
+	 * @brief      Runs all microbenchmarks matching the filter and prints their
+	 * results.
+	 */
+	void Microbench::run() {
+		std::cout << std::left << std::setw(36) << "Benchmark" << std::right
+			<< std::setw(17) << "Time" << std::setw(14) << "Iterations" << std::setw(19) << "Throughput" << std::endl;
+		std::cout << std::string(86, '-') << std::endl;
+
+		BOOST_FOREACH(const microbench &bench, _microbenchs) {
+			BOOST_FOREACH(int64_t argument, bench.arguments) {
+				std::string name = bench.name + (bench.arguments.size() > 1 ? "/" + std::to_string(argument) : "");
+				if(std::regex_search(name, _filter)) {
+					_run(bench, argument);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,140 @@
+#include "tdrs.hpp"
+#include <iomanip>
+
+/**
+ * Time (ms) each microbenchmark runs for, at least.
+ */
+#define TDRS_MICROBENCH_DEFAULT_MIN_TIME 500
+/**
+ * Maximum number of iterations of a microbenchmark run.
+ */
+#define TDRS_MICROBENCH_MAX_ITERATIONS 1000000000
+
+/**
+ * tdrs namespace.
+ */
+namespace tdrs {
+	/**
+	 * @brief      Microbenchmark state, handed to every run of a
+	 * microbenchmark.
+	 */
+	struct microbenchState {
+		int64_t argument;
+		uint64_t iterations;
+		uint64_t bytes;
+		uint64_t startedAt;
+	};
+
+	/**
+	 * @brief      Microbenchmark, a function measured once per argument.
+	 */
+	struct microbench {
+		std::string name;
+		void (*function)(microbenchState *state);
+		std::vector<int64_t> arguments;
+	};
+
+	/**
+	 * @brief      Class for Microbench, measuring the hub's per-event
+	 * primitives in the style of Google Benchmark.
+	 */
+	class Microbench {
+		private:
+			/**
+			 * The registered microbenchmarks.
+			 */
+			std::vector<microbench> _microbenchs;
+			/**
+			 * Regex microbenchmark names have to match to be run.
+			 */
+			std::regex _filter;
+			/**
+			 * Time (ms) each microbenchmark runs for, at least.
+			 */
+			uint64_t _minTime;
+
+			/**
+			 * @brief      Static method keeping the compiler from optimizing a
+			 * value away.
+			 *
+			 * @param[in]  value  The value
+			 */
+			template <typename T>
+			static void _keep(const T &value) {
+				asm volatile("" : : "m"(value) : "memory");
+			}
+			/**
+			 * @brief      Static method returning the current monotonic time.
+			 *
+			 * @return     The time (ns).
+			 */
+			static uint64_t _now();
+			/**
+			 * @brief      Static method restarting the timer of a run, for
+			 * microbenchmarks to exclude their setup.
+			 *
+			 * @param      state  The state
+			 */
+			static void _resetTimer(microbenchState *state);
+			/**
+			 * @brief      Static method returning a payload of the given size.
+			 *
+			 * @param[in]  size  The size
+			 *
+			 * @return     The payload.
+			 */
+			static std::string _payload(size_t size);
+			/**
+			 * @brief      Registers a microbenchmark.
+			 *
+			 * @param[in]  name       The name
+			 * @param[in]  function   The function
+			 * @param[in]  arguments  The arguments it is run with
+			 */
+			void _register(const std::string &name, void (*function)(microbenchState *state), const std::vector<int64_t> &arguments);
+			/**
+			 * @brief      Runs one microbenchmark with one argument, raising the
+			 * number of iterations until it runs long enough, and prints its
+			 * result.
+			 *
+			 * @param[in]  bench     The microbenchmark
+			 * @param[in]  argument  The argument
+			 */
+			void _run(const microbench &bench, int64_t argument);
+
+			/**
+			 * @brief      The microbenchmarks; static methods, the argument is
+			 * the payload size or the dedup index or cache occupancy.
+			 *
+			 * @param      state  The state
+			 */
+			static void _hashString(microbenchState *state);
+			static void _fingerprintSha1(microbenchState *state);
+			static void _fingerprintXxh3(microbenchState *state);
+			static void _parseControl(microbenchState *state);
+			static void _parseZeroAddress(microbenchState *state);
+			static void _rewriteReceiver(microbenchState *state);
+			static void _dedupConsume(microbenchState *state);
+			static void _dedupMiss(microbenchState *state);
+			static void _sequenceWindowAccept(microbenchState *state);
+			static void _lastValueUpdate(microbenchState *state);
+		public:
+			/**
+			 * @brief      Constructs the object, registering all microbenchmarks.
+			 *
+			 * @param[in]  filter   Regex microbenchmark names have to match to be run
+			 * @param[in]  minTime  Time (ms) each microbenchmark runs for, at least
+			 */
+			Microbench(const std::string &filter, uint64_t minTime);
+
+			/**
+			 * @brief      Lists the names of all microbenchmarks.
+			 */
+			void list();
+			/**
+			 * @brief      Runs all microbenchmarks matching the filter and prints
+			 * their results.
+			 */
+			void run();
+	};
+}
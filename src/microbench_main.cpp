@@ -0,0 +1,47 @@
+#include "microbench.hpp"
+
+/**
+ * @brief      Program entrypoint.
+ *
+ * @return     0 on success, -1 on failure
+ */
+int main(int argc, char* argv[])
+{
+	try {
+		bpo::options_description optionsDescription("Options:");
+		optionsDescription.add_options()
+			("help", "show this usage information")
+			("filter", bpo::value<std::string>(), "only run the microbenchmarks whose names match this regex, e.g. 'dedup'")
+			("min-time", bpo::value<uint64_t>(), "set the time (ms) each microbenchmark runs for, at least, default 500")
+			("list", "list the microbenchmarks instead of running them")
+		;
+
+		bpo::variables_map variablesMap;
+		bpo::store(bpo::parse_command_line(argc, argv, optionsDescription), variablesMap);
+		bpo::notify(variablesMap);
+
+		if(variablesMap.count("help")) {
+			std::cout << optionsDescription << std::endl;
+			return -1;
+		}
+
+		tdrs::Microbench microbench(
+			(variablesMap.count("filter") ? variablesMap["filter"].as<std::string>() : ""),
+			(variablesMap.count("min-time") ? variablesMap["min-time"].as<uint64_t>() : TDRS_MICROBENCH_DEFAULT_MIN_TIME)
+		);
+
+		if(variablesMap.count("list")) {
+			microbench.list();
+		} else {
+			microbench.run();
+		}
+	} catch(bpo::error &exception) {
+		std::cerr << "tdrs-microbench: Error, " << exception.what() << std::endl;
+		return -1;
+	} catch(std::regex_error &exception) {
+		std::cerr << "tdrs-microbench: Error, invalid filter, " << exception.what() << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -1,76 +1,2152 @@
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <chrono>
+#include <deque>
 #include <iterator>
+#include <list>
+#include <map>
+#include <random>
 #include <string>
 #include <regex>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include <stdint.h>
 #include <unistd.h>
 #include <signal.h>
 #include <pthread.h>
 #include <zmq.hpp>
-#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/program_options.hpp>
 #include <cryptopp/sha.h>
 #include <cryptopp/filters.h>
 #include <cryptopp/hex.h>
+#include <xxhash.h>
+#include <lz4.h>
+#include <zstd.h>
 #include <zyrecpp.hpp>
 
 namespace bpo = boost::program_options;
 
+#define TDRS_LOG_LEVEL_ERROR 0
+#define TDRS_LOG_LEVEL_WARNING 1
+#define TDRS_LOG_LEVEL_INFO 2
+#define TDRS_LOG_LEVEL_DEBUG 3
+
+/**
+ * Highest log level compiled in; lines above it cost nothing at runtime.
+ */
+#ifndef TDRS_LOG_MAX_LEVEL
+#define TDRS_LOG_MAX_LEVEL TDRS_LOG_LEVEL_DEBUG
+#endif
+
+/**
+ * Lines buffered per thread until the writer catches up.
+ */
+#define TDRS_LOG_BUFFER_LINES 8192
+/**
+ * Maximum size of a log line (bytes); longer lines are cut off.
+ */
+#define TDRS_LOG_LINE_SIZE 1024
+/**
+ * Time the writer sleeps when there is nothing to write (us).
+ */
+#define TDRS_LOG_WRITER_IDLE_USEC 2000
+
+/**
+ * Default maximum number of entries of the dedup index.
+ */
+#define TDRS_DEDUP_DEFAULT_MAX_ENTRIES 1000000
+/**
+ * Default maximum memory (bytes) used by the dedup index.
+ */
+#define TDRS_DEDUP_DEFAULT_MAX_BYTES (256 * 1024 * 1024)
+/**
+ * Default time (ms) after which unmatched dedup index entries expire.
+ */
+#define TDRS_DEDUP_DEFAULT_TTL 60000
+/**
+ * Size of a dedup index key's fingerprint: a binary SHA1 digest, or an XXH3
+ * 128 bit digest padded with zeros.
+ */
+#define TDRS_DEDUP_KEY_SIZE 20
+
+/**
+ * Chain envelope frame: magic, version, hops, reserved (2 bytes), origin
+ * hub identifier, sequence number, relay and previous relay hub identifiers
+ * (8 bytes each, big endian).
+ */
+#define TDRS_ENVELOPE_MAGIC "\xFFTDE"
+#define TDRS_ENVELOPE_VERSION 2
+#define TDRS_ENVELOPE_SIZE 40
+/**
+ * Control message frame: magic, version, type, reserved (2 bytes), followed
+ * by the peer identifier, publisher and receiver address, overlay key and
+ * partition proxy address, each prefixed by its length (2 bytes, big endian).
+ */
+#define TDRS_CONTROL_MAGIC "\xFFTDC"
+#define TDRS_CONTROL_VERSION 4
+#define TDRS_CONTROL_HEADER_SIZE 8
+#define TDRS_CONTROL_PEER_ENTER 1
+#define TDRS_CONTROL_PEER_EXIT 2
+/**
+ * Overlay topologies of hubs linked by discovery.
+ */
+#define TDRS_OVERLAY_MESH 0
+#define TDRS_OVERLAY_TREE 1
+#define TDRS_OVERLAY_SUPER_PEER 2
+/**
+ * Default number of children per hub with the tree topology, and of
+ * super-peers with the super-peer topology.
+ */
+#define TDRS_OVERLAY_DEFAULT_FANOUT 4
+#define TDRS_OVERLAY_DEFAULT_SUPER_PEERS 3
+/**
+ * Highest level of a hub in the tree topology.
+ */
+#define TDRS_OVERLAY_MAX_LEVEL 16
+/**
+ * Default character ending the topic of an event, in partitioned mode.
+ */
+#define TDRS_PARTITION_DEFAULT_DELIMITER ' '
+/**
+ * Number of positions every hub takes on the partition ring.
+ */
+#define TDRS_PARTITION_VIRTUAL_NODES 128
+/**
+ * Number of discovery intervals after a change of the partition ring in
+ * which events on the receiver are published rather than redirected.
+ */
+#define TDRS_PARTITION_SETTLE_INTERVALS 3
+/**
+ * Handshake a co-located publisher sends to the shared-memory endpoint for a
+ * ring.
+ */
+#define TDRS_SHM_HELLO "\xFFTDRS-SHM"
+/**
+ * Name of the shared-memory endpoint in --shm-dir, unless --shm-listen is
+ * set.
+ */
+#define TDRS_SHM_DEFAULT_LISTEN_NAME "tdrs.hello"
+/**
+ * Magic and layout version of the ring files.
+ */
+#define TDRS_SHM_MAGIC "TDSR"
+#define TDRS_SHM_VERSION 2
+/**
+ * Size of the ring header, keeping positions and flags on cache lines of
+ * their own.
+ */
+#define TDRS_SHM_HEADER_SIZE 256
+/**
+ * Event size marking the rest of the ring as skipped.
+ */
+#define TDRS_SHM_WRAP_MARKER 0xFFFFFFFF
+/**
+ * Smallest and default ring size, in bytes.
+ */
+#define TDRS_SHM_MIN_RING_SIZE 4096
+#define TDRS_SHM_DEFAULT_RING_SIZE (4 * 1024 * 1024)
+/**
+ * Maximum number of rings, and of events taken from one ring per run-loop
+ * iteration.
+ */
+#define TDRS_SHM_MAX_RINGS 256
+#define TDRS_SHM_DRAIN_BATCH 256
+/**
+ * Interval (ms) in which the hub checks that the publishers of its rings
+ * are alive, and time (ms) a publisher gets to attach to its ring.
+ */
+#define TDRS_SHM_LIVENESS_INTERVAL 1000
+#define TDRS_SHM_ATTACH_TIMEOUT 5000
+/**
+ * Default maximum number of times an event is relayed between hubs.
+ */
+#define TDRS_CHAIN_DEFAULT_MAX_HOPS 16
+/**
+ * Number of sequence numbers tracked per origin, a multiple of 64.
+ */
+#define TDRS_SEQUENCE_WINDOW 1024
+/**
+ * Maximum number of origins tracked by the sequence window.
+ */
+#define TDRS_SEQUENCE_WINDOW_MAX_ORIGINS 4096
+
+/**
+ * Control topics between chained hubs: the hello a hub publishes once a
+ * chain client subscribes to it, followed by its identifier, and the marker a chain client
+ * subscribes along with each prefix, followed by the identifier of the hub
+ * it subscribes for and the prefix.
+ */
+#define TDRS_CHAIN_CONTROL_TOPIC "\xFFTDRS-"
+#define TDRS_CHAIN_HELLO_TOPIC "\xFFTDRS-HELLO"
+#define TDRS_CHAIN_VIA_TOPIC "\xFFTDRS-VIA"
+/**
+ * Heartbeat a hub with --chain-heartbeat-interval publishes to its chain
+ * clients.
+ */
+#define TDRS_CHAIN_HEARTBEAT_TOPIC "\xFFTDRS-BEAT"
+/**
+ * Number of heartbeat intervals a chain link may stay silent before it is
+ * suspected, and by default before it is taken down.
+ */
+#define TDRS_CHAIN_HEARTBEAT_SUSPECT_INTERVALS 2
+#define TDRS_CHAIN_HEARTBEAT_DEFAULT_INTERVALS 3
+/**
+ * Default maximum delay (ms) between the reconnects of a chain link that is
+ * down; the delay starts at the heartbeat interval and doubles every time.
+ */
+#define TDRS_CHAIN_DEFAULT_RECONNECT_MAX 5000
+/**
+ * Chain link states.
+ */
+#define TDRS_CHAIN_LINK_UP 0
+#define TDRS_CHAIN_LINK_SUSPECT 1
+#define TDRS_CHAIN_LINK_DOWN 2
+/**
+ * Interval (ms) in which chain clients check for changed subscriptions and
+ * for being shut down.
+ */
+#define TDRS_CHAIN_POLL_INTERVAL 100
+/**
+ * Initial delay (ms) between the attempts of a chain client to hand its
+ * pending event to a backed up hub, doubled up to TDRS_CHAIN_POLL_INTERVAL.
+ */
+#define TDRS_CHAIN_SEND_BACKOFF 1
+/**
+ * Endpoint chain clients hand received events to the hub at.
+ */
+#define TDRS_CHAIN_ENDPOINT "inproc://tdrs-chain"
+/**
+ * Endpoint the hub registers chain links with the chain reactor at.
+ */
+#define TDRS_CHAIN_REACTOR_ENDPOINT "inproc://tdrs-chain-reactor"
+/**
+ * Topic a batched chain client subscribes with at the chain batch listener,
+ * followed by the codec (1 byte), the batch size (bytes) and the flush window
+ * (us) (4 bytes each, big endian) it asks for.
+ */
+#define TDRS_CHAIN_BATCH_TOPIC "\xFFTDRS-BATCH"
+/**
+ * Chain batch frame: magic, version, codec, reserved (2 bytes), number of
+ * events and their size uncompressed (4 bytes each, big endian), followed by
+ * the events as compressed by the codec. Each event is prefixed by its size
+ * and the size of its envelope, 0 for none (4 bytes each, big endian), the
+ * envelope following the event.
+ */
+#define TDRS_CHAIN_BATCH_MAGIC "\xFFTDB"
+#define TDRS_CHAIN_BATCH_VERSION 1
+#define TDRS_CHAIN_BATCH_HEADER_SIZE 16
+#define TDRS_CHAIN_BATCH_RECORD_HEADER_SIZE 8
+/**
+ * Codecs compressing chain batches.
+ */
+#define TDRS_CHAIN_BATCH_CODEC_NONE 0
+#define TDRS_CHAIN_BATCH_CODEC_LZ4 1
+#define TDRS_CHAIN_BATCH_CODEC_ZSTD 2
+/**
+ * Defaults of batched chain links: codec, size (bytes) a batch is flushed
+ * at and time (us) a batch is flushed after, at the latest.
+ */
+#define TDRS_CHAIN_BATCH_DEFAULT_CODEC TDRS_CHAIN_BATCH_CODEC_LZ4
+#define TDRS_CHAIN_BATCH_DEFAULT_SIZE 65536
+#define TDRS_CHAIN_BATCH_DEFAULT_WINDOW 1000
+/**
+ * Maximum batch size (bytes) a link may ask for, and maximum size (bytes) of
+ * a batch uncompressed accepted by chain clients.
+ */
+#define TDRS_CHAIN_BATCH_MAX_SIZE (16 * 1024 * 1024)
+#define TDRS_CHAIN_BATCH_MAX_DECODED_SIZE (256 * 1024 * 1024)
+/**
+ * Compression level of the zstd codec.
+ */
+#define TDRS_CHAIN_BATCH_ZSTD_LEVEL 3
+/**
+ * Endpoint the discovery service listener hands peer announcements to the
+ * hub at, apart from the events.
+ */
+#define TDRS_CONTROL_ENDPOINT "inproc://tdrs-control"
+/**
+ * Time (ms) a peer announcement may take to reach the hub once its socket
+ * is closed.
+ */
+#define TDRS_CONTROL_LINGER 1000
+
+/**
+ * Fingerprints identifying events in the dedup index.
+ */
+#define TDRS_FINGERPRINT_SHA1 0
+#define TDRS_FINGERPRINT_XXH3 1
+
+/**
+ * Default high-water mark (messages) of the hub's sockets, libzmq's own default.
+ */
+#define TDRS_DEFAULT_HWM 1000
+/**
+ * Default maximum number of events waiting in the publisher backlog.
+ */
+#define TDRS_PUBLISHER_DEFAULT_BACKLOG 10000
+/**
+ * Interval (ms) in which a backlogged publisher is retried.
+ */
+#define TDRS_PUBLISHER_RETRY_INTERVAL 1
+/**
+ * Overflow policies of the publisher. Lossy leaves slow subscribers to
+ * libzmq, which drops their newest events silently; the others make the
+ * publisher wait for the slowest subscriber, using a backlog that drops
+ * either the newest or the oldest events once full.
+ */
+#define TDRS_OVERFLOW_LOSSY 0
+#define TDRS_OVERFLOW_DROP_NEWEST 1
+#define TDRS_OVERFLOW_DROP_OLDEST 2
+
+/**
+ * Default size (bytes) of a journal segment.
+ */
+#define TDRS_JOURNAL_DEFAULT_SEGMENT_SIZE (64 * 1024 * 1024)
+/**
+ * Default maximum size (bytes) of all journal segments, 0 for unlimited.
+ */
+#define TDRS_JOURNAL_DEFAULT_RETENTION_SIZE (1024ULL * 1024 * 1024)
+/**
+ * Default maximum age (s) of closed journal segments, 0 for unlimited.
+ */
+#define TDRS_JOURNAL_DEFAULT_RETENTION_AGE 0
+/**
+ * Default interval (ms) in which the journal is synced to disk, 0 for after
+ * every published batch of events.
+ */
+#define TDRS_JOURNAL_DEFAULT_FSYNC_INTERVAL 1000
+/**
+ * Interval (ms) in which the run-loop maintains the journal when idle, and
+ * in which the journal checks its retention.
+ */
+#define TDRS_JOURNAL_MAINTAIN_INTERVAL 100
+#define TDRS_JOURNAL_RETENTION_INTERVAL 1000
+/**
+ * Journal record header: record size, envelope size (4 bytes each), offset
+ * and journaling time (ms since epoch, 8 bytes each), in host byte order.
+ * The payload and the envelope follow. The record size is written last, so
+ * that a record torn by a crash is never read.
+ */
+#define TDRS_JOURNAL_RECORD_HEADER_SIZE 24
+/**
+ * File name suffix of journal segments, named after their first offset.
+ */
+#define TDRS_JOURNAL_SEGMENT_SUFFIX ".journal"
+/**
+ * Offset frame, following every event published with --journal-dir: magic
+ * and journal offset (8 bytes, big endian).
+ */
+#define TDRS_OFFSET_MAGIC "\xFFTDO"
+#define TDRS_OFFSET_SIZE 12
+/**
+ * Interval (ms) in which the replay server checks for being shut down.
+ */
+#define TDRS_REPLAY_POLL_INTERVAL 100
+/**
+ * Number of send timeouts the replay and snapshot servers wait for a client
+ * that cannot keep up, before giving up on it.
+ */
+#define TDRS_ROUTER_SEND_RETRIES 50
+/**
+ * Default delimiter ending the key of an event in the last-value cache, and
+ * maximum size (bytes) of a key; events without a key are not cached.
+ */
+#define TDRS_CACHE_DEFAULT_DELIMITER ' '
+#define TDRS_CACHE_MAX_KEY_SIZE 256
+/**
+ * Bookkeeping (bytes) per cached value, counted against the cache size.
+ */
+#define TDRS_CACHE_ENTRY_OVERHEAD 128
+/**
+ * Number of cached values the snapshot server copies per lock of the cache.
+ */
+#define TDRS_SNAPSHOT_BATCH_SIZE 256
+/**
+ * Interval (ms) in which the snapshot server checks for being shut down.
+ */
+#define TDRS_SNAPSHOT_POLL_INTERVAL 100
+
+/**
+ * Histogram buckets per power of two (as bits); 4 keeps values accurate to
+ * about 6%.
+ */
+#define TDRS_HISTOGRAM_SUB_BUCKET_BITS 4
+#define TDRS_HISTOGRAM_BUCKETS ((64 - TDRS_HISTOGRAM_SUB_BUCKET_BITS + 1) << TDRS_HISTOGRAM_SUB_BUCKET_BITS)
+
+#define TDRS_LOG(logLevel, expression) \
+	do { \
+		if((logLevel) <= TDRS_LOG_MAX_LEVEL && (logLevel) <= tdrs::Logger::level.load(std::memory_order_relaxed)) { \
+			tdrs::Logger::stream() << expression; \
+			tdrs::Logger::commit(); \
+		} \
+	} while(0)
+
+#define TDRS_LOG_ERROR(expression) TDRS_LOG(TDRS_LOG_LEVEL_ERROR, expression)
+#define TDRS_LOG_WARNING(expression) TDRS_LOG(TDRS_LOG_LEVEL_WARNING, expression)
+#define TDRS_LOG_INFO(expression) TDRS_LOG(TDRS_LOG_LEVEL_INFO, expression)
+#define TDRS_LOG_DEBUG(expression) TDRS_LOG(TDRS_LOG_LEVEL_DEBUG, expression)
+
 /**
  * tdrs namespace
  */
 namespace tdrs {
+	/**
+	 * @brief      Raw bytes to be written to a log line as they are.
+	 */
+	struct logBytes {
+		const char *data;
+		size_t size;
+
+		logBytes(const void *bytesData, size_t bytesSize) : data(static_cast<const char*>(bytesData)), size(bytesSize) {}
+	};
+
+	inline std::ostream &operator<<(std::ostream &stream, const logBytes &bytes) {
+		return stream.write(bytes.data, bytes.size);
+	}
+
+	/**
+	 * @brief      Binary bytes to be written to a log line hex encoded.
+	 */
+	struct logHex {
+		const unsigned char *data;
+		size_t size;
+
+		logHex(const std::string &bytes) : data(reinterpret_cast<const unsigned char*>(bytes.data())), size(bytes.size()) {}
+	};
+
+	inline std::ostream &operator<<(std::ostream &stream, const logHex &bytes) {
+		static const char hexDigits[] = "0123456789ABCDEF";
+
+		for(size_t index = 0; index < bytes.size; index++) {
+			stream << hexDigits[bytes.data[index] >> 4] << hexDigits[bytes.data[index] & 0x0f];
+		}
+
+		return stream;
+	}
+
+	/**
+	 * @brief      Fixed-size stream buffer a thread formats its log lines
+	 * into, without allocating; whatever does not fit is cut off.
+	 */
+	class _logLineBuffer : public std::streambuf {
+		private:
+			char _line[TDRS_LOG_LINE_SIZE];
+		public:
+			_logLineBuffer() {
+				reset();
+			}
+
+			void reset() {
+				setp(_line, _line + sizeof(_line));
+			}
+
+			const char *data() const {
+				return pbase();
+			}
+
+			size_t size() const {
+				return pptr() - pbase();
+			}
+	};
+
+	/**
+	 * @brief      Log buffer of one thread: a single-producer/single-consumer
+	 * ring of lines, filled by its thread and drained by the log writer.
+	 */
+	struct _logBuffer {
+		std::vector<std::string> lines;
+		std::atomic<size_t> head;
+		std::atomic<size_t> tail;
+		std::atomic<bool> orphaned;
+		_logLineBuffer line;
+		std::ostream stream;
+
+		_logBuffer() : stream(&line) {}
+	};
+
+	/**
+	 * @brief      Class for the asynchronous Logger. Threads format and commit
+	 * lines into their own buffers without locking; a background writer
+	 * thread drains all buffers and writes them out in batches.
+	 */
+	class Logger {
+		private:
+			/**
+			 * Mutex guarding the buffers vector and the draining of the buffers.
+			 */
+			static pthread_mutex_t _buffersMutex;
+			/**
+			 * Buffers of all threads that logged at least once.
+			 */
+			static std::vector<_logBuffer*> _buffers;
+			/**
+			 * Writer thread.
+			 */
+			static pthread_t _writerThread;
+			/**
+			 * The writer's run-loop variable.
+			 */
+			static std::atomic<bool> _runWriter;
+			/**
+			 * Number of lines dropped since the last report, as their buffer was full.
+			 */
+			static std::atomic<uint64_t> _droppedLines;
+
+			/**
+			 * @brief      Returns the calling thread's log buffer, registering it on first use.
+			 *
+			 * @return     The log buffer.
+			 */
+			static _logBuffer *_threadBuffer();
+			/**
+			 * @brief      Moves all committed lines into the output.
+			 *
+			 * @param      output  The output
+			 */
+			static void _drain(std::string &output);
+			/**
+			 * @brief      The writer; static method instantiated as an own thread.
+			 *
+			 * @return     NULL
+			 */
+			static void *_writer(void *);
+		public:
+			/**
+			 * Log level, lines above it are discarded.
+			 */
+			static std::atomic<int> level;
+
+			/**
+			 * @brief      Parses a log level name.
+			 *
+			 * @param[in]  name   The name, one of error, warning, info, debug
+			 * @param      level  The parsed level
+			 *
+			 * @return     True on success, false on unknown names.
+			 */
+			static bool parseLevel(const std::string &name, int *level);
+			/**
+			 * @brief      Returns the calling thread's stream for formatting one line.
+			 *
+			 * @return     The emptied stream.
+			 */
+			static std::ostream &stream();
+			/**
+			 * @brief      Commits the line formatted on the calling thread's stream.
+			 */
+			static void commit();
+			/**
+			 * @brief      Starts the writer thread.
+			 */
+			static void start();
+			/**
+			 * @brief      Synchronously writes all committed lines.
+			 */
+			static void flush();
+			/**
+			 * @brief      Stops the writer thread and writes all remaining lines.
+			 */
+			static void shutdown();
+	};
+
 	struct zeroAddress {
 		std::string protocol;
 		std::string address;
 		std::string port;
 	};
 
-	struct peerMessage {
-		std::string event;
-		std::string id;
-		std::string publisher;
-		std::string receiver;
+	/**
+	 * @brief      Peer announcement, carried by a control message.
+	 */
+	struct peerMessage {
+		uint8_t event;
+		std::string id;
+		std::string publisher;
+		std::string receiver;
+		std::string key;
+		std::string proxy;
+	};
+
+	/**
+	 * @brief      Addresses of a hub on the partition ring; the proxy is
+	 * empty for a hub not taking proxied events.
+	 */
+	struct partitionMember {
+		std::string receiver;
+		std::string publisher;
+		std::string proxy;
+	};
+
+	/**
+	 * @brief      Chain envelope, stamped on every event published by a hub
+	 * with --chain-envelope and kept when it is relayed by other hubs.
+	 */
+	struct chainEnvelope {
+		uint8_t hops;
+		uint64_t origin;
+		uint64_t sequence;
+		uint64_t relay;
+		uint64_t previousRelay;
+	};
+
+	/**
+	 * @brief      Chain batch spec, what a batched chain link asks the hub
+	 * behind it for.
+	 */
+	struct chainBatchSpec {
+		uint8_t codec;
+		uint32_t size;
+		uint32_t window;
+	};
+
+	/**
+	 * @brief      Sequence window of one origin.
+	 */
+	struct _sequenceWindowEntry {
+		uint64_t highest;
+		uint64_t lastSeen;
+		uint64_t seen[TDRS_SEQUENCE_WINDOW / 64];
+	};
+
+	/**
+	 * @brief      Sequence window stats.
+	 */
+	struct sequenceWindowStats {
+		size_t origins;
+		uint64_t accepted;
+		uint64_t duplicates;
+		uint64_t stale;
+	};
+
+	/**
+	 * @brief      Class for HubSequenceWindow, remembering the most recent
+	 * sequence numbers seen per origin hub. Not thread-safe, callers lock.
+	 */
+	class HubSequenceWindow {
+		private:
+			/**
+			 * Windows by origin hub identifier.
+			 */
+			std::unordered_map<uint64_t, _sequenceWindowEntry> _origins;
+			/**
+			 * Counters, see sequenceWindowStats.
+			 */
+			uint64_t _accepted;
+			uint64_t _duplicates;
+			uint64_t _stale;
+
+			/**
+			 * @brief      Forgets the origin seen least recently.
+			 */
+			void _evictOrigin();
+		public:
+			/**
+			 * @brief      Constructs the object.
+			 */
+			HubSequenceWindow();
+
+			/**
+			 * @brief      Checks an event against the window of its origin and
+			 * marks it as seen.
+			 *
+			 * @param[in]  origin    The origin hub identifier
+			 * @param[in]  sequence  The event's sequence number at its origin
+			 *
+			 * @return     True if the event was not seen before, false otherwise.
+			 */
+			bool accept(uint64_t origin, uint64_t sequence);
+			/**
+			 * @brief      Returns the occupancy and counters of the window.
+			 *
+			 * @return     The stats.
+			 */
+			sequenceWindowStats stats() const;
+	};
+
+	/**
+	 * @brief      Class for HubHistogram, a log-linear histogram of latencies
+	 * (ns) in the style of HdrHistogram. Not thread-safe.
+	 */
+	class HubHistogram {
+		private:
+			/**
+			 * Number of values recorded per bucket.
+			 */
+			uint64_t _counts[TDRS_HISTOGRAM_BUCKETS];
+			/**
+			 * Number, sum and maximum of the recorded values.
+			 */
+			uint64_t _count;
+			uint64_t _sum;
+			uint64_t _max;
+
+			/**
+			 * @brief      Static method returning the bucket of a value.
+			 *
+			 * @param[in]  value  The value
+			 *
+			 * @return     The bucket index.
+			 */
+			static size_t _bucket(uint64_t value);
+			/**
+			 * @brief      Static method returning the highest value of a bucket.
+			 *
+			 * @param[in]  bucket  The bucket index
+			 *
+			 * @return     The value.
+			 */
+			static uint64_t _highestValue(size_t bucket);
+		public:
+			/**
+			 * @brief      Constructs the object.
+			 */
+			HubHistogram();
+
+			/**
+			 * @brief      Records one value.
+			 *
+			 * @param[in]  value  The value
+			 */
+			void record(uint64_t value);
+			/**
+			 * @brief      Adds the values recorded by another histogram.
+			 *
+			 * @param[in]  other  The other histogram
+			 */
+			void merge(const HubHistogram &other);
+			/**
+			 * @brief      Forgets all recorded values.
+			 */
+			void reset();
+			/**
+			 * @brief      Returns the number of recorded values.
+			 *
+			 * @return     The count.
+			 */
+			uint64_t count() const;
+			/**
+			 * @brief      Returns the sum of all recorded values.
+			 *
+			 * @return     The sum.
+			 */
+			uint64_t sum() const;
+			/**
+			 * @brief      Returns the highest recorded value.
+			 *
+			 * @return     The value.
+			 */
+			uint64_t max() const;
+			/**
+			 * @brief      Returns the value below or at which the given share
+			 * of the recorded values lie.
+			 *
+			 * @param[in]  quantile  The quantile, between 0 and 1
+			 *
+			 * @return     The value, 0 if nothing was recorded.
+			 */
+			uint64_t quantile(double quantile) const;
+	};
+
+	/**
+	 * @brief      Class for HubSubscriptionTable, counting the prefixes the
+	 * subscribers of a hub are interested in, per hub for subscriptions of
+	 * chain clients. Not thread-safe, callers lock; except for version().
+	 */
+	class HubSubscriptionTable {
+		private:
+			/**
+			 * Subscription counts by prefix.
+			 */
+			std::map<std::string, size_t> _prefixes;
+			/**
+			 * Subscription counts by prefix, by the hub subscribed for.
+			 */
+			std::map<uint64_t, std::map<std::string, size_t> > _viaHubs;
+			/**
+			 * Version, increased on every change.
+			 */
+			std::atomic<uint64_t> _version;
+
+			/**
+			 * @brief      Static method for encoding a hub identifier.
+			 *
+			 * @param[in]  hub   The hub identifier
+			 *
+			 * @return     The encoded identifier.
+			 */
+			static std::string _encodeHub(uint64_t hub);
+			/**
+			 * @brief      Static method for decoding a hub identifier.
+			 *
+			 * @param[in]  data  The encoded identifier, 8 bytes
+			 *
+			 * @return     The hub identifier.
+			 */
+			static uint64_t _decodeHub(const unsigned char *data);
+		public:
+			/**
+			 * @brief      Constructs the object.
+			 */
+			HubSubscriptionTable();
+
+			/**
+			 * @brief      Static method returning the hello topic a hub
+			 * tells chain clients its identifier with.
+			 *
+			 * @param[in]  hub   The hub identifier
+			 *
+			 * @return     The topic.
+			 */
+			static std::string helloTopic(uint64_t hub);
+			/**
+			 * @brief      Static method for parsing a hello message.
+			 *
+			 * @param[in]  data  The message data
+			 * @param[in]  size  The message size
+			 * @param      hub   The identifier of the hub that sent the hello
+			 *
+			 * @return     True if the message is a hello, false otherwise.
+			 */
+			static bool parseHello(const void *data, size_t size, uint64_t *hub);
+			/**
+			 * @brief      Static method returning the marker topic a chain
+			 * client subscribes along with each prefix.
+			 *
+			 * @param[in]  hub     The hub identifier
+			 * @param[in]  prefix  The prefix
+			 *
+			 * @return     The topic.
+			 */
+			static std::string viaTopic(uint64_t hub, const std::string &prefix);
+
+			/**
+			 * @brief      Applies one subscription message, as received on the
+			 * hub's XPUB socket.
+			 *
+			 * @param[in]  data  The message data
+			 * @param[in]  size  The message size
+			 *
+			 * @return     True if the interest changed, false otherwise.
+			 */
+			bool update(const void *data, size_t size);
+			/**
+			 * @brief      Collects the prefixes somebody subscribed to, apart
+			 * from the subscriptions made on behalf of one hub.
+			 *
+			 * @param[in]  excludedHub  The hub identifier, 0 for none
+			 * @param      prefixes     The prefixes
+			 */
+			void interest(uint64_t excludedHub, std::set<std::string> *prefixes) const;
+			/**
+			 * @brief      Returns the version of the table.
+			 *
+			 * @return     The version.
+			 */
+			uint64_t version() const;
+			/**
+			 * @brief      Returns the number of distinct prefixes subscribed to.
+			 *
+			 * @return     The number of prefixes.
+			 */
+			size_t size() const;
+	};
+
+	/**
+	 * @brief      Class for HubOverlay, deriving the peers a hub links to from
+	 * the members of the discovery group, according to the overlay topology.
+	 * Used by the run-loop thread only.
+	 */
+	class HubOverlay {
+		private:
+			/**
+			 * Topology, one of TDRS_OVERLAY_*.
+			 */
+			int _topology;
+			/**
+			 * Children per hub, with the tree topology.
+			 */
+			size_t _fanout;
+			/**
+			 * Number of super-peers, with the super-peer topology.
+			 */
+			size_t _superPeers;
+			/**
+			 * Key of this hub.
+			 */
+			std::string _self;
+			/**
+			 * Peer identifiers by key, and keys by peer identifier.
+			 */
+			std::map<std::string, std::string> _members;
+			std::map<std::string, std::string> _keys;
+
+			/**
+			 * @brief      Returns the level of a member in the tree.
+			 *
+			 * @param[in]  key   The key of the member
+			 *
+			 * @return     The level.
+			 */
+			size_t _level(const std::string &key) const;
+			/**
+			 * @brief      Returns the parents of all members in the tree.
+			 *
+			 * @param[in]  keys     The keys of the members, ordered
+			 * @param      parents  The index of every member's parent, the root's own
+			 */
+			void _parents(const std::vector<std::string> &keys, std::vector<size_t> *parents) const;
+			/**
+			 * @brief      Returns the super-peer a member links to.
+			 *
+			 * @param[in]  keys        The keys of the members, ordered
+			 * @param[in]  superPeers  The number of super-peers, the first members
+			 * @param[in]  member      The index of the member
+			 *
+			 * @return     The index of the super-peer.
+			 */
+			size_t _superPeer(const std::vector<std::string> &keys, size_t superPeers, size_t member) const;
+		public:
+			/**
+			 * @brief      Constructs the object.
+			 */
+			HubOverlay();
+
+			/**
+			 * @brief      Static method parsing the name of an overlay topology.
+			 *
+			 * @param[in]  name      The name, one of 'mesh', 'tree', 'super-peer'
+			 * @param      topology  The topology
+			 *
+			 * @return     True on success, false for an unknown name.
+			 */
+			static bool parseTopology(const std::string &name, int *topology);
+			/**
+			 * @brief      Static method returning the key a hub is ordered by
+			 * in the overlay.
+			 *
+			 * @param[in]  hubId  The hub identifier
+			 *
+			 * @return     The key.
+			 */
+			static std::string memberKey(uint64_t hubId);
+
+			/**
+			 * @brief      Configures the overlay.
+			 *
+			 * @param[in]  topology    The topology
+			 * @param[in]  fanout      The number of children per hub, with the tree topology
+			 * @param[in]  superPeers  The number of super-peers, with the super-peer topology
+			 * @param[in]  self        The key of this hub
+			 */
+			void configure(int topology, size_t fanout, size_t superPeers, const std::string &self);
+			/**
+			 * @brief      Adds a peer to the members.
+			 *
+			 * @param[in]  key   The key of the peer
+			 * @param[in]  id    The peer identifier
+			 */
+			void enter(const std::string &key, const std::string &id);
+			/**
+			 * @brief      Removes a peer from the members.
+			 *
+			 * @param[in]  id    The peer identifier
+			 */
+			void exit(const std::string &id);
+			/**
+			 * @brief      Returns the number of members, this hub included.
+			 *
+			 * @return     The number of members.
+			 */
+			size_t size() const;
+			/**
+			 * @brief      Returns the peers this hub links to.
+			 *
+			 * @param      ids   The identifiers of the peers to link to
+			 */
+			void neighbors(std::set<std::string> *ids) const;
+	};
+
+	/**
+	 * @brief      Class for HubPartitionRing, a consistent-hash ring assigning
+	 * every topic to one owner hub of a partitioned cluster. Used by the
+	 * run-loop thread only.
+	 */
+	class HubPartitionRing {
+		private:
+			/**
+			 * Character ending the topic of an event.
+			 */
+			char _delimiter;
+			/**
+			 * Keys of the hubs by position on the ring.
+			 */
+			std::map<uint64_t, std::string> _points;
+			/**
+			 * Addresses of the hubs by key, and keys by peer identifier.
+			 */
+			std::map<std::string, partitionMember> _members;
+			std::map<std::string, std::string> _keys;
+
+			/**
+			 * @brief      Removes the positions and addresses of the hub with
+			 * a key.
+			 *
+			 * @param[in]  key   The key of the hub
+			 */
+			void _removeKey(const std::string &key);
+		public:
+			/**
+			 * @brief      Constructs the object.
+			 */
+			HubPartitionRing();
+
+			/**
+			 * @brief      Static method hashing bytes onto the ring.
+			 *
+			 * @param[in]  data  The data
+			 * @param[in]  size  The size
+			 *
+			 * @return     The position on the ring.
+			 */
+			static uint64_t hash(const void *data, size_t size);
+
+			/**
+			 * @brief      Configures the ring.
+			 *
+			 * @param[in]  delimiter  The delimiter ending the topic of an event
+			 */
+			void configure(char delimiter);
+			/**
+			 * @brief      Adds a hub to the ring.
+			 *
+			 * @param[in]  id      The peer identifier, empty for this hub
+			 * @param[in]  key     The key of the hub
+			 * @param[in]  member  The addresses of the hub
+			 */
+			void add(const std::string &id, const std::string &key, const partitionMember &member);
+			/**
+			 * @brief      Removes a hub from the ring.
+			 *
+			 * @param[in]  id    The peer identifier
+			 */
+			void remove(const std::string &id);
+			/**
+			 * @brief      Returns the key of the hub owning a topic.
+			 *
+			 * @param[in]  topic  The topic
+			 * @param[in]  size   The size of the topic
+			 *
+			 * @return     The key of the owner, empty for an empty ring.
+			 */
+			const std::string &owner(const char *topic, size_t size) const;
+			/**
+			 * @brief      Returns the key of the hub owning the topic of an event.
+			 *
+			 * @param[in]  data  The event
+			 * @param[in]  size  The size of the event
+			 *
+			 * @return     The key of the owner, empty for an empty ring.
+			 */
+			const std::string &ownerOf(const void *data, size_t size) const;
+			/**
+			 * @brief      Returns the addresses of a hub.
+			 *
+			 * @param[in]  key   The key of the hub
+			 *
+			 * @return     The addresses, NULL for an unknown hub.
+			 */
+			const partitionMember *member(const std::string &key) const;
+			/**
+			 * @brief      Returns the addresses of all hubs, by key.
+			 *
+			 * @return     The members.
+			 */
+			const std::map<std::string, partitionMember> &members() const;
+	};
+
+	/**
+	 * @brief      Header of a ring file, shared by the hub and one publisher.
+	 */
+	struct _shmRingHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t capacity;
+		alignas(64) std::atomic<uint64_t> head;
+		alignas(64) std::atomic<uint64_t> tail;
+		alignas(64) std::atomic<uint32_t> sleeping;
+		std::atomic<uint32_t> closed;
+		std::atomic<int32_t> publisher;
+	};
+
+	/**
+	 * @brief      Class for HubShmRing, a single-producer single-consumer
+	 * ring of events in shared memory, written by one co-located publisher
+	 * and drained by the run-loop thread of the hub.
+	 */
+	class HubShmRing {
+		private:
+			/**
+			 * The path of the ring file.
+			 */
+			std::string _path;
+			/**
+			 * The mapped header and data region.
+			 */
+			_shmRingHeader *_header;
+			unsigned char *_data;
+			size_t _mapSize;
+			uint64_t _mask;
+			/**
+			 * The wakeup FIFO of the hub, for the publisher.
+			 */
+			int _wakeFd;
+			/**
+			 * Whether the hub created the ring.
+			 */
+			bool _owner;
+			/**
+			 * The hub's read position, and whether it rejected the ring.
+			 */
+			uint64_t _tail;
+			bool _broken;
+			/**
+			 * Time (ns) the hub created the ring at.
+			 */
+			uint64_t _createdAt;
+
+			/**
+			 * @brief      Maps a ring file.
+			 *
+			 * @param[in]  fd       The file descriptor
+			 * @param[in]  mapSize  The size of the file
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			bool _map(int fd, size_t mapSize);
+			/**
+			 * @brief      Rejects a ring whose publisher left it inconsistent.
+			 *
+			 * @param[in]  reason  The reason
+			 */
+			void _break(const char *reason);
+		public:
+			/**
+			 * @brief      Constructs the object.
+			 */
+			HubShmRing();
+			/**
+			 * @brief      Destroys the object, closing the ring.
+			 */
+			~HubShmRing();
+
+			/**
+			 * @brief      Static method checking whether a message is the
+			 * handshake a publisher asks for a ring with.
+			 *
+			 * @param[in]  message  The message
+			 *
+			 * @return     True for the handshake, false otherwise.
+			 */
+			static bool isHello(const zmq::message_t &message);
+			/**
+			 * @brief      Static method creating and opening the wakeup FIFO
+			 * of the hub.
+			 *
+			 * @param[in]  path  The path
+			 *
+			 * @return     The file descriptor, -1 on failure.
+			 */
+			static int openWake(const std::string &path);
+			/**
+			 * @brief      Static method discarding the wakeups written to the
+			 * FIFO.
+			 *
+			 * @param[in]  fd    The file descriptor
+			 */
+			static void drainWake(int fd);
+
+			/**
+			 * @brief      Creates a ring for one publisher, as the hub.
+			 *
+			 * @param[in]  path      The path of the ring file
+			 * @param[in]  capacity  The capacity (bytes)
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			bool create(const std::string &path, size_t capacity);
+			/**
+			 * @brief      Attaches to a ring the hub created, as its publisher.
+			 *
+			 * @param[in]  path  The path of the ring file
+			 * @param[in]  wake  The path of the hub's wakeup FIFO
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			bool attach(const std::string &path, const std::string &wake);
+			/**
+			 * @brief      Writes one event to the ring, as the publisher.
+			 *
+			 * @param[in]  data  The event
+			 * @param[in]  size  The size of the event
+			 *
+			 * @return     True on success, false if the ring is full.
+			 */
+			bool write(const void *data, size_t size);
+			/**
+			 * @brief      Reads events from the ring, as the hub.
+			 *
+			 * @param      frames  The frames vector to append to
+			 * @param[in]  max     The maximum number of events
+			 *
+			 * @return     The number of events read.
+			 */
+			size_t read(std::vector<zmq::message_t> &frames, size_t max);
+			/**
+			 * @brief      Asks the publisher to wake up the hub, as the hub.
+			 *
+			 * @return     True if the ring is empty, false otherwise.
+			 */
+			bool sleep();
+			/**
+			 * @brief      Returns whether the publisher closed the ring.
+			 *
+			 * @return     True if closed, false otherwise.
+			 */
+			bool closed() const;
+			/**
+			 * @brief      Returns whether the publisher of the ring is alive,
+			 * as the hub.
+			 *
+			 * @param[in]  now   The current monotonic time (ns)
+			 *
+			 * @return     True if alive or still attaching, false otherwise.
+			 */
+			bool alive(uint64_t now) const;
+			/**
+			 * @brief      Marks the ring closed, as the hub, for a publisher
+			 * that is gone.
+			 */
+			void abandon();
+			/**
+			 * @brief      Returns whether the ring holds no events.
+			 *
+			 * @return     True if empty, false otherwise.
+			 */
+			bool empty() const;
+			/**
+			 * @brief      Returns the path of the ring file.
+			 *
+			 * @return     The path.
+			 */
+			const std::string &path() const;
+			/**
+			 * @brief      Closes the ring.
+			 */
+			void close();
+	};
+
+	/**
+	 * @brief      Class for HubChainBatcher, coalescing the published events
+	 * into compressed batches for the batched chain links asking for one spec.
+	 * Used by the run-loop thread only.
+	 */
+	class HubChainBatcher {
+		private:
+			/**
+			 * The spec, and the topic its batches are published under.
+			 */
+			chainBatchSpec _spec;
+			std::string _topic;
+			/**
+			 * Number of chain links subscribed to the batches.
+			 */
+			size_t _subscribers;
+			/**
+			 * Events of the open batch, uncompressed, and their number.
+			 */
+			std::string _events;
+			uint32_t _count;
+			/**
+			 * Time (ns) the open batch got its first event.
+			 */
+			uint64_t _openedAt;
+			/**
+			 * Compression buffer, kept between batches.
+			 */
+			std::string _compressed;
+			/**
+			 * Compression context of the zstd codec.
+			 */
+			ZSTD_CCtx *_zstdContext;
+
+			/**
+			 * @brief      Static methods for encoding and decoding a 4 byte
+			 * integer (big endian).
+			 */
+			static void _put32(unsigned char *data, uint32_t value);
+			static uint32_t _get32(const unsigned char *data);
+		public:
+			/**
+			 * @brief      Constructs the object.
+			 *
+			 * @param[in]  spec  The spec
+			 */
+			HubChainBatcher(const chainBatchSpec &spec);
+			/**
+			 * @brief      Destroys the object.
+			 */
+			~HubChainBatcher();
+
+			/**
+			 * @brief      Static method for parsing a codec name.
+			 *
+			 * @param[in]  name   The name, one of 'none', 'lz4', 'zstd'
+			 * @param      codec  The codec
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			static bool parseCodec(const std::string &name, uint8_t *codec);
+			/**
+			 * @brief      Static method returning the topic a batched chain
+			 * link subscribes with.
+			 *
+			 * @param[in]  spec  The spec
+			 *
+			 * @return     The topic.
+			 */
+			static std::string topic(const chainBatchSpec &spec);
+			/**
+			 * @brief      Static method for parsing a topic a batched chain
+			 * link subscribed with.
+			 *
+			 * @param[in]  data  The topic data
+			 * @param[in]  size  The topic size
+			 * @param      spec  The spec
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			static bool parseTopic(const void *data, size_t size, chainBatchSpec *spec);
+			/**
+			 * @brief      Static method for decoding a batch frame.
+			 *
+			 * @param[in]  batch        The batch frame
+			 * @param      zstdContext  The decompression context of the zstd codec
+			 * @param      events       The events, uncompressed
+			 * @param      count        The number of events
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			static bool decode(const zmq::message_t &batch, ZSTD_DCtx *zstdContext, std::string *events, uint32_t *count);
+			/**
+			 * @brief      Static method for reading the next event of decoded
+			 * events.
+			 *
+			 * @param[in]  events        The events
+			 * @param      position      The position of the next event, advanced
+			 * @param      payload       The event
+			 * @param      payloadSize   The event size
+			 * @param      envelope      The envelope
+			 * @param      envelopeSize  The envelope size, 0 for none
+			 *
+			 * @return     True if there was an event, false otherwise.
+			 */
+			static bool nextEvent(const std::string &events, size_t *position, const char **payload, size_t *payloadSize, const char **envelope, size_t *envelopeSize);
+
+			/**
+			 * @brief      Counts a chain link subscribing to the batches.
+			 */
+			void subscribe();
+			/**
+			 * @brief      Counts a chain link unsubscribing from the batches.
+			 *
+			 * @return     The number of chain links still subscribed.
+			 */
+			size_t unsubscribe();
+			/**
+			 * @brief      Adds an event to the open batch.
+			 *
+			 * @param[in]  payload       The event
+			 * @param[in]  payloadSize   The event size
+			 * @param[in]  envelope      The envelope
+			 * @param[in]  envelopeSize  The envelope size, 0 for none
+			 * @param[in]  now           The current time (ns)
+			 *
+			 * @return     True if the batch reached its size, false otherwise.
+			 */
+			bool append(const void *payload, size_t payloadSize, const void *envelope, size_t envelopeSize, uint64_t now);
+			/**
+			 * @brief      Returns whether the open batch is empty.
+			 *
+			 * @return     True if empty, false otherwise.
+			 */
+			bool empty() const;
+			/**
+			 * @brief      Returns the time the open batch is due at.
+			 *
+			 * @return     The time (ns).
+			 */
+			uint64_t deadline() const;
+			/**
+			 * @brief      Compresses the open batch into a message and starts
+			 * a new one.
+			 *
+			 * @param      topic  The topic frame
+			 * @param      batch  The batch frame
+			 *
+			 * @return     The size (bytes) of the events uncompressed.
+			 */
+			size_t flush(zmq::message_t *topic, zmq::message_t *batch);
+	};
+
+	/**
+	 * @brief      Dedup index key, an event's fingerprint expected over a link.
+	 * The fingerprint is stored in place, so entries need no allocation of
+	 * their own.
+	 */
+	struct _dedupKey {
+		unsigned char fingerprint[TDRS_DEDUP_KEY_SIZE];
+		uint32_t link;
+	};
+
+	/**
+	 * @brief      Dedup index node, kept in insertion order for eviction.
+	 */
+	struct _dedupNode {
+		_dedupKey key;
+		uint64_t insertedAt;
+	};
+
+	/**
+	 * @brief      Hash functor for dedup keys, referenced by the index.
+	 */
+	struct _dedupKeyHash {
+		size_t operator()(const _dedupKey *key) const {
+			// Fingerprints are digests, any of their bytes are evenly distributed
+			size_t hash;
+			memcpy(&hash, key->fingerprint, sizeof(hash));
+			return hash ^ ((size_t)key->link * 0x9e3779b97f4a7c15ULL);
+		}
+	};
+
+	/**
+	 * @brief      Equality functor for dedup keys, referenced by the index.
+	 */
+	struct _dedupKeyEqual {
+		bool operator()(const _dedupKey *left, const _dedupKey *right) const {
+			return left->link == right->link && memcmp(left->fingerprint, right->fingerprint, TDRS_DEDUP_KEY_SIZE) == 0;
+		}
+	};
+
+	typedef std::unordered_multimap<const _dedupKey*, std::list<_dedupNode>::iterator, _dedupKeyHash, _dedupKeyEqual> _dedupIndexMap;
+
+	/**
+	 * @brief      Dedup index stats.
+	 */
+	struct dedupIndexStats {
+		size_t entries;
+		size_t bytes;
+		uint64_t inserted;
+		uint64_t matched;
+		uint64_t expired;
+		uint64_t evicted;
+	};
+
+	/**
+	 * @brief      Class for HubDedupIndex, remembering which events are
+	 * expected back over which chain link. Not thread-safe, callers lock.
+	 */
+	class HubDedupIndex {
+		private:
+			/**
+			 * Entries in insertion order, oldest first.
+			 */
+			std::list<_dedupNode> _nodes;
+			/**
+			 * Entries by key, referencing the keys stored in the nodes.
+			 */
+			_dedupIndexMap _index;
+			/**
+			 * Identifiers of all links seen so far.
+			 */
+			std::unordered_map<std::string, uint32_t> _linkIds;
+			/**
+			 * Identifier of the next new link.
+			 */
+			uint32_t _nextLinkId;
+			/**
+			 * Maximum number of entries.
+			 */
+			size_t _maxEntries;
+			/**
+			 * Maximum (estimated) memory used by entries.
+			 */
+			size_t _maxBytes;
+			/**
+			 * Time (ms) after which unmatched entries expire.
+			 */
+			uint64_t _ttl;
+			/**
+			 * Estimated memory used by entries.
+			 */
+			size_t _bytes;
+			/**
+			 * Counters, see dedupIndexStats.
+			 */
+			uint64_t _inserted;
+			uint64_t _matched;
+			uint64_t _expired;
+			uint64_t _evicted;
+
+			/**
+			 * @brief      Static method returning the current monotonic time.
+			 *
+			 * @return     The time (ms).
+			 */
+			static uint64_t _now();
+			/**
+			 * @brief      Static method estimating the memory used by one entry.
+			 *
+			 * @return     The size (bytes).
+			 */
+			static size_t _entryBytes();
+			/**
+			 * @brief      Static method building the key of an entry.
+			 *
+			 * @param[in]  fingerprint  The event's fingerprint
+			 * @param[in]  link         The link identifier
+			 * @param      key          The key
+			 */
+			static void _buildKey(const std::string &fingerprint, uint32_t link, _dedupKey *key);
+			/**
+			 * @brief      Removes one entry from the index.
+			 *
+			 * @param[in]  node  The entry's node
+			 */
+			void _erase(std::list<_dedupNode>::iterator node);
+			/**
+			 * @brief      Evicts the oldest entries, as long as they are expired
+			 * or the index exceeds its bounds.
+			 *
+			 * @param[in]  now   The current time (ms)
+			 */
+			void _evict(uint64_t now);
+		public:
+			/**
+			 * @brief      Constructs the object.
+			 */
+			HubDedupIndex();
+
+			/**
+			 * @brief      Sets the bounds of the index.
+			 *
+			 * @param[in]  maxEntries  The maximum number of entries
+			 * @param[in]  maxBytes    The maximum (estimated) memory used by entries
+			 * @param[in]  ttl         The time (ms) after which unmatched entries expire
+			 */
+			void configure(size_t maxEntries, size_t maxBytes, uint64_t ttl);
+			/**
+			 * @brief      Returns the identifier of a link, assigning one on first use.
+			 *
+			 * @param[in]  link  The link
+			 *
+			 * @return     The link identifier.
+			 */
+			uint32_t linkId(const std::string &link);
+			/**
+			 * @brief      Inserts an entry, expecting the event with the given
+			 * fingerprint to come back once over the given link.
+			 *
+			 * @param[in]  fingerprint  The event's fingerprint
+			 * @param[in]  link         The link identifier
+			 */
+			void insert(const std::string &fingerprint, uint32_t link);
+			/**
+			 * @brief      Looks up an entry and removes it, if found.
+			 *
+			 * @param[in]  fingerprint  The event's fingerprint
+			 * @param[in]  link         The link identifier the event came in over
+			 *
+			 * @return     True if the event was expected over the link, false otherwise.
+			 */
+			bool consume(const std::string &fingerprint, uint32_t link);
+			/**
+			 * @brief      Removes all entries of a link.
+			 *
+			 * @param[in]  link  The link identifier
+			 */
+			void removeLink(uint32_t link);
+			/**
+			 * @brief      Returns the occupancy and counters of the index.
+			 *
+			 * @return     The stats.
+			 */
+			dedupIndexStats stats() const;
+	};
+
+	/**
+	 * @brief      Parameters struct for chain client thread.
+	 */
+	struct _chainClientParams {
+		std::string id;
+		std::string link;
+		std::string endpoint;
+		bool batched;
+		chainBatchSpec batch;
+		zmq::context_t *context;
+		uint32_t linkId;
+		int fingerprint;
+		uint64_t hubId;
+		int maxHops;
+		pthread_mutex_t *dedupIndexMutex;
+		HubDedupIndex *dedupIndex;
+		HubSequenceWindow *sequenceWindow;
+		pthread_mutex_t *subscriptionTableMutex;
+		HubSubscriptionTable *subscriptionTable;
+		std::vector<uint32_t> *chainLinkIds;
+		int hwm;
+		int heartbeatInterval;
+		int heartbeatTimeout;
+		int reconnectMax;
+		std::atomic<uint64_t> forwarded;
+		std::atomic<uint64_t> discarded;
+		std::atomic<int> state;
+		std::atomic<uint64_t> reconnects;
+		std::atomic<bool> run;
+		std::atomic<bool> stopped;
+	};
+
+	/**
+	 * @brief      Chain client thread struct, containing the thread itself and the parameters.
+	 * With the chain reactor, the thread is not used.
+	 */
+	struct _chainClientThread {
+		pthread_t thread;
+		pthread_attr_t thattr;
+		_chainClientParams *params;
+	};
+
+	/**
+	 * @brief      Command sent to the chain reactor, registering or
+	 * unregistering one chain link. The reactor releases the parameters of
+	 * unregistered links; a NULL link requests the reactor to exit.
+	 */
+	struct _chainReactorCommand {
+		bool add;
+		_chainClientParams *params;
+	};
+
+	/**
+	 * @brief      Parameters struct for chain reactor thread.
+	 */
+	struct _chainReactorParams {
+		zmq::context_t *context;
+	};
+
+	/**
+	 * @brief      Chain reactor thread struct, containing the thread itself and the parameters.
+	 */
+	struct _chainReactorThread {
+		pthread_t thread;
+		pthread_attr_t thattr;
+		_chainReactorParams *params;
+	};
+
+	struct _ingestJob;
+
+	/**
+	 * @brief      Event waiting in the publisher backlog, along with the job
+	 * waiting for its ack, if any.
+	 */
+	struct _publisherEvent {
+		zmq::message_t payload;
+		zmq::message_t envelope;
+		bool enveloped;
+		zmq::message_t offset;
+		bool journaled;
+		_ingestJob *job;
+		size_t event;
+	};
+
+	/**
+	 * @brief      Struct for the overflow counters of the publisher.
+	 */
+	struct publisherStats {
+		size_t backlog;
+		uint64_t backlogged;
+		uint64_t droppedNewest;
+		uint64_t droppedOldest;
+	};
+
+	/**
+	 * @brief      Journal segment, a file holding the records from its base
+	 * offset on. The size of the active segment is kept apart, as it grows
+	 * with every record.
+	 */
+	struct _journalSegment {
+		uint64_t baseOffset;
+		std::string path;
+		size_t size;
+		uint64_t closedAt;
 	};
 
 	/**
-	 * @brief      Shared message entry.
+	 * @brief      Range of a segment mapping to be synced to disk by the
+	 * journal's sync thread; closing hands the mapping over, to be unmapped
+	 * and trimmed once synced.
 	 */
-	struct _sharedMessageEntry {
-		std::string hash;
-		std::string link;
+	struct _journalSync {
+		unsigned char *map;
+		size_t mapSize;
+		int fd;
+		size_t from;
+		size_t to;
+		bool closing;
 	};
 
 	/**
-	 * @brief      Parameters struct for chain client thread.
+	 * @brief      Journal stats.
 	 */
-	struct _chainClientParams {
-		std::string id;
-		std::string link;
-		std::string receiver;
-		pthread_mutex_t *shmsgvecmtx;
-		std::vector<_sharedMessageEntry> *shmsgvec;
-		bool run;
-		zmq::socket_t *subscriberSocket;
-		zmq::socket_t *senderSocket;
+	struct journalStats {
+		uint64_t firstOffset;
+		uint64_t nextOffset;
+		size_t segments;
+		uint64_t bytes;
+		uint64_t removed;
 	};
 
 	/**
-	 * @brief      Chain client thread struct, containing the thread itself and the parameters.
+	 * @brief      Handler for replayed journal records; returns false to stop
+	 * the replay.
 	 */
-	struct _chainClientThread {
+	typedef bool (*journalReplayHandler)(void *context, uint64_t offset, const void *payload, size_t payloadSize, const void *envelope, size_t envelopeSize);
+
+	/**
+	 * @brief      Class for HubJournal, an append-only journal of the
+	 * published events in memory-mapped segment files. Appended to by the
+	 * run-loop thread only; replayed from any thread; synced to disk by a
+	 * sync thread of its own.
+	 */
+	class HubJournal {
+		private:
+			/**
+			 * Directory holding the segments.
+			 */
+			std::string _directory;
+			/**
+			 * Size (bytes) of new segments.
+			 */
+			size_t _segmentSize;
+			/**
+			 * Maximum size (bytes) of all segments and maximum age (s) of
+			 * closed segments, 0 for unlimited.
+			 */
+			uint64_t _retentionSize;
+			uint64_t _retentionAge;
+			/**
+			 * Interval (ms) in which appended records are synced to disk.
+			 */
+			uint64_t _fsyncInterval;
+			/**
+			 * Segments mutex, for locking the segments against replays.
+			 */
+			pthread_mutex_t _segmentsMutex;
+			/**
+			 * Segments, oldest first; the last one is appended to.
+			 */
+			std::deque<_journalSegment> _segments;
+			/**
+			 * File descriptor and mapping of the active segment.
+			 */
+			int _fd;
+			unsigned char *_map;
+			size_t _mapSize;
+			/**
+			 * Bytes of the active segment used and synced to disk.
+			 */
+			size_t _used;
+			size_t _synced;
+			/**
+			 * Offset of the next record, and the same for replays, published
+			 * once the record is complete.
+			 */
+			uint64_t _nextOffset;
+			std::atomic<uint64_t> _committedOffset;
+			/**
+			 * Bytes of the active segment holding complete records, for
+			 * replays; a segment is never trimmed below them.
+			 */
+			std::atomic<size_t> _committedBytes;
+			/**
+			 * Sync thread, with the mutex and condition guarding its queue.
+			 */
+			pthread_t _syncThread;
+			bool _syncThreadStarted;
+			pthread_mutex_t _syncMutex;
+			pthread_cond_t _syncCondition;
+			/**
+			 * Ranges handed to the sync thread, oldest first.
+			 */
+			std::deque<_journalSync> _syncQueue;
+			/**
+			 * Whether the sync thread stops once its queue is empty.
+			 */
+			bool _syncStop;
+			/**
+			 * Times (ms) of the last sync and retention check.
+			 */
+			uint64_t _syncedAt;
+			uint64_t _retainedAt;
+			/**
+			 * Number of segments removed by retention.
+			 */
+			uint64_t _removed;
+
+			/**
+			 * @brief      Static method returning the current wall-clock time.
+			 *
+			 * @return     The time (ms since epoch).
+			 */
+			static uint64_t _now();
+			/**
+			 * @brief      Returns the path of a segment.
+			 *
+			 * @param[in]  baseOffset  The segment's first offset
+			 *
+			 * @return     The path.
+			 */
+			std::string _segmentPath(uint64_t baseOffset) const;
+			/**
+			 * @brief      Opens and maps a segment for appending, creating it
+			 * if required.
+			 *
+			 * @param[in]  baseOffset  The segment's first offset
+			 * @param[in]  size        The size to map, at least
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			bool _openSegment(uint64_t baseOffset, size_t size);
+			/**
+			 * @brief      Hands the active segment to the sync thread, to be
+			 * synced, unmapped and trimmed.
+			 */
+			void _closeSegment();
+			/**
+			 * @brief      Hands a range of a segment mapping to the sync
+			 * thread.
+			 *
+			 * @param[in]  request  The range
+			 */
+			void _queueSync(const _journalSync &request);
+			/**
+			 * @brief      Syncs the queued ranges until stopped and the queue
+			 * is empty.
+			 */
+			void _runSync();
+			/**
+			 * @brief      The sync thread; static method instantiated as an
+			 * own thread.
+			 *
+			 * @param      journal  The journal
+			 *
+			 * @return     NULL
+			 */
+			static void *_syncer(void *journal);
+			/**
+			 * @brief      Finds the end of the records of the active segment,
+			 * after a restart.
+			 */
+			void _recoverSegment();
+			/**
+			 * @brief      Removes the oldest closed segments exceeding the
+			 * retention.
+			 *
+			 * @param[in]  now   The current time (ms since epoch)
+			 */
+			void _retain(uint64_t now);
+		public:
+			/**
+			 * @brief      Constructs the object.
+			 */
+			HubJournal();
+
+			/**
+			 * @brief      Sets the directory and bounds of the journal.
+			 *
+			 * @param[in]  directory      The directory
+			 * @param[in]  segmentSize    The size (bytes) of new segments
+			 * @param[in]  retentionSize  The maximum size (bytes) of all segments, 0 for unlimited
+			 * @param[in]  retentionAge   The maximum age (s) of closed segments, 0 for unlimited
+			 * @param[in]  fsyncInterval  The interval (ms) records are synced in, 0 for every maintenance
+			 */
+			void configure(const std::string &directory, size_t segmentSize, uint64_t retentionSize, uint64_t retentionAge, uint64_t fsyncInterval);
+			/**
+			 * @brief      Opens the journal, continuing after its last record.
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			bool open();
+			/**
+			 * @brief      Appends a record.
+			 *
+			 * @param[in]  payload       The payload
+			 * @param[in]  payloadSize   The payload size
+			 * @param[in]  envelope      The envelope, if any
+			 * @param[in]  envelopeSize  The envelope size, 0 for none
+			 * @param      offset        The record's offset
+			 *
+			 * @return     True on success, false if no segment could be opened.
+			 */
+			bool append(const void *payload, size_t payloadSize, const void *envelope, size_t envelopeSize, uint64_t *offset);
+			/**
+			 * @brief      Hands the appended records to the sync thread.
+			 */
+			void sync();
+			/**
+			 * @brief      Syncs and checks the retention, when due.
+			 */
+			void maintain();
+			/**
+			 * @brief      Closes the journal, once all records are synced.
+			 */
+			void close();
+			/**
+			 * @brief      Replays the records from an offset on, up to the last
+			 * complete one. Records lost to retention are skipped.
+			 *
+			 * @param[in]  from     The first offset
+			 * @param[in]  handler  The handler, called once per record
+			 * @param      context  The handler's context
+			 *
+			 * @return     The offset following the last replayed record.
+			 */
+			uint64_t replay(uint64_t from, journalReplayHandler handler, void *context);
+			/**
+			 * @brief      Returns the offset the next record will get.
+			 *
+			 * @return     The offset.
+			 */
+			uint64_t nextOffset() const;
+			/**
+			 * @brief      Returns the occupancy and counters of the journal.
+			 *
+			 * @return     The stats.
+			 */
+			journalStats stats();
+	};
+
+	/**
+	 * @brief      Parameters struct for replay server thread.
+	 */
+	struct _replayServerParams {
+		zmq::context_t *context;
+		HubJournal *journal;
+		std::string listen;
+		std::atomic<bool> run;
+	};
+
+	/**
+	 * @brief      Replay server thread struct, containing the thread itself and the parameters.
+	 */
+	struct _replayServerThread {
 		pthread_t thread;
 		pthread_attr_t thattr;
-		_chainClientParams *params;
+		_replayServerParams *params;
+	};
+
+	/**
+	 * @brief      Last-value cache entry: the cached event apart from its key,
+	 * which the entry is stored under.
+	 */
+	struct _cacheEntry {
+		std::string rest;
+		std::list<const std::string*>::iterator updated;
+	};
+
+	/**
+	 * @brief      Last-value cache stats.
+	 */
+	struct lastValueCacheStats {
+		size_t entries;
+		size_t bytes;
+		uint64_t evicted;
+	};
+
+	/**
+	 * @brief      Class for HubLastValueCache, keeping the most recent event
+	 * of every key, an event's key being its leading bytes up to a delimiter.
+	 * Updated by the run-loop thread only; read from any thread.
+	 */
+	class HubLastValueCache {
+		private:
+			/**
+			 * Maximum memory (bytes) used by the cached values.
+			 */
+			size_t _maxBytes;
+			/**
+			 * Delimiter ending the key of an event.
+			 */
+			char _delimiter;
+			/**
+			 * Entries mutex, for locking the entries against snapshots.
+			 */
+			pthread_mutex_t _entriesMutex;
+			/**
+			 * Entries by key, ordered for looking up prefixes.
+			 */
+			std::map<std::string, _cacheEntry> _entries;
+			/**
+			 * Keys of the entries, least recently updated first.
+			 */
+			std::list<const std::string*> _updated;
+			/**
+			 * Memory (bytes) used by the cached values.
+			 */
+			size_t _bytes;
+			/**
+			 * Number of entries evicted to stay within the maximum memory.
+			 */
+			uint64_t _evicted;
+
+			/**
+			 * @brief      Static method returning the memory an entry accounts
+			 * for.
+			 *
+			 * @param[in]  key    The key
+			 * @param[in]  entry  The entry
+			 *
+			 * @return     The memory (bytes).
+			 */
+			static size_t _entryBytes(const std::string &key, const _cacheEntry &entry);
+			/**
+			 * @brief      Removes an entry.
+			 *
+			 * @param[in]  entry  The entry
+			 */
+			void _erase(std::map<std::string, _cacheEntry>::iterator entry);
+		public:
+			/**
+			 * @brief      Constructs the object.
+			 */
+			HubLastValueCache();
+			/**
+			 * @brief      Destroys the object.
+			 */
+			~HubLastValueCache();
+
+			/**
+			 * @brief      Configures the cache.
+			 *
+			 * @param[in]  maxBytes   The maximum memory (bytes)
+			 * @param[in]  delimiter  The delimiter ending the key of an event
+			 */
+			void configure(size_t maxBytes, char delimiter);
+			/**
+			 * @brief      Caches an event as the last value of its key, if it
+			 * has one.
+			 *
+			 * @param[in]  payload  The event
+			 * @param[in]  size     The event size
+			 *
+			 * @return     True if the event was cached, false otherwise.
+			 */
+			bool update(const void *payload, size_t size);
+			/**
+			 * @brief      Collects the cached events starting with a prefix,
+			 * in key order, continuing after the key of the last one
+			 * collected before.
+			 *
+			 * @param[in]  prefix    The prefix
+			 * @param      cursor    The key of the last event collected, empty to start
+			 * @param[in]  max       The maximum number of events to collect
+			 * @param      payloads  The events
+			 *
+			 * @return     True if there are more events to collect, false otherwise.
+			 */
+			bool collect(const std::string &prefix, std::string *cursor, size_t max, std::vector<std::string> *payloads);
+			/**
+			 * @brief      Returns the occupancy and counters of the cache.
+			 *
+			 * @return     The stats.
+			 */
+			lastValueCacheStats stats();
+	};
+
+	/**
+	 * @brief      Parameters struct for snapshot server thread.
+	 */
+	struct _snapshotServerParams {
+		zmq::context_t *context;
+		HubLastValueCache *cache;
+		std::string listen;
+		std::atomic<bool> run;
+	};
+
+	/**
+	 * @brief      Snapshot server thread struct, containing the thread itself and the parameters.
+	 */
+	struct _snapshotServerThread {
+		pthread_t thread;
+		pthread_attr_t thattr;
+		_snapshotServerParams *params;
+	};
+
+	class Hub;
+	class Microbench;
+
+	/**
+	 * @brief      Ingest job, carrying one received request through
+	 * inspection, hashing, registering and publishing.
+	 */
+	struct _ingestJob {
+		uint64_t sequence;
+		uint64_t receivedAt;
+		uint64_t hashedAt;
+		std::vector<zmq::message_t> frames;
+		size_t first;
+		std::vector<size_t> events;
+		std::vector<bool> enveloped;
+		std::vector<chainEnvelope> envelopes;
+		size_t responseFrames;
+		bool respond;
+		bool relayed;
+		size_t unsettled;
+		std::vector<bool> propagate;
+		std::vector<std::string> hashes;
+		std::vector<std::string> fingerprints;
+		std::vector<std::string> responses;
+	};
+
+	/**
+	 * @brief      Parameters struct for ingest worker thread.
+	 */
+	struct _ingestWorkerParams {
+		int id;
+		Hub *hub;
+	};
+
+	/**
+	 * @brief      Ingest worker thread struct, containing the thread itself and the parameters.
+	 */
+	struct _ingestWorkerThread {
+		pthread_t thread;
+		pthread_attr_t thattr;
+		_ingestWorkerParams *params;
 	};
 
 	/**
 	 * @brief      Parameters struct for service discovery listener thread.
 	 */
 	struct _discoveryServiceListenerParams {
+		zmq::context_t *context;
+		uint64_t hubId;
 		std::string publisher;
 		std::string receiver;
+		std::string proxy;
 		std::string interface;
 		int port;
 		size_t interval;
@@ -88,36 +2164,243 @@ namespace tdrs {
 		_discoveryServiceListenerParams *params;
 	};
 
-	/**
-	 * @brief      Class for Hub.
-	 */
-	class Hub {
-		private:
+	/**
+	 * @brief      Class for Hub.
+	 */
+	class Hub {
+		/**
+		 * The microbenchmarks measure some of the private helpers.
+		 */
+		friend class Microbench;
+		private:
+			/**
+			 * ZMQ Context.
+			 */
+			zmq::context_t _zmqContext;
+			/**
+			 * ZMQ Hub Socket, an XPUB socket reporting the subscriptions.
+			 */
+			zmq::socket_t _zmqHubSocket;
+			/**
+			 * ZMQ Receiver Socket.
+			 */
+			zmq::socket_t _zmqReceiverSocket;
+			/**
+			 * ZMQ Ingest Socket.
+			 */
+			zmq::socket_t _zmqIngestSocket;
+			/**
+			 * ZMQ Chain Socket, collecting the events received by the chain clients.
+			 */
+			zmq::socket_t _zmqChainSocket;
+			/**
+			 * ZMQ Chain Reactor Socket, registering chain links with the chain reactor.
+			 */
+			zmq::socket_t _zmqChainReactorSocket;
+			/**
+			 * ZMQ Results Socket, collecting processed jobs from the ingest workers.
+			 */
+			zmq::socket_t _zmqResultsSocket;
+			/**
+			 * ZMQ Worker Sockets, one for handing jobs to each ingest worker.
+			 */
+			std::vector<zmq::socket_t> _zmqWorkerSockets;
+			/**
+			 * The run-loop variable.
+			 */
+			bool _runLoop;
+
+			/**
+			 * Dedup index mutex, for locking the dedup index and the chain link identifiers.
+			 */
+			pthread_mutex_t _dedupIndexMutex;
+			/**
+			 * Dedup index shared between main process and chain client threads.
+			 */
+			HubDedupIndex _dedupIndex;
+			/**
+			 * Journal of the published events, with --journal-dir.
+			 */
+			HubJournal _journal;
+			/**
+			 * Last-value cache of the published events, with --cache-size.
+			 */
+			HubLastValueCache _lastValueCache;
+			/**
+			 * Link identifiers of all running chain clients, guarded by the dedup index mutex.
+			 */
+			std::vector<uint32_t> _chainLinkIds;
+			/**
+			 * Sequence window of enveloped events, guarded by the dedup index mutex.
+			 */
+			HubSequenceWindow _sequenceWindow;
+			/**
+			 * Subscription table mutex, for locking the subscription table.
+			 */
+			pthread_mutex_t _subscriptionTableMutex;
+			/**
+			 * Prefixes the subscribers of this hub are interested in.
+			 */
+			HubSubscriptionTable _subscriptionTable;
+			/**
+			 * Overlay of the hubs linked by discovery.
+			 */
+			HubOverlay _overlay;
+			/**
+			 * Publisher addresses of the discovered peers, by peer identifier.
+			 */
+			std::map<std::string, std::string> _discoveredPeers;
+			/**
+			 * Partition ring of the hubs in partitioned mode.
+			 */
+			HubPartitionRing _partitionRing;
+			/**
+			 * Time (ns) the partition ring last changed at.
+			 */
+			uint64_t _partitionChangedAt;
+			/**
+			 * Shared-memory rings of the co-located publishers, the wakeup
+			 * FIFO they share and the number of rings created so far.
+			 */
+			std::vector<HubShmRing*> _shmRings;
+			int _shmWakeFd;
+			std::string _shmWakePath;
+			uint64_t _shmRingSequence;
+			/**
+			 * Time (ns) the publishers of the rings were last checked at.
+			 */
+			uint64_t _shmCheckedAt;
+			/**
+			 * ZMQ Push Sockets, proxying ingested events to the partition
+			 * proxy listener of their owner, by the key of the owner.
+			 */
+			std::map<std::string, zmq::socket_t*> _partitionProxySockets;
+			/**
+			 * Random identifier of this hub, the origin of its enveloped events.
+			 */
+			uint64_t _hubId;
+			/**
+			 * Sequence number of the last enveloped event originating here.
+			 */
+			uint64_t _originSequence;
+
 			/**
-			 * ZMQ Context.
+			 * Vector storing ingest worker thread structs.
 			 */
-			zmq::context_t _zmqContext;
+			std::vector<_ingestWorkerThread> _ingestWorkerThreads;
 			/**
-			 * ZMQ Hub Socket.
+			 * Index of the ingest worker receiving the next job.
 			 */
-			zmq::socket_t _zmqHubSocket;
+			size_t _nextIngestWorker;
 			/**
-			 * ZMQ Receiver Socket.
+			 * Sequence number of the next job handed to the ingest workers.
 			 */
-			zmq::socket_t _zmqReceiverSocket;
+			uint64_t _ingestSequence;
 			/**
-			 * The run-loop variable.
+			 * Sequence number of the next job to be published.
 			 */
-			bool _runLoop;
+			uint64_t _publishSequence;
+			/**
+			 * Processed jobs waiting for their predecessors to be published.
+			 */
+			std::map<uint64_t, _ingestJob*> _ingestBacklog;
+			/**
+			 * Whether a REP receiver is waiting for a response to be sent.
+			 */
+			bool _receiverBusy;
+			/**
+			 * Events waiting for the publisher to accept them, oldest first.
+			 */
+			std::deque<_publisherEvent*> _publisherBacklog;
+			/**
+			 * Overflow counters of the publisher.
+			 */
+			publisherStats _publisherStats;
 
 			/**
-			 * Shared message vector mutex, for locking shared message vector.
+			 * ZMQ Metrics Socket.
+			 */
+			zmq::socket_t _zmqMetricsSocket;
+			/**
+			 * ZMQ Control Socket, collecting the peer announcements of the
+			 * discovery service listener.
+			 */
+			zmq::socket_t _zmqControlSocket;
+			/**
+			 * ZMQ Chain Batch Socket, publishing batches to batched chain links.
+			 */
+			zmq::socket_t _zmqChainBatchSocket;
+			/**
+			 * Chain batchers by the topic batched chain links subscribed with.
+			 */
+			std::map<std::string, HubChainBatcher*> _chainBatchers;
+			/**
+			 * ZMQ Partition Socket, answering which hub owns a topic.
+			 */
+			zmq::socket_t _zmqPartitionSocket;
+			/**
+			 * ZMQ Partition Proxy Socket, taking the events other hubs proxy
+			 * to this one.
+			 */
+			zmq::socket_t _zmqPartitionProxySocket;
+			/**
+			 * ZMQ Shm Socket, local endpoint handing out shared-memory rings
+			 * to co-located publishers.
+			 */
+			zmq::socket_t _zmqShmSocket;
+			/**
+			 * Counters of received and published events and of failed acks.
+			 */
+			uint64_t _metricEventsReceived;
+			uint64_t _metricEventsPublished;
+			uint64_t _metricAcksFailed;
+			/**
+			 * Counters of the chain batches sent and of their size (bytes)
+			 * uncompressed and as sent.
+			 */
+			uint64_t _metricChainBatches;
+			uint64_t _metricChainBatchBytesDecoded;
+			uint64_t _metricChainBatchBytesSent;
+			/**
+			 * Events of other hubs' topics redirected, proxied to their
+			 * owner and dropped, in partitioned mode.
+			 */
+			uint64_t _metricPartitionRedirected;
+			uint64_t _metricPartitionProxied;
+			uint64_t _metricPartitionDropped;
+			/**
+			 * Events of other hubs' topics published while the partition ring
+			 * settled, in partitioned mode.
+			 */
+			uint64_t _metricPartitionSettling;
+			/**
+			 * Events taken from shared-memory rings.
+			 */
+			uint64_t _metricShmEvents;
+			/**
+			 * Time (ns) the next chain heartbeat is due at.
+			 */
+			uint64_t _nextHeartbeatAt;
+			/**
+			 * Chain heartbeats not taken by the publisher or the chain batch
+			 * listener.
+			 */
+			uint64_t _metricChainHeartbeatsFailed;
+			/**
+			 * Latencies (ns) from receiving to having hashed an event, from
+			 * having hashed to having published it, from having published it
+			 * to having acked it and from receiving to having acked it.
 			 */
-			pthread_mutex_t _sharedMessageVectorMutex;
+			HubHistogram _metricHashLatency;
+			HubHistogram _metricPublishLatency;
+			HubHistogram _metricAckLatency;
+			HubHistogram _metricTotalLatency;
 			/**
-			 * Shared message vector between main process and chain client threads.
+			 * Time (ns) and counters of the previous metrics request, for rates.
 			 */
-			std::vector<_sharedMessageEntry> _sharedMessageVector;
+			uint64_t _metricsRequestedAt;
+			uint64_t _metricsRequestedReceived;
+			uint64_t _metricsRequestedPublished;
 
 			/**
 			 * Option: --publisher-listen
@@ -127,6 +2410,106 @@ namespace tdrs {
 			 * Option: --receiver-listen
 			 */
 			std::string _optionReceiverListen;
+			/**
+			 * Option: --receiver-mode
+			 */
+			std::string _optionReceiverMode;
+			/**
+			 * Option: --ingest-listen
+			 */
+			std::string _optionIngestListen;
+			/**
+			 * Option: --workers
+			 */
+			int _optionWorkers;
+			/**
+			 * Option: --dedup-max-entries
+			 */
+			size_t _optionDedupMaxEntries;
+			/**
+			 * Option: --dedup-max-memory
+			 */
+			size_t _optionDedupMaxMemory;
+			/**
+			 * Option: --dedup-ttl
+			 */
+			uint64_t _optionDedupTtl;
+			/**
+			 * Option: --fingerprint
+			 */
+			int _optionFingerprint;
+			/**
+			 * Option: --chain-envelope
+			 */
+			bool _optionChainEnvelope;
+			/**
+			 * Option: --chain-max-hops
+			 */
+			int _optionChainMaxHops;
+			/**
+			 * Option: --chain-subscriptions
+			 */
+			bool _optionChainSubscriptions;
+			/**
+			 * Option: --chain-reactor
+			 */
+			bool _optionChainReactor;
+			/**
+			 * Option: --chain-batch-listen
+			 */
+			std::string _optionChainBatchListen;
+			/**
+			 * Option: --chain-heartbeat-interval
+			 */
+			int _optionChainHeartbeatInterval;
+			/**
+			 * Option: --chain-heartbeat-timeout
+			 */
+			int _optionChainHeartbeatTimeout;
+			/**
+			 * Option: --chain-reconnect-max
+			 */
+			int _optionChainReconnectMax;
+			/**
+			 * Option: --publisher-hwm
+			 */
+			int _optionPublisherHwm;
+			/**
+			 * Option: --receiver-hwm
+			 */
+			int _optionReceiverHwm;
+			/**
+			 * Option: --chain-hwm
+			 */
+			int _optionChainHwm;
+			/**
+			 * Option: --overflow-policy
+			 */
+			int _optionOverflowPolicy;
+			/**
+			 * Option: --publisher-backlog
+			 */
+			size_t _optionPublisherBacklog;
+			/**
+			 * Option: --metrics-listen
+			 */
+			std::string _optionMetricsListen;
+			/**
+			 * Option: --journal-dir
+			 */
+			std::string _optionJournalDir;
+			/**
+			 * Option: --replay-listen
+			 */
+			std::string _optionReplayListen;
+			/**
+			 * Option: --cache-size
+			 */
+			size_t _optionCacheSize;
+			/**
+			 * Option: --snapshot-listen
+			 */
+			std::string _optionSnapshotListen;
 			/**
 			 * Option: --chain-link
 			 */
@@ -155,6 +2538,46 @@ namespace tdrs {
 			 * Option: --discovery-key
 			 */
 			std::string _optionDiscoveryKey;
+			/**
+			 * Option: --discovery-topology
+			 */
+			int _optionDiscoveryTopology;
+			/**
+			 * Option: --discovery-fanout
+			 */
+			size_t _optionDiscoveryFanout;
+			/**
+			 * Option: --discovery-super-peers
+			 */
+			size_t _optionDiscoverySuperPeers;
+			/**
+			 * Option: --partition
+			 */
+			bool _optionPartition;
+			/**
+			 * Option: --partition-delimiter
+			 */
+			char _optionPartitionDelimiter;
+			/**
+			 * Option: --partition-listen
+			 */
+			std::string _optionPartitionListen;
+			/**
+			 * Option: --partition-proxy-listen
+			 */
+			std::string _optionPartitionProxyListen;
+			/**
+			 * Option: --shm-dir
+			 */
+			std::string _optionShmDir;
+			/**
+			 * Option: --shm-listen
+			 */
+			std::string _optionShmListen;
+			/**
+			 * Option: --shm-ring-size
+			 */
+			size_t _optionShmRingSize;
 
 			/**
 			 * @brief      Binds the publisher.
@@ -167,11 +2590,277 @@ namespace tdrs {
 			/**
 			 * @brief      Binds the receiver.
 			 */
-			void _bindReceiver();
+			void _bindReceiver();
+			/**
+			 * @brief      Unbinds (closes) the receiver.
+			 */
+			void _unbindReceiver();
+			/**
+			 * @brief      Binds the ingest.
+			 */
+			void _bindIngest();
+			/**
+			 * @brief      Unbinds (closes) the ingest.
+			 */
+			void _unbindIngest();
+			/**
+			 * @brief      Binds the chain endpoint.
+			 */
+			void _bindChain();
+			/**
+			 * @brief      Unbinds (closes) the chain endpoint.
+			 */
+			void _unbindChain();
+			/**
+			 * @brief      Binds the control endpoint.
+			 */
+			void _bindControl();
+			/**
+			 * @brief      Unbinds (closes) the control endpoint.
+			 */
+			void _unbindControl();
+			/**
+			 * @brief      Binds the chain batch listener.
+			 */
+			void _bindChainBatch();
+			/**
+			 * @brief      Unbinds (closes) the chain batch listener.
+			 */
+			void _unbindChainBatch();
+			/**
+			 * @brief      Binds the partition listener and the partition proxy
+			 * listener, if requested.
+			 */
+			void _bindPartition();
+			/**
+			 * @brief      Unbinds (closes) the partition listener and the
+			 * partition proxy listener.
+			 */
+			void _unbindPartition();
+			/**
+			 * @brief      Creates the wakeup FIFO of the shared-memory rings.
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			bool _bindShm();
+			/**
+			 * @brief      Removes all shared-memory rings and the wakeup FIFO.
+			 */
+			void _unbindShm();
+			/**
+			 * @brief      Binds the metrics endpoint.
+			 */
+			void _bindMetrics();
+			/**
+			 * @brief      Unbinds (closes) the metrics endpoint.
+			 */
+			void _unbindMetrics();
+
+			/**
+			 * @brief      Receives all frames of a multipart message.
+			 *
+			 * @param      socket  The socket to receive from
+			 * @param      frames  The frames vector to append to
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			static bool _receiveFrames(zmq::socket_t &socket, std::vector<zmq::message_t> &frames);
+			/**
+			 * @brief      Inspects the frames of an ingest job, telling events
+			 * and their chain envelopes apart.
+			 *
+			 * @param      job   The ingest job
+			 */
+			void _inspectMessages(_ingestJob *job);
+			/**
+			 * @brief      Fingerprints the events of an ingest job for the
+			 * dedup index and hashes them for the ack, if required.
+			 *
+			 * @param      job   The ingest job
+			 */
+			void _hashMessages(_ingestJob *job) const;
+			/**
+			 * @brief      Registers the hashed events of an ingest job in the
+			 * shared message vector.
+			 *
+			 * @param      job   The ingest job
+			 */
+			void _registerMessages(_ingestJob *job);
+			/**
+			 * @brief      Publishes the events of an ingest job and responds to
+			 * the initiator, if required, once all of them are settled.
+			 *
+			 * @param      job   The ingest job
+			 *
+			 * @return     True if the job is done, false if it waits for
+			 * backlogged events and is released once they are settled.
+			 */
+			bool _publishMessages(_ingestJob *job);
+			/**
+			 * @brief      Responds to the initiator of an ingest job whose
+			 * events are all settled, if required, and records its latencies.
+			 *
+			 * @param      job   The ingest job
+			 */
+			void _completeJob(_ingestJob *job);
+			/**
+			 * @brief      Sends one event on the publisher, without blocking.
+			 *
+			 * @param      event  The event, with its envelope and offset frames
+			 *
+			 * @return     True if the publisher accepted the event, false if
+			 * a subscriber's high-water mark was reached.
+			 */
+			bool _sendEvent(_publisherEvent &event);
+			/**
+			 * @brief      Queues one event the publisher did not accept,
+			 * dropping the oldest backlogged one once the backlog is full.
+			 *
+			 * @param      event  The event, with its envelope and offset frames
+			 * @param      job    The job waiting for the event's ack, or NULL
+			 * @param[in]  index  The index of the event in the job
+			 */
+			void _backlogEvent(_publisherEvent &event, _ingestJob *job, size_t index);
+			/**
+			 * @brief      Settles one backlogged event, acking it to its job.
+			 *
+			 * @param      event      The backlogged event
+			 * @param[in]  published  Whether the publisher took the event
+			 */
+			void _settleEvent(_publisherEvent *event, bool published);
+			/**
+			 * @brief      Sends as many backlogged events as the publisher accepts.
+			 */
+			void _flushPublisher();
+			/**
+			 * @brief      Sends a response for an ingest job to its initiator.
+			 *
+			 * @param      job       The ingest job
+			 * @param[in]  response  The response
+			 */
+			void _respond(_ingestJob *job, const std::string &response);
+			/**
+			 * @brief      Dispatches an ingest job, taking ownership of it.
+			 *
+			 * @param      job   The ingest job
+			 */
+			void _dispatchJob(_ingestJob *job);
+			/**
+			 * @brief      Collects one processed job from the ingest workers and
+			 * publishes all jobs that are due.
+			 */
+			void _serveResults();
+			/**
+			 * @brief      Serves one request on the receiver in REP mode.
+			 */
+			void _serveReceiverRep();
+			/**
+			 * @brief      Serves one request on the receiver in ROUTER mode.
+			 */
+			void _serveReceiverRouter();
+			/**
+			 * @brief      Serves one message on the ingest, without responding.
+			 */
+			void _serveIngest();
+			/**
+			 * @brief      Serves one event received by a chain client.
+			 */
+			void _serveChain();
+			/**
+			 * @brief      Serves one peer announcement on the control endpoint.
+			 */
+			void _serveControl();
+			/**
+			 * @brief      Links to the discovered peers the overlay asks for,
+			 * and unlinks from the others.
+			 */
+			void _updateOverlayLinks();
+			/**
+			 * @brief      Adds a discovered hub to the partition ring, or
+			 * removes it.
+			 *
+			 * @param[in]  peer  The peer announcement
+			 */
+			void _updatePartitionRing(const peerMessage &peer);
+			/**
+			 * @brief      Redirects or proxies the events of an ingest job
+			 * whose topic another hub owns, in partitioned mode.
+			 *
+			 * @param      job   The ingest job
+			 */
+			void _partitionMessages(_ingestJob *job);
+			/**
+			 * @brief      Serves one request on the partition listener.
+			 */
+			void _servePartition();
+			/**
+			 * @brief      Serves one event proxied by another hub, without
+			 * responding.
+			 */
+			void _servePartitionProxy();
+			/**
+			 * @brief      Serves the handshake of a co-located publisher on
+			 * the shared-memory endpoint, creating its shared-memory ring.
+			 */
+			void _serveShmHello();
+			/**
+			 * @brief      Dispatches the events waiting in the shared-memory
+			 * rings.
+			 *
+			 * @return     True if events are left waiting, false otherwise.
+			 */
+			bool _drainShmRings();
+			/**
+			 * @brief      Abandons the shared-memory rings whose publishers
+			 * are gone, for them to be drained and removed.
+			 */
+			void _checkShmRings();
+			/**
+			 * @brief      Serves one request on the metrics endpoint.
+			 */
+			void _serveMetrics();
+			/**
+			 * @brief      Renders the metrics in the Prometheus text format.
+			 *
+			 * @return     The metrics.
+			 */
+			std::string _renderMetrics();
+			/**
+			 * @brief      Serves the subscription messages on the publisher.
+			 */
+			void _serveSubscriptions();
+			/**
+			 * @brief      Serves the subscription messages of batched chain
+			 * links, setting up a chain batcher per spec asked for.
+			 */
+			void _serveChainBatchSubscriptions();
+			/**
+			 * @brief      Adds a published event to the open batch of every
+			 * chain batcher, flushing the batches reaching their size.
+			 *
+			 * @param[in]  event  The event
+			 */
+			void _batchEvent(const _publisherEvent &event);
+			/**
+			 * @brief      Sends the batch of a chain batcher.
+			 *
+			 * @param      batcher  The chain batcher
+			 */
+			void _sendChainBatch(HubChainBatcher *batcher);
+			/**
+			 * @brief      Sends the batches that are due, or all of them.
+			 *
+			 * @param[in]  all   Whether to send all batches
+			 *
+			 * @return     The time (ms) until the next batch is due, -1 for none.
+			 */
+			long _flushChainBatches(bool all);
 			/**
-			 * @brief      Unbinds (closes) the receiver.
+			 * @brief      Publishes a chain heartbeat, if it is due.
+			 *
+			 * @return     The time (ms) until the next heartbeat is due, -1 for none.
 			 */
-			void _unbindReceiver();
+			long _sendHeartbeat();
 
 			/**
 			 * Instance storing discovery service listener thread struct.
@@ -195,10 +2884,32 @@ namespace tdrs {
 			 */
 			void _shutdownDisoveryServiceThreads();
 
+			/**
+			 * @brief      The ingest worker; static method instantiated as an own thread.
+			 *
+			 * @param      ingestWorkerParams  The ingest worker parameters (struct)
+			 *
+			 * @return     NULL
+			 */
+			static void *_ingestWorker(void *ingestWorkerParams);
+			/**
+			 * @brief      Method for running all ingest worker threads.
+			 */
+			void _runIngestWorkerThreads();
+			/**
+			 * @brief      Method for shutting down all running ingest worker threads.
+			 */
+			void _shutdownIngestWorkerThreads();
+
 			/**
 			 * Vector storing chain client thread structs.
 			 */
 			std::vector<_chainClientThread> _chainClientThreads;
+			/**
+			 * Chain client threads requested to stop, to be joined once they
+			 * did.
+			 */
+			std::vector<_chainClientThread> _stoppingChainClientThreads;
 
 			/**
 			 * @brief      The chain client; static method instantiated as an own thread.
@@ -209,13 +2920,91 @@ namespace tdrs {
 			 */
 			static void *_chainClient(void *chainClientParams);
 			/**
-			 * @brief      The chain client cleanup; static method for cleaning up the thread.
+			 * @brief      Method for joining one chain client thread that was
+			 * requested to stop, releasing its parameters.
 			 *
-			 * @param      chainClientParams  The chain client parameters (struct)
+			 * @param      client  The chain client thread struct
+			 */
+			void _joinChainClientThread(_chainClientThread &client);
+			/**
+			 * @brief      Method for joining the chain client threads that
+			 * were requested to stop.
+			 *
+			 * @param[in]  wait  Whether to wait for all of them, or only join
+			 * the ones that stopped already
+			 */
+			void _reapChainClientThreads(bool wait);
+			/**
+			 * @brief      Method for stopping one chain client, handing its
+			 * thread over to be joined or unregistering it from the chain
+			 * reactor.
+			 *
+			 * @param      client  The chain client thread struct
+			 */
+			void _stopChainClient(_chainClientThread &client);
+
+			/**
+			 * Instance storing chain reactor thread struct.
+			 */
+			_chainReactorThread _chainReactorThreadInstance;
+			/**
+			 * @brief      The chain reactor; static method instantiated as an own thread.
+			 *
+			 * @param      chainReactorParams  The chain reactor parameters (struct)
+			 *
+			 * @return     NULL
+			 */
+			static void *_chainReactor(void *chainReactorParams);
+			/**
+			 * @brief      Method for running the chain reactor thread.
+			 */
+			void _runChainReactorThread();
+			/**
+			 * @brief      Method for shutting down the chain reactor thread.
+			 */
+			void _shutdownChainReactorThread();
+
+			/**
+			 * Instance storing replay server thread struct.
+			 */
+			_replayServerThread _replayServerThreadInstance;
+			/**
+			 * @brief      The replay server; static method instantiated as an own thread.
+			 *
+			 * @param      replayServerParams  The replay server parameters (struct)
+			 *
+			 * @return     NULL
+			 */
+			static void *_replayServer(void *replayServerParams);
+			/**
+			 * @brief      Method for running the replay server thread.
+			 */
+			void _runReplayServerThread();
+			/**
+			 * @brief      Method for shutting down the replay server thread.
+			 */
+			void _shutdownReplayServerThread();
+
+			/**
+			 * Instance storing snapshot server thread struct.
+			 */
+			_snapshotServerThread _snapshotServerThreadInstance;
+			/**
+			 * @brief      The snapshot server; static method instantiated as an own thread.
+			 *
+			 * @param      snapshotServerParams  The snapshot server parameters (struct)
 			 *
 			 * @return     NULL
 			 */
-			static void _chainClientCleanup(void *chainClientParams);
+			static void *_snapshotServer(void *snapshotServerParams);
+			/**
+			 * @brief      Method for running the snapshot server thread.
+			 */
+			void _runSnapshotServerThread();
+			/**
+			 * @brief      Method for shutting down the snapshot server thread.
+			 */
+			void _shutdownSnapshotServerThread();
 
 			/**
 			 * @brief      Method for running one chain client thread.
@@ -246,15 +3035,6 @@ namespace tdrs {
 			 */
 			std::string _rewriteReceiver(std::string *receiver);
 
-			/**
-			 * @brief      Static method for parsing a peer message into
-			 * peerMessage type.
-			 *
-			 * @param[in]  message  The message
-			 *
-			 * @return     The peerMessage
-			 */
-			static peerMessage *_parsePeerMessage(const std::string &message);
 		public:
 			/**
 			 * @brief      Constructs the object.
@@ -272,6 +3052,95 @@ namespace tdrs {
 			 * @return     The hash.
 			 */
 			static std::string hashString(std::string *source);
+			/**
+			 * @brief      Static method for hashing a buffer in place using SHA1.
+			 *
+			 * @param[in]  data  The data
+			 * @param[in]  size  The size of the data
+			 *
+			 * @return     The hash.
+			 */
+			static std::string hashData(const void *data, size_t size);
+			/**
+			 * @brief      Static method for fingerprinting a buffer in place,
+			 * for the dedup index.
+			 *
+			 * @param[in]  data         The data
+			 * @param[in]  size         The size of the data
+			 * @param[in]  fingerprint  The fingerprint, one of TDRS_FINGERPRINT_*
+			 *
+			 * @return     The fingerprint; the SHA1 hex hash or the binary XXH3 128 bit digest.
+			 */
+			static std::string fingerprintData(const void *data, size_t size, int fingerprint);
+			/**
+			 * @brief      Static method for parsing a chain envelope frame.
+			 *
+			 * @param[in]  message   The frame
+			 * @param      envelope  The parsed envelope
+			 *
+			 * @return     True if the frame is a chain envelope, false otherwise.
+			 */
+			static bool parseEnvelope(const zmq::message_t &message, chainEnvelope *envelope);
+			/**
+			 * @brief      Static method for building a chain envelope frame.
+			 *
+			 * @param[in]  envelope  The envelope
+			 * @param      message   The frame
+			 */
+			static void buildEnvelope(const chainEnvelope &envelope, zmq::message_t *message);
+			/**
+			 * @brief      Static method for parsing an offset frame.
+			 *
+			 * @param[in]  message  The frame
+			 * @param      offset   The parsed journal offset
+			 *
+			 * @return     True if the frame is an offset frame, false otherwise.
+			 */
+			static bool parseOffset(const zmq::message_t &message, uint64_t *offset);
+			/**
+			 * @brief      Static method for building an offset frame.
+			 *
+			 * @param[in]  offset   The journal offset
+			 * @param      message  The frame
+			 */
+			static void buildOffset(uint64_t offset, zmq::message_t *message);
+			/**
+			 * @brief      Static method for sending one message to a client of
+			 * a ROUTER socket with ZMQ_ROUTER_MANDATORY and a send timeout,
+			 * prefixed by its routing frames, waiting for a client that
+			 * cannot keep up for a bounded number of timeouts.
+			 *
+			 * @param      socket   The socket
+			 * @param      routing  The routing frames
+			 * @param      frames   The frames
+			 * @param[in]  run      The server's run-loop variable
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			static bool sendRouted(zmq::socket_t &socket, std::vector<zmq::message_t> &routing, std::vector<zmq::message_t> &frames, const std::atomic<bool> &run);
+			/**
+			 * @brief      Static method for parsing a control message frame.
+			 *
+			 * @param[in]  message  The frame
+			 * @param      peer     The parsed peer announcement
+			 *
+			 * @return     True if the frame is a valid control message, false otherwise.
+			 */
+			static bool parseControl(const zmq::message_t &message, peerMessage *peer);
+			/**
+			 * @brief      Static method for building a control message frame.
+			 *
+			 * @param[in]  peer     The peer announcement
+			 * @param      message  The frame
+			 */
+			static void buildControl(const peerMessage &peer, zmq::message_t *message);
+			/**
+			 * @brief      Static method returning the current monotonic time,
+			 * for latency metrics.
+			 *
+			 * @return     The time (ns).
+			 */
+			static uint64_t monotonicTime();
 
 			/**
 			 * @brief      Static method for parsing a ZeroMQ address string into
@@ -282,6 +3151,19 @@ namespace tdrs {
 			 * @return     The zeroAddress
 			 */
 			static zeroAddress *parseZeroAddress(const std::string &address);
+			/**
+			 * @brief      Static method for parsing a chain link, an address
+			 * optionally followed by the batch spec of a batched link, e.g.
+			 * `tcp://10.0.0.2:19892?codec=zstd&batch-size=65536&batch-window=500`.
+			 *
+			 * @param[in]  link      The link
+			 * @param      endpoint  The address
+			 * @param      batched   Whether the link is batched
+			 * @param      spec      The batch spec
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			static bool parseChainLink(const std::string &link, std::string *endpoint, bool *batched, chainBatchSpec *spec);
 
 			/**
 			 * @brief      Sets the Hub options.
@@ -337,33 +3219,311 @@ namespace tdrs {
 	class HubChainClient {
 		private:
 			_chainClientParams *_params;
-			/**
-			 * ZMQ Context.
-			 */
-			zmq::context_t _zmqContext;
 			/**
 			 * ZMQ Subscriber Socket.
 			 */
 			zmq::socket_t _zmqSubscriberSocket;
 			/**
-			 * ZMQ Sender Socket.
+			 * ZMQ Sender Socket, handing events to the hub.
 			 */
 			zmq::socket_t _zmqSenderSocket;
 			/**
-			 * The run-loop variable.
+			 * Identifier of the hub behind the link, 0 until it said hello.
 			 */
-			bool _runLoop;
+			uint64_t _peerId;
+			/**
+			 * Version of the subscription table the subscriptions were last updated to.
+			 */
+			uint64_t _subscriptionVersion;
+			/**
+			 * Prefixes currently subscribed to at the link.
+			 */
+			std::set<std::string> _subscribedPrefixes;
+			/**
+			 * Events of the batch being served, uncompressed.
+			 */
+			std::string _batchEvents;
+			/**
+			 * Decompression context of the zstd codec, with a batched link.
+			 */
+			ZSTD_DCtx *_zstdContext;
+			/**
+			 * Time (ns) the link publisher was last heard from, or reconnected to.
+			 */
+			uint64_t _lastSeenAt;
+			/**
+			 * Time (ns) a link that is down is reconnected at.
+			 */
+			uint64_t _reconnectAt;
+			/**
+			 * Delay (ms) before the next reconnect of a link that is down.
+			 */
+			int _reconnectDelay;
+			/**
+			 * Whether the subscriber socket is connected to the link publisher.
+			 */
+			bool _connected;
+			/**
+			 * Event the hub did not take yet, and its envelope, if any.
+			 */
+			zmq::message_t _pendingEvent;
+			zmq::message_t _pendingEnvelope;
+			bool _pending;
+			bool _pendingEnveloped;
+			/**
+			 * Delay (ms) before the pending event is retried.
+			 */
+			long _retryDelay;
+			/**
+			 * Position of the next event of the batch being served, and
+			 * whether any of its events are left to hand to the hub.
+			 */
+			size_t _batchPosition;
+			bool _batchRemaining;
+
+			/**
+			 * @brief      Subscribes to the prefixes the subscribers of the hub
+			 * are interested in, except for the ones of the hub behind the
+			 * link, and unsubscribes from the others.
+			 *
+			 * @param      socket  The subscriber socket
+			 */
+			void _updateSubscriptions(zmq::socket_t &socket);
+			/**
+			 * @brief      Hands one event to the hub, unless it was processed
+			 * before.
+			 *
+			 * @param      event            The event
+			 * @param[in]  enveloped        Whether the event came with an envelope
+			 * @param[in]  envelope         The parsed envelope
+			 * @param      envelopeMessage  The envelope frame
+			 */
+			void _forward(zmq::message_t &event, bool enveloped, const chainEnvelope &envelope, zmq::message_t &envelopeMessage);
+			/**
+			 * @brief      Receives the batch following a batch topic and hands
+			 * its events to the hub, one by one.
+			 */
+			void _serveBatch();
+			/**
+			 * @brief      Hands the events of the batch being served to the
+			 * hub, until one of them is left pending.
+			 */
+			void _forwardBatch();
+			/**
+			 * @brief      Hands the pending event to the hub, followed by the
+			 * rest of its batch.
+			 */
+			void _retry();
+			/**
+			 * @brief      Sets the link state, registering the link with the
+			 * dedup index unless it is down.
+			 *
+			 * @param[in]  state  The link state
+			 */
+			void _setState(int state);
+			/**
+			 * @brief      Checks the heartbeats of the link publisher, taking
+			 * the link down and reconnecting it as required.
+			 */
+			void _checkHeartbeat();
 		public:
 			/**
 			 * @brief      Constructs the object.
 			 *
-			 * @param[in]  ctxn  The number of context IO threads
+			 * @param      context  The hub's ZMQ context
+			 * @param      params   The chain client parameters (struct)
+			 */
+			HubChainClient(zmq::context_t *context, _chainClientParams *params);
+			/**
+			 * @brief      Destroys the object.
+			 */
+			~HubChainClient();
+
+			/**
+			 * @brief      Connects to the hub and subscribes to the link publisher.
+			 */
+			void open();
+			/**
+			 * @brief      Returns the poll item of the link publisher subscription.
+			 *
+			 * @return     The poll item.
+			 */
+			zmq::pollitem_t pollItem();
+			/**
+			 * @brief      Returns the events the subscription is polled for,
+			 * none while an event is pending.
+			 *
+			 * @return     The poll events.
+			 */
+			short pollEvents();
+			/**
+			 * @brief      Returns the time (ms) the subscription may be polled
+			 * for, before the client needs to be maintained again.
+			 *
+			 * @return     The poll timeout.
+			 */
+			long pollTimeout();
+			/**
+			 * @brief      Hands the pending event to the hub, follows the
+			 * subscription table, if it changed, and checks the heartbeats of
+			 * the link publisher.
+			 */
+			void maintain();
+			/**
+			 * @brief      Receives one message from the link publisher and hands
+			 * it to the hub, unless it was processed before.
+			 */
+			void serve();
+			/**
+			 * @brief      Unsubscribes from the link publisher and disconnects
+			 * from the hub.
+			 */
+			void close();
+			/**
+			 * @brief      Runs the chain client on its own thread.
+			 */
+			void run();
+	};
+
+	/**
+	 * @brief      Class for HubChainReactor, serving all chain links on a
+	 * single thread.
+	 */
+	class HubChainReactor {
+		private:
+			/**
+			 * The hub's ZMQ context.
+			 */
+			zmq::context_t *_zmqContext;
+			/**
+			 * ZMQ Control Socket, receiving link registrations from the hub.
+			 */
+			zmq::socket_t _zmqControlSocket;
+			/**
+			 * Map storing the chain clients by their parameters.
+			 */
+			std::map<_chainClientParams*, HubChainClient*> _clients;
+
+			/**
+			 * @brief      Registers or unregisters one chain link.
+			 *
+			 * @param[in]  command  The command
+			 */
+			void _execute(const _chainReactorCommand &command);
+		public:
+			/**
+			 * @brief      Constructs the object.
+			 *
+			 * @param      context  The hub's ZMQ context
+			 */
+			HubChainReactor(zmq::context_t *context);
+
+			/**
+			 * @brief      Runs the chain reactor, until the hub requests it to exit.
+			 */
+			void run();
+	};
+
+	/**
+	 * @brief      Class for HubReplayServer, streaming journaled events to
+	 * clients from the offset they ask for.
+	 */
+	class HubReplayServer {
+		private:
+			/**
+			 * The parameters.
+			 */
+			_replayServerParams *_params;
+			/**
+			 * ZMQ Replay Socket, a ROUTER socket.
+			 */
+			zmq::socket_t _zmqReplaySocket;
+			/**
+			 * Routing frames of the request being served.
+			 */
+			std::vector<zmq::message_t> _routing;
+			/**
+			 * Whether sending the replay failed.
+			 */
+			bool _failed;
+
+			/**
+			 * @brief      Sends one message to the client being served,
+			 * prefixed by its routing frames.
+			 *
+			 * @param      frames  The frames
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			bool _reply(std::vector<zmq::message_t> &frames);
+			/**
+			 * @brief      Static method sending one replayed record, as
+			 * journal replay handler.
+			 *
+			 * @return     True to continue, false to stop the replay.
+			 */
+			static bool _replayRecord(void *context, uint64_t offset, const void *payload, size_t payloadSize, const void *envelope, size_t envelopeSize);
+			/**
+			 * @brief      Serves one replay request.
+			 */
+			void _serve();
+		public:
+			/**
+			 * @brief      Constructs the object.
+			 *
+			 * @param      params  The parameters
+			 */
+			HubReplayServer(_replayServerParams *params);
+
+			/**
+			 * @brief      Runs the replay server, until it is requested to stop.
+			 */
+			void run();
+	};
+
+	/**
+	 * @brief      Class for HubSnapshotServer, sending clients the cached last
+	 * values of the keys starting with the prefix they ask for.
+	 */
+	class HubSnapshotServer {
+		private:
+			/**
+			 * The parameters.
+			 */
+			_snapshotServerParams *_params;
+			/**
+			 * ZMQ Snapshot Socket, a ROUTER socket.
+			 */
+			zmq::socket_t _zmqSnapshotSocket;
+			/**
+			 * Routing frames of the request being served.
+			 */
+			std::vector<zmq::message_t> _routing;
+
+			/**
+			 * @brief      Sends one message to the client being served,
+			 * prefixed by its routing frames.
+			 *
+			 * @param      message  The message
+			 *
+			 * @return     True on success, false on failure.
+			 */
+			bool _reply(zmq::message_t &message);
+			/**
+			 * @brief      Serves one snapshot request.
+			 */
+			void _serve();
+		public:
+			/**
+			 * @brief      Constructs the object.
+			 *
+			 * @param      params  The parameters
 			 */
-			HubChainClient(int ctxn, _chainClientParams *params);
-			// ~HubChainClient();
+			HubSnapshotServer(_snapshotServerParams *params);
 
 			/**
-			 * @brief      Runs the chain client.
+			 * @brief      Runs the snapshot server, until it is requested to
+			 * stop.
 			 */
 			void run();
 	};
@@ -0,0 +1,137 @@
+#include "tdrs.hpp"
+
+/**
+ * Heartbeat interval and timeout (ms) of the chain link under test.
+ */
+#define TEST_HEARTBEAT_INTERVAL 50
+#define TEST_HEARTBEAT_TIMEOUT 200
+/**
+ * Time (ms) the hub is stalled for, well past the heartbeat timeout.
+ */
+#define TEST_STALL 1000
+/**
+ * Endpoint of the link publisher.
+ */
+#define TEST_LINK_ENDPOINT "inproc://test-link"
+
+/**
+ * @brief      Runs the chain client under test; instantiated as an own
+ * thread, like the hub does without the chain reactor.
+ *
+ * @param      chainClientParams  The chain client parameters (struct)
+ *
+ * @return     NULL
+ */
+void *runChainClient(void *chainClientParams) {
+	tdrs::_chainClientParams *params = static_cast<tdrs::_chainClientParams*>(chainClientParams);
+	tdrs::HubChainClient client(params->context, params);
+	client.run();
+	return NULL;
+}
+
+/**
+ * @brief      Stalls the hub behind a chain link past the heartbeat timeout,
+ * while the link publisher keeps sending events and heartbeats, and checks
+ * that the link stays up: the client is the one behind, not the link.
+ *
+ * @return     0 if the link stayed up, 1 otherwise
+ */
+int main()
+{
+	tdrs::Logger::start();
+
+	zmq::context_t context(1);
+
+	// Stands in for the hub, taking no events while it is stalled
+	zmq::socket_t hub(context, ZMQ_PULL);
+	int hwm = 1;
+	int linger = 0;
+	hub.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+	hub.setsockopt(ZMQ_RCVHWM, &hwm, sizeof(hwm));
+	hub.bind(TDRS_CHAIN_ENDPOINT);
+
+	zmq::socket_t publisher(context, ZMQ_PUB);
+	publisher.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+	publisher.bind(TEST_LINK_ENDPOINT);
+
+	pthread_mutex_t dedupIndexMutex = PTHREAD_MUTEX_INITIALIZER;
+	pthread_mutex_t subscriptionTableMutex = PTHREAD_MUTEX_INITIALIZER;
+	tdrs::HubDedupIndex dedupIndex;
+	tdrs::HubSequenceWindow sequenceWindow;
+	std::vector<uint32_t> chainLinkIds;
+
+	tdrs::_chainClientParams *params = new tdrs::_chainClientParams;
+	params->context = &context;
+	params->dedupIndexMutex = &dedupIndexMutex;
+	params->dedupIndex = &dedupIndex;
+	params->id = "stall";
+	params->link = TEST_LINK_ENDPOINT;
+	params->endpoint = TEST_LINK_ENDPOINT;
+	params->batched = false;
+	params->linkId = dedupIndex.linkId(params->link);
+	chainLinkIds.push_back(params->linkId);
+	params->fingerprint = TDRS_FINGERPRINT_XXH3;
+	params->hubId = 1;
+	params->maxHops = TDRS_CHAIN_DEFAULT_MAX_HOPS;
+	params->hwm = hwm;
+	params->heartbeatInterval = TEST_HEARTBEAT_INTERVAL;
+	params->heartbeatTimeout = TEST_HEARTBEAT_TIMEOUT;
+	params->reconnectMax = TDRS_CHAIN_DEFAULT_RECONNECT_MAX;
+	params->forwarded = 0;
+	params->discarded = 0;
+	params->state = TDRS_CHAIN_LINK_UP;
+	params->reconnects = 0;
+	params->chainLinkIds = &chainLinkIds;
+	params->sequenceWindow = &sequenceWindow;
+	params->subscriptionTableMutex = &subscriptionTableMutex;
+	params->subscriptionTable = NULL;
+	params->run = true;
+	params->stopped = false;
+
+	pthread_t thread;
+	pthread_create(&thread, NULL, &runChainClient, (void *)params);
+
+	// The link publisher sends distinct events and a heartbeat every interval; the hub takes none
+	bool down = false;
+	uint64_t startedAt = tdrs::Hub::monotonicTime();
+	uint64_t event = 0;
+	while(tdrs::Hub::monotonicTime() < startedAt + (uint64_t)TEST_STALL * 1000000) {
+		std::string payload = "event " + std::to_string(event++);
+		zmq::message_t message(payload.data(), payload.size());
+		publisher.send(message);
+
+		zmq::message_t heartbeat(TDRS_CHAIN_HEARTBEAT_TOPIC, strlen(TDRS_CHAIN_HEARTBEAT_TOPIC));
+		publisher.send(heartbeat);
+
+		down = (down || params->state == TDRS_CHAIN_LINK_DOWN);
+		usleep(TEST_HEARTBEAT_INTERVAL * 1000);
+	}
+
+	// The hub catches up, the client hands it what it held on to
+	uint64_t resumedAt = tdrs::Hub::monotonicTime();
+	while(tdrs::Hub::monotonicTime() < resumedAt + (uint64_t)TEST_HEARTBEAT_TIMEOUT * 2 * 1000000) {
+		zmq::message_t forwarded;
+		while(hub.recv(&forwarded, ZMQ_DONTWAIT)) {
+		}
+
+		zmq::message_t heartbeat(TDRS_CHAIN_HEARTBEAT_TOPIC, strlen(TDRS_CHAIN_HEARTBEAT_TOPIC));
+		publisher.send(heartbeat);
+
+		down = (down || params->state == TDRS_CHAIN_LINK_DOWN);
+		usleep(TEST_HEARTBEAT_INTERVAL * 1000);
+	}
+
+	bool up = (!down && params->state == TDRS_CHAIN_LINK_UP && params->reconnects == 0);
+	std::cout << "chain_client_stall: " << event << " events sent, " << params->forwarded << " forwarded, "
+		<< params->reconnects << " reconnects, link " << (up ? "stayed up" : "went down") << "." << std::endl;
+
+	params->run = false;
+	pthread_join(thread, NULL);
+	delete params;
+
+	hub.close();
+	publisher.close();
+	tdrs::Logger::shutdown();
+
+	return (up ? 0 : 1);
+}